@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "apiwrap.h"
 #include "data/data_channel.h"
 #include "data/data_histories.h"
+#include "data/data_local_search_index.h"
 #include "data/data_message_reaction_id.h"
 #include "data/data_peer.h"
 #include "data/data_session.h"
@@ -108,6 +109,7 @@ void MessagesSearch::searchRequest() {
 			searchReceived(it->second, _requestId, nextToken);
 			return;
 		}
+		searchLocal(nextToken);
 	}
 	auto callback = [=](Fn<void()> finish) {
 		using Flag = MTPmessages_Search::Flag;
@@ -160,6 +162,58 @@ void MessagesSearch::searchRequest() {
 		std::move(callback));
 }
 
+void MessagesSearch::searchLocal(const QString &nextToken) {
+	const auto localSearchId = ++_localSearchId;
+	if (_request.from
+		|| !_request.tags.empty()
+		|| _request.topMsgId
+		|| _request.filter != SearchFilter::NoFilter) {
+		return;
+	}
+	_history->owner().localSearchIndex().search(
+		_history->peer->id,
+		_request.query,
+		kSearchPerPage,
+		crl::guard(this, [=](std::vector<MsgId> ids) {
+			if (localSearchId == _localSearchId) {
+				searchLocalFound(localSearchId, nextToken, std::move(ids));
+			}
+		}));
+}
+
+void MessagesSearch::searchLocalFound(
+		uint64 localSearchId,
+		const QString &nextToken,
+		std::vector<MsgId> ids) {
+	const auto peer = _history->peer;
+	const auto left = std::make_shared<int>(1);
+	const auto ready = crl::guard(this, [=] {
+		if (--*left || localSearchId != _localSearchId) {
+			return;
+		}
+		// A different token makes the server results replace these ones.
+		auto found = FoundMessages{ .nextToken = nextToken + u"\nlocal"_q };
+		for (const auto &id : ids) {
+			if (_history->owner().message(peer->id, id)) {
+				found.messages.push_back(FullMsgId(peer->id, id));
+			}
+		}
+		if (!found.messages.empty()) {
+			_messagesFounds.fire(std::move(found));
+		}
+	});
+
+	// After a restart only the index is there, not the messages.
+	auto &api = _history->session().api();
+	for (const auto &id : ids) {
+		if (!_history->owner().message(peer->id, id)) {
+			++*left;
+			api.requestMessageData(peer, id, ready);
+		}
+	}
+	ready();
+}
+
 void MessagesSearch::searchReceived(
 		const TLMessages &result,
 		mtpRequestId requestId,
@@ -167,6 +221,9 @@ void MessagesSearch::searchReceived(
 	if (requestId != _requestId) {
 		return;
 	}
+	// Local results are not needed anymore.
+	++_localSearchId;
+
 	auto &owner = _history->owner();
 	auto found = result.match([&](const MTPDmessages_messages &data) {
 		if (_requestId != 0) {
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/qt/qt_compare.h"
+#include "base/weak_ptr.h"
 #include "data/data_message_reaction_id.h"
 
 class HistoryItem;
@@ -31,7 +32,7 @@ struct FoundMessages {
 	QString nextToken;
 };
 
-class MessagesSearch final {
+class MessagesSearch final : public base::has_weak_ptr {
 public:
 	struct Request {
 		QString query;
@@ -59,6 +60,11 @@ public:
 private:
 	using TLMessages = MTPmessages_Messages;
 	void searchRequest();
+	void searchLocal(const QString &nextToken);
+	void searchLocalFound(
+		uint64 localSearchId,
+		const QString &nextToken,
+		std::vector<MsgId> ids);
 	void searchReceived(
 		const TLMessages &result,
 		mtpRequestId requestId,
@@ -73,6 +79,7 @@ private:
 
 	int _searchInHistoryRequest = 0; // Not real mtpRequestId.
 	mtpRequestId _requestId = 0;
+	uint64 _localSearchId = 0;
 
 	rpl::event_stream<FoundMessages> _messagesFounds;
 
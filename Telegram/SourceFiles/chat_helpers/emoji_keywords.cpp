@@ -38,12 +38,24 @@ struct LangPackEmoji {
 	QString text;
 };
 
+struct LangPackKey {
+	QString text;
+	int emojiFrom = 0;
+	int emojiTill = 0;
+};
+
+// Keys are sorted and all their emoji lists are stored one after another,
+// so queries walk two contiguous arrays instead of the map nodes. It is
+// built on a worker thread after each cache read or difference.
 struct LangPackData {
 	int version = 0;
 	int maxKeyLength = 0;
-	std::map<QString, std::vector<LangPackEmoji>> emoji;
+	std::vector<LangPackKey> keys;
+	std::vector<LangPackEmoji> emoji;
 };
 
+using LangPackMap = std::map<QString, std::vector<LangPackEmoji>>;
+
 [[nodiscard]] bool MustAddPostfix(const QString &text) {
 	if (text.size() != 1) {
 		return false;
@@ -81,6 +93,48 @@ struct LangPackData {
 	return (length < text.size()) ? nullptr : result;
 }
 
+[[nodiscard]] gsl::span<const LangPackEmoji> KeyEmoji(
+		const LangPackData &data,
+		const LangPackKey &key) {
+	return gsl::make_span(data.emoji).subspan(
+		key.emojiFrom,
+		key.emojiTill - key.emojiFrom);
+}
+
+void AppendKey(LangPackData &data, const QString &key) {
+	const auto index = int(data.emoji.size());
+	data.keys.push_back({ key, index, index });
+	data.maxKeyLength = std::max(data.maxKeyLength, int(key.size()));
+}
+
+void AppendKeyEmoji(LangPackData &data, LangPackEmoji entry) {
+	data.emoji.push_back(std::move(entry));
+	++data.keys.back().emojiTill;
+}
+
+[[nodiscard]] LangPackMap UnpackLangPack(const LangPackData &data) {
+	auto result = LangPackMap();
+	for (const auto &key : data.keys) {
+		const auto list = KeyEmoji(data, key);
+		result.emplace(
+			key.text,
+			std::vector<LangPackEmoji>(list.begin(), list.end()));
+	}
+	return result;
+}
+
+[[nodiscard]] LangPackData PackLangPack(int version, LangPackMap &&map) {
+	auto result = LangPackData{ .version = version };
+	result.keys.reserve(map.size());
+	for (auto &[key, list] : map) {
+		AppendKey(result, key);
+		for (auto &entry : list) {
+			AppendKeyEmoji(result, std::move(entry));
+		}
+	}
+	return result;
+}
+
 void CreateCacheFilePath() {
 	QDir().mkpath(internal::CacheFileFolder() + u"/keywords"_q);
 }
@@ -116,10 +170,12 @@ void CreateCacheFilePath() {
 		stream
 			>> key
 			>> size;
-		if (size < 0 || stream.status() != QDataStream::Ok) {
+		if (size < 0
+			|| stream.status() != QDataStream::Ok
+			|| (!result.keys.empty() && !(result.keys.back().text < key))) {
 			return {};
 		}
-		auto &list = result.emoji[key];
+		AppendKey(result, key);
 		for (auto j = 0; j != size; ++j) {
 			auto text = QString();
 			stream >> text;
@@ -133,16 +189,15 @@ void CreateCacheFilePath() {
 			if (!entry.emoji) {
 				return {};
 			}
-			list.push_back(entry);
+			AppendKeyEmoji(result, entry);
 		}
-		result.maxKeyLength = std::max(result.maxKeyLength, int(key.size()));
 	}
 	result.version = version;
 	return result;
 }
 
 void WriteLocalCache(const QString &id, const LangPackData &data) {
-	if (!data.version && data.emoji.empty()) {
+	if (!data.version && data.keys.empty()) {
 		return;
 	}
 	CreateCacheFilePath();
@@ -154,12 +209,12 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 	stream.setVersion(QDataStream::Qt_5_1);
 	stream
 		<< qint32(data.version)
-		<< qint32(data.emoji.size());
-	for (const auto &[key, list] : data.emoji) {
+		<< qint32(data.keys.size());
+	for (const auto &key : data.keys) {
 		stream
-			<< key
-			<< qint32(list.size());
-		for (const auto &emoji : list) {
+			<< key.text
+			<< qint32(key.emojiTill - key.emojiFrom);
+		for (const auto &emoji : KeyEmoji(data, key)) {
 			stream << emoji.text;
 		}
 	}
@@ -176,7 +231,7 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 void AppendFoundEmoji(
 		std::vector<Result> &result,
 		const QString &label,
-		const std::vector<LangPackEmoji> &list) {
+		gsl::span<const LangPackEmoji> list) {
 	// It is important that the 'result' won't relocate while inserting.
 	result.reserve(result.size() + list.size());
 	const auto alreadyBegin = begin(result);
@@ -245,14 +300,14 @@ void ApplyDifference(
 		LangPackData &data,
 		const QVector<MTPEmojiKeyword> &keywords,
 		int version) {
-	data.version = version;
+	auto map = UnpackLangPack(data);
 	for (const auto &keyword : keywords) {
 		keyword.match([&](const MTPDemojiKeyword &keyword) {
 			const auto word = NormalizeKey(qs(keyword.vkeyword()));
 			if (word.isEmpty()) {
 				return;
 			}
-			auto &list = data.emoji[word];
+			auto &list = map[word];
 			auto &&emoji = ranges::views::all(
 				keyword.vemoticons().v
 			) | ranges::views::transform([](const MTPstring &string) {
@@ -276,8 +331,8 @@ void ApplyDifference(
 			if (word.isEmpty()) {
 				return;
 			}
-			const auto i = data.emoji.find(word);
-			if (i == end(data.emoji)) {
+			const auto i = map.find(word);
+			if (i == end(map)) {
 				return;
 			}
 			auto &list = i->second;
@@ -287,20 +342,11 @@ void ApplyDifference(
 					end(list));
 			}
 			if (list.empty()) {
-				data.emoji.erase(i);
+				map.erase(i);
 			}
 		});
 	}
-	if (data.emoji.empty()) {
-		data.maxKeyLength = 0;
-	} else {
-		auto &&lengths = ranges::views::all(
-			data.emoji
-		) | ranges::views::transform([](auto &&pair) {
-			return pair.first.size();
-		});
-		data.maxKeyLength = *ranges::max_element(lengths);
-	}
+	data = PackLangPack(version, std::move(map));
 }
 
 } // namespace
@@ -474,23 +520,28 @@ std::vector<Result> EmojiKeywords::LangPack::query(
 		const QString &normalized,
 		bool exact) const {
 	if (normalized.size() > _data.maxKeyLength
-		|| _data.emoji.empty()
+		|| _data.keys.empty()
 		|| (exact && SkipExactKeyword(_id, normalized))) {
 		return {};
 	}
 
-	const auto from = _data.emoji.lower_bound(normalized);
+	const auto from = ranges::lower_bound(
+		_data.keys,
+		normalized,
+		ranges::less(),
+		&LangPackKey::text);
 	auto &&chosen = ranges::make_subrange(
 		from,
-		end(_data.emoji)
-	) | ranges::views::take_while([&](const auto &pair) {
-		const auto &key = pair.first;
-		return exact ? (key == normalized) : key.startsWith(normalized);
+		end(_data.keys)
+	) | ranges::views::take_while([&](const LangPackKey &key) {
+		return exact
+			? (key.text == normalized)
+			: key.text.startsWith(normalized);
 	});
 
 	auto result = std::vector<Result>();
-	for (const auto &[key, list] : chosen) {
-		AppendFoundEmoji(result, key, list);
+	for (const auto &key : chosen) {
+		AppendFoundEmoji(result, key.text, KeyEmoji(_data, key));
 	}
 	return result;
 }
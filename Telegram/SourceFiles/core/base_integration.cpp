@@ -41,6 +41,7 @@ void BaseIntegration::setCrashAnnotation(
 
 void BaseIntegration::logAssertionViolation(const QString &info) {
 	Logs::writeMain("Assertion Failed! " + info);
+	Logs::flush();
 	CrashReports::SetAnnotation("Assertion", info);
 }
 
@@ -253,6 +253,7 @@ void SignalHandler(int signum, siginfo_t *info, void *ucontext) {
 
 	if (ReportingThreadId.compare_exchange_strong(expected, thread)) {
 		WriteReportInfo(signum, name);
+		Logs::flushCrashed();
 		ReportingThreadId = nullptr;
 	}
 
@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/changelogs.h"
 #include "core/click_handler_types.h"
+#include "core/update_package.h"
 #include "mainwindow.h"
 #include "main/main_account.h"
 #include "main/main_session.h"
@@ -50,16 +51,9 @@ extern "C" {
 #include <openssl/pem.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
+#include <openssl/sha.h>
 } // extern "C"
 
-#ifndef TDESKTOP_DISABLE_AUTOUPDATE
-#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED // use Lzma SDK for win
-#include <LzmaLib.h>
-#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
-#include <lzma.h>
-#endif // else of Q_OS_WIN && !TDESKTOP_USE_PACKAGED
-#endif // !TDESKTOP_DISABLE_AUTOUPDATE
-
 #ifndef Q_OS_WIN
 #include <unistd.h>
 #endif // !Q_OS_WIN
@@ -352,19 +346,14 @@ bool UnpackUpdate(const QString &filepath) {
 		return false;
 	}
 
-#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED // use Lzma SDK for win
-	const int32 hSigLen = 128, hShaLen = 20, hPropsLen = LZMA_PROPS_SIZE, hOriginalSizeLen = sizeof(int32), hSize = hSigLen + hShaLen + hPropsLen + hOriginalSizeLen; // header
-#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
-	const int32 hSigLen = 128, hShaLen = 20, hPropsLen = 0, hOriginalSizeLen = sizeof(int32), hSize = hSigLen + hShaLen + hOriginalSizeLen; // header
-#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+	const int32 hSigLen = 128, hShaLen = 20, hPropsLen = kUpdatePropsSize, hOriginalSizeLen = sizeof(int32), hSize = hSigLen + hShaLen + hPropsLen + hOriginalSizeLen; // header
 
-	QByteArray compressed = input.readAll();
-	int32 compressedLen = compressed.size() - hSize;
-	if (compressedLen <= 0) {
-		LOG(("Update Error: bad compressed size: %1").arg(compressed.size()));
+	const auto header = input.read(hSize);
+	const auto compressedLen = input.size() - hSize;
+	if (header.size() < hSize || compressedLen <= 0) {
+		LOG(("Update Error: bad compressed size: %1").arg(input.size()));
 		return false;
 	}
-	input.close();
 
 	QString tempDirPath = cWorkingDir() + u"tupdates/temp"_q, readyFilePath = cWorkingDir() + u"tupdates/temp/ready"_q;
 	base::Platform::DeleteDirectory(tempDirPath);
@@ -375,8 +364,39 @@ bool UnpackUpdate(const QString &filepath) {
 		return false;
 	}
 
+	auto ready = false;
+	const auto clearTemp = gsl::finally([&] {
+		if (!ready) {
+			base::Platform::DeleteDirectory(tempDirPath);
+		}
+	});
+
+	int32 uncompressedLen;
+	memcpy(&uncompressedLen, header.constData() + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
+
+	// The package is copied to a private file in the same pass it is hashed
+	// in, only that copy is decompressed after the signature is checked.
+	QFile verified(cWorkingDir() + u"tupdates/verified"_q);
+	QFile unpacked(cWorkingDir() + u"tupdates/unpacked"_q);
+	const auto removeCopies = gsl::finally([&] {
+		verified.remove();
+		unpacked.remove();
+	});
+
 	uchar sha1Buffer[20];
-	bool goodSha1 = !memcmp(compressed.constData() + hSigLen, hashSha1(compressed.constData() + hSigLen + hShaLen, compressedLen + hPropsLen + hOriginalSizeLen, sha1Buffer), hShaLen);
+	if (!verified.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+		LOG(("Update Error: cant create the copy of updates file!"));
+		return false;
+	} else if (!CopyUpdatePackage(
+			input,
+			verified,
+			header.mid(hSigLen + hShaLen),
+			sha1Buffer)) {
+		return false;
+	}
+	input.close();
+
+	bool goodSha1 = !memcmp(header.constData() + hSigLen, sha1Buffer, hShaLen);
 	if (!goodSha1) {
 		LOG(("Update Error: bad SHA1 hash of update file!"));
 		return false;
@@ -391,8 +411,8 @@ bool UnpackUpdate(const QString &filepath) {
 	keys.push_back(AppBetaVersion
 		? UpdatesPublicKey
 		: UpdatesPublicBetaKey);
-	bool verified = false;
-	while (!verified && !keys.empty())
+	bool signatureVerified = false;
+	while (!signatureVerified && !keys.empty())
 	{
 		const char* rsa_key = keys.front();
 		keys.pop_front();
@@ -408,97 +428,35 @@ bool UnpackUpdate(const QString &filepath) {
 			return false;
 		}
 		// verify signature
-		verified = (RSA_verify(NID_sha1, (const uchar*)(compressed.constData() + hSigLen), hShaLen, (const uchar*)(compressed.constData()), hSigLen, pbKey) == 1);
+		signatureVerified = (RSA_verify(NID_sha1, (const uchar*)(header.constData() + hSigLen), hShaLen, (const uchar*)(header.constData()), hSigLen, pbKey) == 1);
 		RSA_free(pbKey);
 	}
-	if (!verified)
+	if (!signatureVerified)
 	{
 		LOG(("Update Error: bad RSA signature of update file!"));
 		return false;
 	}
 	keys.clear();
 
-	QByteArray uncompressed;
-
-	int32 uncompressedLen;
-	memcpy(&uncompressedLen, compressed.constData() + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
-	uncompressed.resize(uncompressedLen);
-
-	size_t resultLen = uncompressed.size();
-#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED // use Lzma SDK for win
-	SizeT srcLen = compressedLen;
-	int uncompressRes = LzmaUncompress((uchar*)uncompressed.data(), &resultLen, (const uchar*)(compressed.constData() + hSize), &srcLen, (const uchar*)(compressed.constData() + hSigLen + hShaLen), LZMA_PROPS_SIZE);
-	if (uncompressRes != SZ_OK) {
-		LOG(("Update Error: could not uncompress lzma, code: %1").arg(uncompressRes));
-		return false;
-	}
-#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
-	lzma_stream stream = LZMA_STREAM_INIT;
-
-	lzma_ret ret = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
-	if (ret != LZMA_OK) {
-		const char *msg;
-		switch (ret) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
-		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
-		return false;
-	}
-
-	stream.avail_in = compressedLen;
-	stream.next_in = (uint8_t*)(compressed.constData() + hSize);
-	stream.avail_out = resultLen;
-	stream.next_out = (uint8_t*)uncompressed.data();
-
-	lzma_ret res = lzma_code(&stream, LZMA_FINISH);
-	if (stream.avail_in) {
-		LOG(("Error in decompression, %1 bytes left in _in of %2 whole.").arg(stream.avail_in).arg(compressedLen));
-		return false;
-	} else if (stream.avail_out) {
-		LOG(("Error in decompression, %1 bytes free left in _out of %2 whole.").arg(stream.avail_out).arg(resultLen));
+	if (!unpacked.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+		LOG(("Update Error: cant prepare unpacked update file!"));
 		return false;
-	}
-	lzma_end(&stream);
-	if (res != LZMA_OK && res != LZMA_STREAM_END) {
-		const char *msg;
-		switch (res) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
-		case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
-		case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+	} else if (!DecompressUpdatePackage(
+			verified,
+			unpacked,
+			header.mid(hSigLen + hShaLen, hPropsLen),
+			uncompressedLen)) {
 		return false;
 	}
-#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
 
 	tempDir.mkdir(tempDir.absolutePath());
 
-	quint32 version;
-	{
-		QDataStream stream(uncompressed);
-		stream.setVersion(QDataStream::Qt_5_1);
-
-		stream >> version;
-		if (stream.status() != QDataStream::Ok) {
-			LOG(("Update Error: cant read version from downloaded stream, status: %1").arg(stream.status()));
-			return false;
-		}
-
-		quint64 alphaVersion = 0;
+	const auto unpackedVersion = UnpackUpdateFiles(unpacked, tempDirPath, [](
+			UpdateVersion update) {
+		const auto version = update.version;
 		if (version == 0x7FFFFFFF) { // alpha version
-			stream >> alphaVersion;
-			if (stream.status() != QDataStream::Ok) {
-				LOG(("Update Error: cant read alpha version from downloaded stream, status: %1").arg(stream.status()));
-				return false;
-			}
-			if (!cAlphaVersion() || alphaVersion <= cAlphaVersion()) {
-				LOG(("Update Error: downloaded alpha version %1 is not greater, than mine %2").arg(alphaVersion).arg(cAlphaVersion()));
+			if (!cAlphaVersion() || update.alphaVersion <= cAlphaVersion()) {
+				LOG(("Update Error: downloaded alpha version %1 is not greater, than mine %2").arg(update.alphaVersion).arg(cAlphaVersion()));
 				return false;
 			}
 		} else if (PTGAcceptSameVersion && (int32(version) == GetAppVersionForUpdate())) {
@@ -508,82 +466,36 @@ bool UnpackUpdate(const QString &filepath) {
 			LOG(("Update Error: downloaded version %1 is not greater, than mine %2").arg(AppVersion).arg(AppVersion));
 			return false;
 		}
+		return true;
+	});
+	if (!unpackedVersion) {
+		return false;
+	}
+	const auto version = unpackedVersion->version;
+	const auto alphaVersion = unpackedVersion->alphaVersion;
 
-		quint32 filesCount;
-		stream >> filesCount;
-		if (stream.status() != QDataStream::Ok) {
-			LOG(("Update Error: cant read files count from downloaded stream, status: %1").arg(stream.status()));
-			return false;
-		}
-		if (!filesCount) {
-			LOG(("Update Error: update is empty!"));
-			return false;
-		}
-		for (uint32 i = 0; i < filesCount; ++i) {
-			QString relativeName;
-			quint32 fileSize;
-			QByteArray fileInnerData;
-			bool executable = false;
-
-			stream >> relativeName >> fileSize >> fileInnerData;
-#ifndef Q_OS_WIN
-			stream >> executable;
-#endif // !Q_OS_WIN
-			if (stream.status() != QDataStream::Ok) {
-				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
-				return false;
-			}
-			if (fileSize != quint32(fileInnerData.size())) {
-				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerData.size()));
-				return false;
-			}
-
-			QFile f(tempDirPath + '/' + relativeName);
-			if (!QDir().mkpath(QFileInfo(f).absolutePath())) {
-				LOG(("Update Error: cant mkpath for file '%1'").arg(tempDirPath + '/' + relativeName));
-				return false;
-			}
-			if (!f.open(QIODevice::WriteOnly)) {
-				LOG(("Update Error: cant open file '%1' for writing").arg(tempDirPath + '/' + relativeName));
-				return false;
-			}
-			auto writtenBytes = f.write(fileInnerData);
-			if (writtenBytes != fileSize) {
-				f.close();
-				LOG(("Update Error: cant write file '%1', desiredSize: %2, write result: %3").arg(tempDirPath + '/' + relativeName).arg(fileSize).arg(writtenBytes));
-				return false;
-			}
-			f.close();
-			if (executable) {
-				QFileDevice::Permissions p = f.permissions();
-				p |= QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther;
-				f.setPermissions(p);
-			}
-		}
-
-		// create tdata/version file
-		tempDir.mkdir(QDir(tempDirPath + u"/tdata"_q).absolutePath());
-		std::wstring versionString = FormatVersionDisplay(version).toStdWString();
+	// create tdata/version file
+	tempDir.mkdir(QDir(tempDirPath + u"/tdata"_q).absolutePath());
+	std::wstring versionString = FormatVersionDisplay(version).toStdWString();
 
-		const auto versionNum = VersionInt(version);
-		const auto versionLen = VersionInt(versionString.size() * sizeof(VersionChar));
-		VersionChar versionStr[32];
-		memcpy(versionStr, versionString.c_str(), versionLen);
+	const auto versionNum = VersionInt(version);
+	const auto versionLen = VersionInt(versionString.size() * sizeof(VersionChar));
+	VersionChar versionStr[32];
+	memcpy(versionStr, versionString.c_str(), versionLen);
 
-		QFile fVersion(tempDirPath + u"/tdata/version"_q);
-		if (!fVersion.open(QIODevice::WriteOnly)) {
-			LOG(("Update Error: cant write version file '%1'").arg(tempDirPath + u"/version"_q));
-			return false;
-		}
-		fVersion.write((const char*)&versionNum, sizeof(VersionInt));
-		if (versionNum == 0x7FFFFFFF) { // alpha version
-			fVersion.write((const char*)&alphaVersion, sizeof(quint64));
-		} else {
-			fVersion.write((const char*)&versionLen, sizeof(VersionInt));
-			fVersion.write((const char*)&versionStr[0], versionLen);
-		}
-		fVersion.close();
+	QFile fVersion(tempDirPath + u"/tdata/version"_q);
+	if (!fVersion.open(QIODevice::WriteOnly)) {
+		LOG(("Update Error: cant write version file '%1'").arg(tempDirPath + u"/version"_q));
+		return false;
+	}
+	fVersion.write((const char*)&versionNum, sizeof(VersionInt));
+	if (versionNum == 0x7FFFFFFF) { // alpha version
+		fVersion.write((const char*)&alphaVersion, sizeof(quint64));
+	} else {
+		fVersion.write((const char*)&versionLen, sizeof(VersionInt));
+		fVersion.write((const char*)&versionStr[0], versionLen);
 	}
+	fVersion.close();
 
 	QFile readyFile(readyFilePath);
 	if (readyFile.open(QIODevice::WriteOnly)) {
@@ -597,6 +509,7 @@ bool UnpackUpdate(const QString &filepath) {
 		LOG(("Update Error: cant create ready file '%1'").arg(readyFilePath));
 		return false;
 	}
+	ready = true;
 	input.remove();
 
 	return true;
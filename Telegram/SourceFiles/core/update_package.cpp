@@ -0,0 +1,359 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/update_package.h"
+
+#include "base/debug_log.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <range/v3/algorithm/find.hpp>
+
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+
+extern "C" {
+#include <openssl/sha.h>
+} // extern "C"
+
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED // use Lzma SDK for win
+#include <LzmaDec.h>
+#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+#include <lzma.h>
+#endif // else of Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+
+namespace Core {
+namespace {
+
+constexpr auto kUnpackChunkSize = 256 * 1024;
+
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED
+static_assert(kUpdatePropsSize == LZMA_PROPS_SIZE);
+
+void *LzmaAlloc(ISzAllocPtr, size_t size) {
+	return malloc(size);
+}
+
+void LzmaFree(ISzAllocPtr, void *address) {
+	free(address);
+}
+
+const auto kLzmaAlloc = ISzAlloc{ LzmaAlloc, LzmaFree };
+#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+
+[[nodiscard]] bool ReadUpdateBlock(QIODevice &from, char *to, qint64 size) {
+	while (size > 0) {
+		const auto read = from.read(to, size);
+		if (read <= 0) {
+			return false;
+		}
+		to += read;
+		size -= read;
+	}
+	return true;
+}
+
+[[nodiscard]] bool CopyUpdateFile(QIODevice &from, QFile &to, qint64 size) {
+	auto buffer = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	while (size > 0) {
+		const auto chunk = std::min(size, qint64(buffer.size()));
+		if (!ReadUpdateBlock(from, buffer.data(), chunk)
+			|| to.write(buffer.constData(), chunk) != chunk) {
+			return false;
+		}
+		size -= chunk;
+	}
+	return true;
+}
+
+} // namespace
+
+bool GoodUpdateFileName(const QString &name) {
+	if (name.isEmpty()
+		|| QDir::isAbsolutePath(name)
+		|| name.startsWith(QChar('/'))
+		|| name.startsWith(QChar('\\'))
+		|| name.contains(QChar(':'))) {
+		return false;
+	}
+	auto normalized = name;
+	normalized.replace(QChar('\\'), QChar('/'));
+	const auto parts = normalized.split(QChar('/'));
+	return ranges::find(parts, u".."_q) == parts.end();
+}
+
+bool CopyUpdatePackage(
+		QIODevice &input,
+		QFileDevice &copy,
+		const QByteArray &hashedPrefix,
+		uchar *sha1) {
+	auto sha = SHA_CTX();
+	SHA1_Init(&sha);
+	SHA1_Update(&sha, hashedPrefix.constData(), hashedPrefix.size());
+
+	auto buffer = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	while (true) {
+		const auto read = input.read(buffer.data(), buffer.size());
+		if (read < 0) {
+			LOG(("Update Error: cant read updates file!"));
+			return false;
+		} else if (!read) {
+			break;
+		}
+		SHA1_Update(&sha, buffer.constData(), read);
+		if (copy.write(buffer.constData(), read) != read) {
+			LOG(("Update Error: cant write the copy of updates file!"));
+			return false;
+		}
+	}
+	SHA1_Final(sha1, &sha);
+	return copy.flush() && copy.seek(0);
+}
+
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED
+bool DecompressUpdatePackage(
+		QIODevice &input,
+		QIODevice &output,
+		const QByteArray &props,
+		qint64 expectedSize) {
+	if (props.size() != LZMA_PROPS_SIZE) {
+		return false;
+	}
+	auto state = CLzmaDec();
+	LzmaDec_Construct(&state);
+	const auto allocated = LzmaDec_Allocate(
+		&state,
+		reinterpret_cast<const Byte*>(props.constData()),
+		LZMA_PROPS_SIZE,
+		&kLzmaAlloc);
+	if (allocated != SZ_OK) {
+		LOG(("Update Error: could not init lzma, code: %1").arg(allocated));
+		return false;
+	}
+	const auto guard = gsl::finally([&] {
+		LzmaDec_Free(&state, &kLzmaAlloc);
+	});
+	LzmaDec_Init(&state);
+
+	auto in = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	auto out = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	auto produced = qint64(0);
+	auto inSize = qint64(0);
+	auto inPosition = qint64(0);
+	while (produced < expectedSize) {
+		if (inPosition == inSize) {
+			inSize = input.read(in.data(), in.size());
+			inPosition = 0;
+			if (inSize < 0) {
+				LOG(("Update Error: cant read updates file!"));
+				return false;
+			}
+		}
+		auto outProcessed = SizeT(std::min(
+			qint64(out.size()),
+			expectedSize - produced));
+		auto inProcessed = SizeT(inSize - inPosition);
+		auto status = ELzmaStatus();
+		const auto result = LzmaDec_DecodeToBuf(
+			&state,
+			reinterpret_cast<Byte*>(out.data()),
+			&outProcessed,
+			reinterpret_cast<const Byte*>(in.constData() + inPosition),
+			&inProcessed,
+			LZMA_FINISH_ANY,
+			&status);
+		if (result != SZ_OK) {
+			LOG(("Update Error: could not uncompress lzma, code: %1"
+				).arg(result));
+			return false;
+		} else if (!inProcessed && !outProcessed) {
+			LOG(("Update Error: lzma data is truncated."));
+			return false;
+		}
+		inPosition += inProcessed;
+		produced += outProcessed;
+		const auto chunk = qint64(outProcessed);
+		if (output.write(out.constData(), chunk) != chunk) {
+			LOG(("Update Error: cant write unpacked update file!"));
+			return false;
+		}
+	}
+	return output.seek(0);
+}
+#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+bool DecompressUpdatePackage(
+		QIODevice &input,
+		QIODevice &output,
+		const QByteArray &props, // xz keeps everything in the stream.
+		qint64 expectedSize) {
+	if (!props.isEmpty()) {
+		return false;
+	}
+	lzma_stream stream = LZMA_STREAM_INIT;
+
+	lzma_ret ret = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
+	if (ret != LZMA_OK) {
+		const char *msg;
+		switch (ret) {
+		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
+		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
+		default: msg = "Unknown error, possibly a bug"; break;
+		}
+		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
+		return false;
+	}
+	const auto guard = gsl::finally([&] {
+		lzma_end(&stream);
+	});
+
+	auto in = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	auto out = QByteArray(kUnpackChunkSize, Qt::Uninitialized);
+	auto produced = qint64(0);
+	auto inputFinished = false;
+	auto res = LZMA_OK;
+	while (res == LZMA_OK) {
+		if (!stream.avail_in && !inputFinished) {
+			const auto read = input.read(in.data(), in.size());
+			if (read < 0) {
+				LOG(("Update Error: cant read updates file!"));
+				return false;
+			}
+			stream.next_in = reinterpret_cast<const uint8_t*>(in.constData());
+			stream.avail_in = size_t(read);
+			inputFinished = !read;
+		}
+		stream.next_out = reinterpret_cast<uint8_t*>(out.data());
+		stream.avail_out = size_t(out.size());
+		res = lzma_code(&stream, inputFinished ? LZMA_FINISH : LZMA_RUN);
+		const auto chunk = out.size() - qint64(stream.avail_out);
+		produced += chunk;
+		if (produced > expectedSize) {
+			break;
+		} else if (output.write(out.constData(), chunk) != chunk) {
+			LOG(("Update Error: cant write unpacked update file!"));
+			return false;
+		}
+	}
+	if (res != LZMA_OK && res != LZMA_STREAM_END) {
+		const char *msg;
+		switch (res) {
+		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+		case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
+		case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
+		case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
+		case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
+		default: msg = "Unknown error, possibly a bug"; break;
+		}
+		LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+		return false;
+	} else if (produced != expectedSize) {
+		LOG(("Error in decompression, %1 bytes produced of %2 whole."
+			).arg(produced
+			).arg(expectedSize));
+		return false;
+	} else if (stream.avail_in || !input.atEnd()) {
+		LOG(("Error in decompression, bytes left in _in."));
+		return false;
+	}
+	return output.seek(0);
+}
+#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+
+std::optional<UpdateVersion> UnpackUpdateFiles(
+		QIODevice &unpacked,
+		const QString &folder,
+		Fn<bool(UpdateVersion)> acceptVersion) {
+	QDataStream stream(&unpacked);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto result = UpdateVersion();
+	stream >> result.version;
+	if (stream.status() != QDataStream::Ok) {
+		LOG(("Update Error: cant read version from downloaded stream, status: %1").arg(stream.status()));
+		return std::nullopt;
+	}
+	if (result.version == 0x7FFFFFFF) { // alpha version
+		stream >> result.alphaVersion;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Update Error: cant read alpha version from downloaded stream, status: %1").arg(stream.status()));
+			return std::nullopt;
+		}
+	}
+	if (!acceptVersion(result)) {
+		return std::nullopt;
+	}
+
+	quint32 filesCount;
+	stream >> filesCount;
+	if (stream.status() != QDataStream::Ok) {
+		LOG(("Update Error: cant read files count from downloaded stream, status: %1").arg(stream.status()));
+		return std::nullopt;
+	}
+	if (!filesCount) {
+		LOG(("Update Error: update is empty!"));
+		return std::nullopt;
+	}
+	for (uint32 i = 0; i < filesCount; ++i) {
+		QString relativeName;
+		quint32 fileSize;
+		quint32 fileInnerSize; // QByteArray length prefix.
+		bool executable = false;
+
+		stream >> relativeName >> fileSize >> fileInnerSize;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
+			return std::nullopt;
+		}
+		if (!GoodUpdateFileName(relativeName)) {
+			LOG(("Update Error: bad file name '%1'").arg(relativeName));
+			return std::nullopt;
+		}
+		if (fileInnerSize == 0xFFFFFFFFU) { // null QByteArray
+			fileInnerSize = 0;
+		}
+		if (fileSize != fileInnerSize) {
+			LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerSize));
+			return std::nullopt;
+		}
+
+		QFile f(folder + '/' + relativeName);
+		if (!QDir().mkpath(QFileInfo(f).absolutePath())) {
+			LOG(("Update Error: cant mkpath for file '%1'").arg(folder + '/' + relativeName));
+			return std::nullopt;
+		}
+		if (!f.open(QIODevice::WriteOnly)) {
+			LOG(("Update Error: cant open file '%1' for writing").arg(folder + '/' + relativeName));
+			return std::nullopt;
+		}
+		if (!CopyUpdateFile(unpacked, f, fileSize)) {
+			f.close();
+			LOG(("Update Error: cant write file '%1', desiredSize: %2").arg(folder + '/' + relativeName).arg(fileSize));
+			return std::nullopt;
+		}
+		f.close();
+#ifndef Q_OS_WIN
+		stream >> executable;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
+			return std::nullopt;
+		}
+#endif // !Q_OS_WIN
+		if (executable) {
+			QFileDevice::Permissions p = f.permissions();
+			p |= QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther;
+			f.setPermissions(p);
+		}
+	}
+	return result;
+}
+
+} // namespace Core
+
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
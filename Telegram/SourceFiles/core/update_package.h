@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <optional>
+
+class QIODevice;
+class QFileDevice;
+
+namespace Core {
+
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+
+// Lzma SDK packages keep the LZMA_PROPS_SIZE bytes of props in the header.
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED
+inline constexpr auto kUpdatePropsSize = 5;
+#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+inline constexpr auto kUpdatePropsSize = 0;
+#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+
+struct UpdateVersion {
+	quint32 version = 0;
+	quint64 alphaVersion = 0;
+};
+
+// Only plain relative paths inside the unpack folder are allowed.
+[[nodiscard]] bool GoodUpdateFileName(const QString &name);
+
+// Copies the rest of the input to a private file, hashing the prefix and
+// all the copied bytes, so the signature is checked for the exact bytes
+// that are going to be unpacked later.
+[[nodiscard]] bool CopyUpdatePackage(
+	QIODevice &input,
+	QFileDevice &copy,
+	const QByteArray &hashedPrefix,
+	uchar *sha1);
+
+// Decompresses chunk by chunk, the result must have exactly that size.
+[[nodiscard]] bool DecompressUpdatePackage(
+	QIODevice &input,
+	QIODevice &output,
+	const QByteArray &props,
+	qint64 expectedSize);
+
+// Reads the version and the files of the unpacked package and writes
+// the files to the folder, if acceptVersion allows that version.
+[[nodiscard]] std::optional<UpdateVersion> UnpackUpdateFiles(
+	QIODevice &unpacked,
+	const QString &folder,
+	Fn<bool(UpdateVersion)> acceptVersion);
+
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
+
+} // namespace Core
@@ -10,6 +10,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 
 namespace Data {
+namespace {
+
+constexpr auto kClearUnusedStreamsMin = 64;
+
+} // namespace
 
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::updated(
@@ -23,7 +28,7 @@ void Changes::Manager<DataType, UpdateType>::updated(
 			flags |= i->second;
 			_updates.erase(i);
 		}
-		_stream.fire({ data, flags });
+		fire(data, flags);
 	} else {
 		_updates[data] |= flags;
 	}
@@ -41,6 +46,72 @@ void Changes::Manager<DataType, UpdateType>::sendRealtimeNotifications(
 	}
 }
 
+// Subscribers of a single object get the update before the subscribers
+// of all updates. Within each stream the subscription order is kept.
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::fire(
+		not_null<DataType*> data,
+		Flags flags) {
+	++_firing;
+	++_fanOut.updates;
+	if (const auto i = _dataStreams.find(data); i != end(_dataStreams)) {
+		const auto value = static_cast<uint64>(flags);
+
+		// Streams may be added while we fire, std::map keeps iterators.
+		for (auto &[mask, stream] : i->second) {
+			if (value & mask) {
+				++_fanOut.keyedStreams;
+				stream.fire({ data, flags });
+			}
+		}
+	}
+	_stream.fire({ data, flags });
+	--_firing;
+}
+
+template <typename DataType, typename UpdateType>
+bool Changes::Manager<DataType, UpdateType>::clearUnused(
+		FlagsStreams &streams) {
+	for (auto i = begin(streams); i != end(streams);) {
+		if (i->second.has_consumers()) {
+			++i;
+		} else {
+			i = streams.erase(i);
+		}
+	}
+	return streams.empty();
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::clearUnusedStreams() {
+	// Streams can't be destroyed while they fire, so it is done here,
+	// once the map grows twice since the previous clearing.
+	const auto size = int(_dataStreams.size());
+	const auto threshold = std::max(
+		2 * _dataStreamsClearedSize,
+		kClearUnusedStreamsMin);
+	if (_firing || size < threshold) {
+		return;
+	}
+	for (auto i = begin(_dataStreams); i != end(_dataStreams);) {
+		if (clearUnused(i->second)) {
+			i = _dataStreams.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_dataStreamsClearedSize = int(_dataStreams.size());
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::addFanOut(FanOut &to) const {
+	to.updates += _fanOut.updates;
+	to.keyedStreams += _fanOut.keyedStreams;
+	for (const auto &[data, streams] : _dataStreams) {
+		to.streams += int(streams.size());
+	}
+}
+
 template <typename DataType, typename UpdateType>
 rpl::producer<UpdateType> Changes::Manager<DataType, UpdateType>::updates(
 		Flags flags) const {
@@ -54,10 +125,10 @@ template <typename DataType, typename UpdateType>
 rpl::producer<UpdateType> Changes::Manager<DataType, UpdateType>::updates(
 		not_null<DataType*> data,
 		Flags flags) const {
-	return _stream.events(
-	) | rpl::filter([=](const UpdateType &update) {
-		const auto &[updateData, updateFlags] = update;
-		return (updateData == data) && (updateFlags & flags);
+	// The stream is found only when the producer is started, so that it
+	// can't be cleared as unused between creating and starting it.
+	return rpl::deferred([=] {
+		return _dataStreams[data][static_cast<uint64>(flags)].events();
 	});
 }
 
@@ -79,13 +150,20 @@ rpl::producer<UpdateType> Changes::Manager<DataType, UpdateType>::flagsValue(
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::drop(not_null<DataType*> data) {
 	_updates.remove(data);
+	if (!_firing) {
+		const auto i = _dataStreams.find(data);
+		if (i != end(_dataStreams) && clearUnused(i->second)) {
+			_dataStreams.erase(i);
+		}
+	}
 }
 
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::sendNotifications() {
 	for (const auto &[data, flags] : base::take(_updates)) {
-		_stream.fire({ data, flags });
+		fire(data, flags);
 	}
+	clearUnusedStreams();
 }
 
 Changes::Changes(not_null<Main::Session*> session) : _session(session) {
@@ -95,6 +173,18 @@ Main::Session &Changes::session() const {
 	return *_session;
 }
 
+Changes::FanOut Changes::fanOut() const {
+	auto result = FanOut();
+	_peerChanges.addFanOut(result);
+	_historyChanges.addFanOut(result);
+	_topicChanges.addFanOut(result);
+	_sublistChanges.addFanOut(result);
+	_messageChanges.addFanOut(result);
+	_entryChanges.addFanOut(result);
+	_storyChanges.addFanOut(result);
+	return result;
+}
+
 void Changes::nameUpdated(
 		not_null<PeerData*> peer,
 		base::flat_set<QChar> oldFirstLetters) {
@@ -419,6 +419,14 @@ public:
 
 	void sendNotifications();
 
+	// Delivery counters, summed over all kinds of updates.
+	struct FanOut {
+		int64 updates = 0; // Updates sent after a change.
+		int64 keyedStreams = 0; // Per object and flags streams fired.
+		int streams = 0; // Per object and flags streams alive now.
+	};
+	[[nodiscard]] FanOut fanOut() const;
+
 private:
 	template <typename DataType, typename UpdateType>
 	class Manager final {
@@ -444,17 +452,36 @@ private:
 
 		void sendNotifications();
 
+		void addFanOut(FanOut &to) const;
+
 	private:
 		static constexpr auto kCount = details::CountBit<Flag>() + 1;
 
+		// Keyed by the subscribed flags mask.
+		using FlagsStreams = std::map<uint64, rpl::event_stream<UpdateType>>;
+
 		void sendRealtimeNotifications(
 			not_null<DataType*> data,
 			Flags flags);
+		void fire(not_null<DataType*> data, Flags flags);
+		void clearUnusedStreams();
+
+		// Returns true if no streams are left.
+		static bool clearUnused(FlagsStreams &streams);
 
 		std::array<rpl::event_stream<UpdateType>, kCount> _realtimeStreams;
 		base::flat_map<not_null<DataType*>, Flags> _updates;
 		rpl::event_stream<UpdateType> _stream;
 
+		// Subscribers of a single object don't see updates of the others,
+		// or updates with flags they are not interested in.
+		mutable std::unordered_map<
+			not_null<DataType*>,
+			FlagsStreams> _dataStreams;
+		int _dataStreamsClearedSize = 0;
+		int _firing = 0;
+		FanOut _fanOut;
+
 	};
 
 	void scheduleNotifications();
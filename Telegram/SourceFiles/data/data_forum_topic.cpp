@@ -792,6 +792,7 @@ void ForumTopic::applyTitle(const QString &title) {
 	invalidateTitleWithIcon();
 	_defaultIcon = QImage();
 	indexTitleParts();
+	_forum->topicsList()->indexed()->nameWordsChanged(this);
 	updateChatListEntry();
 	session().changes().topicUpdated(this, UpdateFlag::Title);
 }
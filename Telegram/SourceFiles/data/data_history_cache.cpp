@@ -0,0 +1,149 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_history_cache.h"
+
+#include "data/data_session.h"
+#include "main/main_session.h"
+#include "storage/storage_account.h"
+#include "storage/cache/storage_cache_database.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kEnabledPref = "history_cache"_cs;
+constexpr auto kSerializeVersion = mtpPrime(1);
+
+[[nodiscard]] QByteArray Serialize(const MTPmessages_Messages &result) {
+	auto buffer = mtpBuffer();
+	buffer.push_back(kSerializeVersion);
+	buffer.push_back(mtpPrime(AppVersion));
+	result.write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.data()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+// Layer changes between versions make old data unreadable, drop it.
+[[nodiscard]] std::optional<MTPmessages_Messages> Deserialize(
+		const QByteArray &bytes) {
+	const auto size = bytes.size() / int(sizeof(mtpPrime));
+	if (size < 3) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(bytes.constData());
+	const auto till = from + size;
+	if (*from++ != kSerializeVersion || *from++ != mtpPrime(AppVersion)) {
+		return std::nullopt;
+	}
+	auto result = MTPmessages_Messages();
+	if (!result.read(from, till) || from != till) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+[[nodiscard]] PeerId ChatPeerId(const MTPChat &chat) {
+	return chat.match([](const MTPDchannel &data) {
+		return peerFromChannel(data.vid());
+	}, [](const MTPDchannelForbidden &data) {
+		return peerFromChannel(data.vid());
+	}, [](const auto &data) {
+		return peerFromChat(data.vid());
+	});
+}
+
+} // namespace
+
+HistoryCache::HistoryCache(not_null<Main::Session*> session)
+: _session(session) {
+}
+
+bool HistoryCache::enabled() const {
+	if (!_enabled) {
+		_enabled = _session->local().readPref<bool>(kEnabledPref);
+	}
+	return *_enabled;
+}
+
+void HistoryCache::setEnabled(bool enabled) {
+	if (this->enabled() == enabled) {
+		return;
+	}
+	_enabled = enabled;
+	_session->local().writePref<bool>(kEnabledPref, enabled);
+	if (!enabled) {
+		_session->data().cache().clearByTag(kHistoryCacheTag);
+	}
+}
+
+void HistoryCache::save(PeerId peerId, const MTPmessages_Messages &result) {
+	if (!enabled()
+		|| result.type() == mtpc_messages_messagesNotModified) {
+		return;
+	}
+	_session->data().cache().put(
+		HistoryCacheKey(peerId),
+		Storage::Cache::Database::TaggedValue(
+			Serialize(result),
+			kHistoryCacheTag));
+}
+
+void HistoryCache::load(
+		PeerId peerId,
+		Fn<void(MTPmessages_Messages)> done) {
+	if (!enabled()) {
+		return;
+	}
+	const auto weak = base::make_weak(_session);
+	_session->data().cache().get(HistoryCacheKey(peerId), [=](
+			QByteArray value) {
+		// Parse on the cache thread, it may take a while for big pages.
+		auto result = Deserialize(value);
+		if (!result) {
+			return;
+		}
+		crl::on_main(weak, [=, result = std::move(*result)]() mutable {
+			done(std::move(result));
+		});
+	});
+}
+
+void HistoryCache::remove(PeerId peerId) {
+	_session->data().cache().remove(HistoryCacheKey(peerId));
+}
+
+const QVector<MTPMessage> &HistoryCache::applyPeers(
+		const MTPmessages_Messages &cached) {
+	static const auto kEmpty = QVector<MTPMessage>();
+	const auto owner = &_session->data();
+	return cached.match([](const MTPDmessages_messagesNotModified &)
+			-> const QVector<MTPMessage>& {
+		return kEmpty;
+	}, [&](const auto &data) -> const QVector<MTPMessage>& {
+		auto users = QVector<MTPUser>();
+		for (const auto &user : data.vusers().v) {
+			const auto peerId = user.match([](const auto &data) {
+				return peerFromUser(data.vid());
+			});
+			if (!owner->peerLoaded(peerId)) {
+				users.push_back(user);
+			}
+		}
+		auto chats = QVector<MTPChat>();
+		for (const auto &chat : data.vchats().v) {
+			if (!owner->peerLoaded(ChatPeerId(chat))) {
+				chats.push_back(chat);
+			}
+		}
+		owner->processUsers(MTP_vector<MTPUser>(std::move(users)));
+		owner->processChats(MTP_vector<MTPChat>(std::move(chats)));
+		return data.vmessages().v;
+	});
+}
+
+} // namespace Data
@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Data {
+
+// Opt-in copy of the latest history page of every opened chat, stored in
+// the session cache database, so it shares its encryption, size and time
+// limits and is wiped together with it. A chat opened after a restart can
+// be shown from it while the same page is requested from the server.
+class HistoryCache final {
+public:
+	explicit HistoryCache(not_null<Main::Session*> session);
+
+	[[nodiscard]] bool enabled() const;
+	void setEnabled(bool enabled);
+
+	void save(PeerId peerId, const MTPmessages_Messages &result);
+	void load(PeerId peerId, Fn<void(MTPmessages_Messages)> done);
+	void remove(PeerId peerId);
+
+	// Applies only the users and chats we don't know yet, cached data
+	// must not overwrite fresher ones. Returns the cached messages.
+	[[nodiscard]] const QVector<MTPMessage> &applyPeers(
+		const MTPmessages_Messages &cached);
+
+private:
+	const not_null<Main::Session*> _session;
+
+	mutable std::optional<bool> _enabled;
+
+};
+
+} // namespace Data
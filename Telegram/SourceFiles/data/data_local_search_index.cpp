@@ -0,0 +1,249 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_local_search_index.h"
+
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+#include "storage/storage_account.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kEnabledPref = "local_search_index"_cs;
+constexpr auto kWriteDelay = 10 * crl::time(1000);
+constexpr auto kKeepLoadedPeers = 16;
+
+} // namespace
+
+LocalSearchIndex::LocalSearchIndex(not_null<Main::Session*> session)
+: _session(session)
+, _writeTimer([=] { writeChanged(); }) {
+}
+
+LocalSearchIndex::~LocalSearchIndex() = default;
+
+bool LocalSearchIndex::enabled() const {
+	if (!_enabled) {
+		_enabled = _session->local().readPref<bool>(kEnabledPref);
+	}
+	return *_enabled;
+}
+
+void LocalSearchIndex::setEnabled(bool enabled) {
+	if (this->enabled() == enabled) {
+		return;
+	}
+	_enabled = enabled;
+	_session->local().writePref<bool>(kEnabledPref, enabled);
+	if (!enabled) {
+		purge();
+	}
+}
+
+void LocalSearchIndex::add(not_null<HistoryItem*> item) {
+	if (enabled()) {
+		addItem(item);
+	}
+}
+
+void LocalSearchIndex::add(const std::vector<not_null<HistoryItem*>> &items) {
+	if (enabled()) {
+		for (const auto &item : items) {
+			addItem(item);
+		}
+	}
+}
+
+void LocalSearchIndex::addItem(not_null<HistoryItem*> item) {
+	if (!item->isRegular() || item->isService()) {
+		return;
+	}
+	const auto &text = item->originalText().text;
+	if (text.isEmpty()) {
+		return;
+	}
+	auto &index = peerIndex(item->history()->peer->id);
+	if (LocalSearch::AddWords(index.words, item->id, text)) {
+		index.sorted.clear();
+	}
+	scheduleWrite(index);
+}
+
+void LocalSearchIndex::remove(PeerId peerId, const std::vector<MsgId> &ids) {
+	if (!enabled()
+		|| ids.empty()
+		|| (!_peers.contains(peerId)
+			&& !_session->local().hasLocalSearchIndex(peerId))) {
+		return;
+	}
+	auto sorted = ids;
+	ranges::sort(sorted);
+
+	auto &index = peerIndex(peerId);
+	if (index.loadId) {
+		auto &removed = index.removedWhileLoading;
+		removed.insert(end(removed), begin(sorted), end(sorted));
+	}
+	if (LocalSearch::RemoveIds(index.words, sorted)) {
+		index.sorted.clear();
+	}
+	scheduleWrite(index);
+}
+
+void LocalSearchIndex::search(
+		PeerId peerId,
+		const QString &query,
+		int limit,
+		Fn<void(std::vector<MsgId>)> done) {
+	const auto words = LocalSearch::PrepareWords(query);
+	if (!enabled()
+		|| words.isEmpty()
+		|| limit <= 0
+		|| (!_peers.contains(peerId)
+			&& !_session->local().hasLocalSearchIndex(peerId))) {
+		done({});
+		return;
+	}
+	auto &index = peerIndex(peerId);
+	if (index.loadId) {
+		index.whenLoaded.push_back([=] {
+			search(peerId, query, limit, done);
+		});
+		return;
+	}
+	if (index.sorted.empty() && !index.words.empty()) {
+		index.sorted = LocalSearch::SortedWords(index.words);
+	}
+	done(LocalSearch::Search(index.words, index.sorted, words, limit));
+}
+
+void LocalSearchIndex::purge(PeerId peerId) {
+	auto callbacks = std::vector<Fn<void()>>();
+	if (const auto i = _peers.find(peerId); i != end(_peers)) {
+		callbacks = base::take(i->second.whenLoaded);
+		_peers.erase(i);
+	}
+	if (_session->local().hasLocalSearchIndex(peerId)) {
+		_session->local().writeLocalSearchIndex(peerId, QByteArray());
+	}
+	// Searches waiting for the index find nothing now.
+	for (const auto &callback : callbacks) {
+		callback();
+	}
+}
+
+void LocalSearchIndex::purge() {
+	_writeTimer.cancel();
+	auto callbacks = std::vector<Fn<void()>>();
+	for (auto &[peerId, index] : base::take(_peers)) {
+		callbacks.insert(
+			end(callbacks),
+			std::make_move_iterator(begin(index.whenLoaded)),
+			std::make_move_iterator(end(index.whenLoaded)));
+	}
+	_session->local().clearLocalSearchIndex();
+	for (const auto &callback : callbacks) {
+		callback();
+	}
+}
+
+LocalSearchIndex::PeerIndex &LocalSearchIndex::peerIndex(PeerId peerId) {
+	auto i = _peers.find(peerId);
+	if (i == end(_peers)) {
+		i = _peers.emplace(peerId, PeerIndex()).first;
+		if (_session->local().hasLocalSearchIndex(peerId)) {
+			const auto loadId = i->second.loadId = ++_loadId;
+			const auto weak = base::make_weak(this);
+			_session->local().readLocalSearchIndex(peerId, [=](
+					QByteArray serialized) {
+				auto words = LocalSearch::Deserialize(serialized);
+				crl::on_main(weak, [=, words = std::move(words)]() mutable {
+					loaded(peerId, loadId, std::move(words));
+				});
+			});
+		}
+	}
+	i->second.lastUsed = crl::now();
+	return i->second;
+}
+
+void LocalSearchIndex::loaded(
+		PeerId peerId,
+		uint64 loadId,
+		LocalSearch::WordsMap &&words) {
+	const auto i = _peers.find(peerId);
+	if (i == end(_peers) || i->second.loadId != loadId) {
+		return;
+	}
+	auto &index = i->second;
+	auto removed = base::take(index.removedWhileLoading);
+	ranges::sort(removed);
+	removed.erase(ranges::unique(removed), end(removed));
+	LocalSearch::RemoveIds(words, removed);
+	LocalSearch::Merge(words, index.words);
+	index.words = std::move(words);
+	index.sorted.clear();
+	index.loadId = 0;
+	if (index.changed) {
+		scheduleWrite(index);
+	}
+	for (const auto &callback : base::take(index.whenLoaded)) {
+		callback();
+	}
+}
+
+void LocalSearchIndex::scheduleWrite(PeerIndex &index) {
+	index.changed = true;
+	if (!_writeTimer.isActive()) {
+		_writeTimer.callOnce(kWriteDelay);
+	}
+}
+
+void LocalSearchIndex::writeChanged() {
+	_writeTimer.cancel();
+	for (auto &[peerId, index] : _peers) {
+		// Written after loading, otherwise the saved words would be lost.
+		if (index.changed && !index.loadId) {
+			index.changed = false;
+			_session->local().writeLocalSearchIndex(
+				peerId,
+				LocalSearch::Serialize(index.words));
+		}
+	}
+	unloadUnused();
+}
+
+void LocalSearchIndex::discardChanged() {
+	_writeTimer.cancel();
+	_peers.clear();
+}
+
+void LocalSearchIndex::unloadUnused() {
+	if (_peers.size() <= kKeepLoadedPeers) {
+		return;
+	}
+	auto times = std::vector<crl::time>();
+	times.reserve(_peers.size());
+	for (const auto &[peerId, index] : _peers) {
+		times.push_back(index.lastUsed);
+	}
+	const auto border = begin(times) + (times.size() - kKeepLoadedPeers);
+	ranges::nth_element(times, border);
+	const auto minUsed = *border;
+	for (auto i = begin(_peers); i != end(_peers);) {
+		const auto &index = i->second;
+		if (!index.changed && !index.loadId && index.lastUsed < minUsed) {
+			i = _peers.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+} // namespace Data
@@ -0,0 +1,86 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+#include "base/weak_ptr.h"
+#include "data/data_local_search_words.h"
+
+class HistoryItem;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Data {
+
+// Opt-in inverted index of message texts, one per peer. Every peer index
+// is kept in its own file in Storage::Account, encrypted with the local
+// key, and is loaded only when the peer gets new messages or is searched.
+// Loading happens in the background, changes made meanwhile are merged.
+// Results are only a fast preview, the server search stays the source of
+// truth. Edited messages are reindexed, so old words don't stay behind.
+class LocalSearchIndex final : public base::has_weak_ptr {
+public:
+	explicit LocalSearchIndex(not_null<Main::Session*> session);
+	~LocalSearchIndex();
+
+	[[nodiscard]] bool enabled() const;
+	void setEnabled(bool enabled);
+
+	void add(not_null<HistoryItem*> item);
+	void add(const std::vector<not_null<HistoryItem*>> &items);
+	void remove(PeerId peerId, const std::vector<MsgId> &ids);
+
+	// Newest first, every query word must be a prefix of some text word.
+	// Called right away, unless the peer index is not loaded yet.
+	void search(
+		PeerId peerId,
+		const QString &query,
+		int limit,
+		Fn<void(std::vector<MsgId>)> done);
+
+	void purge(PeerId peerId);
+	void purge();
+
+	void writeChanged();
+
+	// Forgets not yet written changes, used when the account data is
+	// about to be removed and nothing should be written anymore.
+	void discardChanged();
+
+private:
+	struct PeerIndex {
+		LocalSearch::WordsMap words;
+		std::vector<QString> sorted;
+		crl::time lastUsed = 0;
+
+		// While the saved index is loading words has only the new ones.
+		uint64 loadId = 0;
+		std::vector<MsgId> removedWhileLoading;
+		std::vector<Fn<void()>> whenLoaded;
+
+		bool changed = false;
+	};
+
+	[[nodiscard]] PeerIndex &peerIndex(PeerId peerId);
+	void loaded(PeerId peerId, uint64 loadId, LocalSearch::WordsMap &&words);
+	void addItem(not_null<HistoryItem*> item);
+	void scheduleWrite(PeerIndex &index);
+	void unloadUnused();
+
+	const not_null<Main::Session*> _session;
+
+	base::flat_map<PeerId, PeerIndex> _peers;
+	uint64 _loadId = 0;
+	base::Timer _writeTimer;
+	mutable std::optional<bool> _enabled;
+
+};
+
+} // namespace Data
@@ -0,0 +1,210 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_local_search_words.h"
+
+#include "base/debug_log.h"
+#include "ui/text/text_entity.h"
+
+#include <QtCore/QDataStream>
+
+#include <range/v3/algorithm/binary_search.hpp>
+#include <range/v3/algorithm/is_sorted.hpp>
+#include <range/v3/algorithm/lower_bound.hpp>
+#include <range/v3/algorithm/remove_if.hpp>
+#include <range/v3/algorithm/reverse.hpp>
+#include <range/v3/algorithm/set_algorithm.hpp>
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/algorithm/unique.hpp>
+
+namespace Data::LocalSearch {
+namespace {
+
+constexpr auto kMaxWordLength = 32;
+constexpr auto kSerializeVersion = qint32(1);
+
+void InsertSorted(std::vector<MsgId> &list, MsgId id) {
+	// Messages mostly arrive in order, either newer or older than all.
+	if (list.empty() || list.back() < id) {
+		list.push_back(id);
+	} else if (list.front() > id) {
+		list.insert(begin(list), id);
+	} else if (const auto i = ranges::lower_bound(list, id); *i != id) {
+		list.insert(i, id);
+	}
+}
+
+} // namespace
+
+QStringList PrepareWords(const QString &text) {
+	auto result = TextUtilities::PrepareSearchWords(text);
+	for (auto &word : result) {
+		if (word.size() > kMaxWordLength) {
+			word.truncate(kMaxWordLength);
+		}
+	}
+	return result;
+}
+
+bool AddWords(WordsMap &words, MsgId id, const QString &text) {
+	auto result = false;
+	for (const auto &word : PrepareWords(text)) {
+		const auto [i, added] = words.try_emplace(word);
+		if (added) {
+			result = true;
+		}
+		InsertSorted(i->second, id);
+	}
+	return result;
+}
+
+bool RemoveIds(WordsMap &words, const std::vector<MsgId> &ids) {
+	Expects(ranges::is_sorted(ids));
+
+	const auto removed = [&](MsgId id) {
+		return ranges::binary_search(ids, id);
+	};
+	auto result = false;
+	for (auto i = begin(words); i != end(words);) {
+		auto &list = i->second;
+		list.erase(ranges::remove_if(list, removed), end(list));
+		if (list.empty()) {
+			i = words.erase(i);
+			result = true;
+		} else {
+			++i;
+		}
+	}
+	return result;
+}
+
+bool Merge(WordsMap &words, const WordsMap &other) {
+	auto result = false;
+	auto merged = std::vector<MsgId>();
+	for (const auto &[word, list] : other) {
+		const auto [i, added] = words.try_emplace(word, list);
+		if (added) {
+			result = true;
+			continue;
+		}
+		merged.clear();
+		ranges::set_union(i->second, list, back_inserter(merged));
+		std::swap(i->second, merged);
+	}
+	return result;
+}
+
+std::vector<QString> SortedWords(const WordsMap &words) {
+	auto result = std::vector<QString>();
+	result.reserve(words.size());
+	for (const auto &[word, list] : words) {
+		result.push_back(word);
+	}
+	ranges::sort(result);
+	return result;
+}
+
+std::vector<MsgId> Search(
+		const WordsMap &words,
+		const std::vector<QString> &sorted,
+		const QStringList &query,
+		int limit) {
+	if (query.isEmpty() || limit <= 0) {
+		return {};
+	}
+	auto result = std::vector<MsgId>();
+	auto matched = std::vector<MsgId>();
+	auto both = std::vector<MsgId>();
+	for (auto i = 0, count = int(query.size()); i != count; ++i) {
+		const auto &word = query[i];
+		matched.clear();
+		const auto till = end(sorted);
+		for (auto j = ranges::lower_bound(sorted, word)
+			; (j != till) && j->startsWith(word)
+			; ++j) {
+			const auto k = words.find(*j);
+			if (k != end(words)) {
+				const auto &list = k->second;
+				matched.insert(end(matched), begin(list), end(list));
+			}
+		}
+		ranges::sort(matched);
+		matched.erase(ranges::unique(matched), end(matched));
+		if (!i) {
+			std::swap(result, matched);
+		} else {
+			both.clear();
+			ranges::set_intersection(result, matched, back_inserter(both));
+			std::swap(result, both);
+		}
+		if (result.empty()) {
+			return {};
+		}
+	}
+	if (int(result.size()) > limit) {
+		result.erase(begin(result), end(result) - limit);
+	}
+	ranges::reverse(result);
+	return result;
+}
+
+QByteArray Serialize(const WordsMap &words) {
+	if (words.empty()) {
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << kSerializeVersion << quint32(words.size());
+		for (const auto &[word, list] : words) {
+			stream << word << quint32(list.size());
+			for (const auto id : list) {
+				stream << qint64(id.bare);
+			}
+		}
+	}
+	return result;
+}
+
+WordsMap Deserialize(const QByteArray &serialized) {
+	if (serialized.isEmpty()) {
+		return {};
+	}
+	auto stream = QDataStream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto version = qint32();
+	auto count = quint32();
+	stream >> version >> count;
+	if (stream.status() != QDataStream::Ok || version != kSerializeVersion) {
+		return {};
+	}
+	auto result = WordsMap();
+	for (auto i = quint32()
+		; (i != count) && (stream.status() == QDataStream::Ok)
+		; ++i) {
+		auto word = QString();
+		auto size = quint32();
+		stream >> word >> size;
+		auto &list = result[word];
+		for (auto j = quint32()
+			; (j != size) && (stream.status() == QDataStream::Ok)
+			; ++j) {
+			auto id = qint64();
+			stream >> id;
+			list.push_back(MsgId(id));
+		}
+	}
+	if (stream.status() != QDataStream::Ok) {
+		LOG(("App Error: Bad local search index data."));
+		return {};
+	}
+	return result;
+}
+
+} // namespace Data::LocalSearch
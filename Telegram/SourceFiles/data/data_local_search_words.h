@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "data/data_msg_id.h"
+
+#include <unordered_map>
+
+namespace Data::LocalSearch {
+
+// Every word maps to the ascending ids of the messages that have it.
+using WordsMap = std::unordered_map<QString, std::vector<MsgId>>;
+
+[[nodiscard]] QStringList PrepareWords(const QString &text);
+
+// Returns true if a new word was added.
+bool AddWords(WordsMap &words, MsgId id, const QString &text);
+
+// Returns true if some word was removed, ids should be sorted.
+bool RemoveIds(WordsMap &words, const std::vector<MsgId> &ids);
+
+// Adds all the ids of the other map, returns true if a word was added.
+bool Merge(WordsMap &words, const WordsMap &other);
+
+// Sorted keys of the map, search() looks up word prefixes in them.
+[[nodiscard]] std::vector<QString> SortedWords(const WordsMap &words);
+
+// Newest first, every query word must be a prefix of some text word.
+[[nodiscard]] std::vector<MsgId> Search(
+	const WordsMap &words,
+	const std::vector<QString> &sorted,
+	const QStringList &query,
+	int limit);
+
+[[nodiscard]] QByteArray Serialize(const WordsMap &words);
+[[nodiscard]] WordsMap Deserialize(const QByteArray &serialized);
+
+} // namespace Data::LocalSearch
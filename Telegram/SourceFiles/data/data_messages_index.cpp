@@ -0,0 +1,216 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_index.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMinCapacity = uint32(64);
+
+// Rehash when the table is 3/4 full.
+constexpr auto kMaxLoadNumerator = 3;
+constexpr auto kMaxLoadDenominator = 4;
+
+} // namespace
+
+uint32 MessagesIndex::Hash(PeerId peerId, MsgId msgId) {
+	auto result = (peerId.value * 0x9E3779B97F4A7C15ULL)
+		^ uint64(msgId.bare);
+	result ^= (result >> 33);
+	result *= 0xFF51AFD7ED558CCDULL;
+	result ^= (result >> 33);
+	result *= 0xC4CEB9FE1A85EC53ULL;
+	result ^= (result >> 33);
+	return uint32(result);
+}
+
+HistoryItem *MessagesIndex::find(PeerId peerId, MsgId msgId) const {
+	const auto bucket = findBucket(peerId, msgId, Hash(peerId, msgId));
+	return (bucket != kNone)
+		? _entries[_buckets[bucket].entry].item
+		: nullptr;
+}
+
+HistoryItem *MessagesIndex::insert(
+		PeerId peerId,
+		MsgId msgId,
+		not_null<HistoryItem*> item) {
+	const auto hash = Hash(peerId, msgId);
+	if (const auto bucket = findBucket(peerId, msgId, hash)
+		; bucket != kNone) {
+		auto &entry = _entries[_buckets[bucket].entry];
+		return std::exchange(entry.item, item.get());
+	}
+	const auto capacity = uint32(_buckets.size());
+	if (uint32(_size + 1) * kMaxLoadDenominator
+		> capacity * kMaxLoadNumerator) {
+		rehash(std::max(capacity * 2, kMinCapacity));
+	}
+	const auto index = allocateEntry();
+	auto &entry = _entries[index];
+	entry.peerId = peerId;
+	entry.msgId = msgId;
+	entry.item = item.get();
+	linkEntry(index);
+	placeBucket(index, hash);
+	++_size;
+	return nullptr;
+}
+
+HistoryItem *MessagesIndex::remove(PeerId peerId, MsgId msgId) {
+	const auto bucket = findBucket(peerId, msgId, Hash(peerId, msgId));
+	if (bucket == kNone) {
+		return nullptr;
+	}
+	const auto index = _buckets[bucket].entry;
+	const auto result = std::exchange(_entries[index].item, nullptr);
+	eraseBucket(bucket);
+	unlinkEntry(index);
+	_freeEntries.push_back(index);
+	--_size;
+	return result;
+}
+
+HistoryItem *MessagesIndex::changeId(
+		PeerId peerId,
+		MsgId wasId,
+		MsgId nowId) {
+	const auto bucket = findBucket(peerId, wasId, Hash(peerId, wasId));
+	if (bucket == kNone) {
+		return nullptr;
+	}
+	const auto hash = Hash(peerId, nowId);
+	Assert(findBucket(peerId, nowId, hash) == kNone);
+
+	// The entry keeps its place in the peer list, only the key changes.
+	const auto index = _buckets[bucket].entry;
+	eraseBucket(bucket);
+	_entries[index].msgId = nowId;
+	placeBucket(index, hash);
+	return _entries[index].item;
+}
+
+bool MessagesIndex::hasPeer(PeerId peerId) const {
+	return _peerFirst.contains(peerId);
+}
+
+void MessagesIndex::clear() {
+	_buckets = std::vector<Bucket>();
+	_entries = std::vector<Entry>();
+	_freeEntries = std::vector<uint32>();
+	_peerFirst = base::flat_map<PeerId, uint32>();
+	_size = 0;
+}
+
+int MessagesIndex::size() const {
+	return _size;
+}
+
+int64 MessagesIndex::memoryUsage() const {
+	return int64(_buckets.capacity() * sizeof(Bucket))
+		+ int64(_entries.capacity() * sizeof(Entry))
+		+ int64(_freeEntries.capacity() * sizeof(uint32))
+		+ int64(_peerFirst.size() * sizeof(std::pair<PeerId, uint32>));
+}
+
+uint32 MessagesIndex::findBucket(
+		PeerId peerId,
+		MsgId msgId,
+		uint32 hash) const {
+	if (_buckets.empty()) {
+		return kNone;
+	}
+	const auto mask = uint32(_buckets.size() - 1);
+	for (auto i = (hash & mask);; i = ((i + 1) & mask)) {
+		const auto &bucket = _buckets[i];
+		if (bucket.entry == kNone) {
+			return kNone;
+		} else if (bucket.hash == hash) {
+			const auto &entry = _entries[bucket.entry];
+			if (entry.msgId == msgId && entry.peerId == peerId) {
+				return i;
+			}
+		}
+	}
+}
+
+void MessagesIndex::placeBucket(uint32 entry, uint32 hash) {
+	const auto mask = uint32(_buckets.size() - 1);
+	auto i = (hash & mask);
+	while (_buckets[i].entry != kNone) {
+		i = ((i + 1) & mask);
+	}
+	_buckets[i] = Bucket{ .entry = entry, .hash = hash };
+}
+
+void MessagesIndex::eraseBucket(uint32 bucket) {
+	// Backward shift deletion keeps probe sequences without tombstones.
+	const auto mask = uint32(_buckets.size() - 1);
+	auto hole = bucket;
+	for (auto i = ((hole + 1) & mask);; i = ((i + 1) & mask)) {
+		const auto &next = _buckets[i];
+		if (next.entry == kNone) {
+			break;
+		}
+		const auto ideal = (next.hash & mask);
+		if (((i - ideal) & mask) >= ((i - hole) & mask)) {
+			_buckets[hole] = next;
+			hole = i;
+		}
+	}
+	_buckets[hole] = Bucket();
+}
+
+void MessagesIndex::rehash(uint32 capacity) {
+	Expects(capacity > 0 && !(capacity & (capacity - 1)));
+
+	const auto was = std::exchange(_buckets, std::vector<Bucket>(capacity));
+	for (const auto &bucket : was) {
+		if (bucket.entry != kNone) {
+			placeBucket(bucket.entry, bucket.hash);
+		}
+	}
+}
+
+uint32 MessagesIndex::allocateEntry() {
+	if (!_freeEntries.empty()) {
+		const auto result = _freeEntries.back();
+		_freeEntries.pop_back();
+		return result;
+	}
+	_entries.emplace_back();
+	return uint32(_entries.size() - 1);
+}
+
+void MessagesIndex::linkEntry(uint32 index) {
+	auto &entry = _entries[index];
+	auto &first = _peerFirst.emplace(entry.peerId, kNone).first->second;
+	entry.previous = kNone;
+	entry.next = first;
+	if (first != kNone) {
+		_entries[first].previous = index;
+	}
+	first = index;
+}
+
+void MessagesIndex::unlinkEntry(uint32 index) {
+	auto &entry = _entries[index];
+	if (entry.next != kNone) {
+		_entries[entry.next].previous = entry.previous;
+	}
+	if (entry.previous != kNone) {
+		_entries[entry.previous].next = entry.next;
+	} else if (entry.next != kNone) {
+		_peerFirst[entry.peerId] = entry.next;
+	} else {
+		_peerFirst.remove(entry.peerId);
+	}
+	entry.previous = entry.next = kNone;
+}
+
+} // namespace Data
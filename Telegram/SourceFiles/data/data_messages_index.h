@@ -0,0 +1,90 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class HistoryItem;
+
+namespace Data {
+
+// Open addressing (linear probing) index of all loaded messages keyed by
+// (PeerId, MsgId). Buckets only hold a hash tag and an entry index, so a
+// lookup touches one contiguous array and one entry. Entries never move
+// while registered, they are also linked in a per-peer list for iteration.
+class MessagesIndex final {
+public:
+	[[nodiscard]] HistoryItem *find(PeerId peerId, MsgId msgId) const;
+
+	// Returns the item previously registered with the same key, if any.
+	HistoryItem *insert(
+		PeerId peerId,
+		MsgId msgId,
+		not_null<HistoryItem*> item);
+	HistoryItem *remove(PeerId peerId, MsgId msgId);
+	HistoryItem *changeId(PeerId peerId, MsgId wasId, MsgId nowId);
+
+	[[nodiscard]] bool hasPeer(PeerId peerId) const;
+
+	// The callback may remove the item it was called for, but no others.
+	template <typename Callback>
+	void enumerate(PeerId peerId, Callback &&callback) const;
+
+	void clear();
+
+	[[nodiscard]] int size() const;
+	[[nodiscard]] int64 memoryUsage() const;
+
+private:
+	static constexpr auto kNone = uint32(-1);
+
+	struct Entry {
+		PeerId peerId;
+		MsgId msgId;
+		HistoryItem *item = nullptr;
+		uint32 previous = kNone;
+		uint32 next = kNone;
+	};
+	struct Bucket {
+		uint32 entry = kNone;
+		uint32 hash = 0;
+	};
+
+	[[nodiscard]] static uint32 Hash(PeerId peerId, MsgId msgId);
+	[[nodiscard]] uint32 findBucket(
+		PeerId peerId,
+		MsgId msgId,
+		uint32 hash) const;
+	void placeBucket(uint32 entry, uint32 hash);
+	void eraseBucket(uint32 bucket);
+	void rehash(uint32 capacity);
+
+	[[nodiscard]] uint32 allocateEntry();
+	void linkEntry(uint32 index);
+	void unlinkEntry(uint32 index);
+
+	std::vector<Bucket> _buckets;
+	std::vector<Entry> _entries;
+	std::vector<uint32> _freeEntries;
+	base::flat_map<PeerId, uint32> _peerFirst;
+	int _size = 0;
+
+};
+
+template <typename Callback>
+void MessagesIndex::enumerate(PeerId peerId, Callback &&callback) const {
+	const auto i = _peerFirst.find(peerId);
+	if (i == end(_peerFirst)) {
+		return;
+	}
+	for (auto index = i->second; index != kNone;) {
+		const auto &entry = _entries[index];
+		index = entry.next;
+		callback(not_null<HistoryItem*>(entry.item));
+	}
+}
+
+} // namespace Data
@@ -51,6 +51,14 @@ SavedMessages::SavedMessages(
 	if (_owningHistory && _owningHistory->inChatList()) {
 		preloadSublists();
 	}
+
+	// Sublists take their names from the sublist peer histories.
+	session().changes().realtimeNameUpdates(
+	) | rpl::on_next([=](const NameUpdate &update) {
+		if (const auto sublist = sublistLoaded(update.peer)) {
+			_chatsList.indexed()->nameWordsChanged(sublist);
+		}
+	}, _lifetime);
 }
 
 void SavedMessages::clear() {
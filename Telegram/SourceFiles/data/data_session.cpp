@@ -74,6 +74,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_saved_music.h"
 #include "data/data_saved_sublist.h"
 #include "data/data_stories.h"
+#include "data/data_local_search_index.h"
+#include "data/data_history_cache.h"
 #include "data/data_streaming.h"
 #include "data/data_media_rotation.h"
 #include "data/data_histories.h"
@@ -265,6 +267,8 @@ Session::Session(not_null<Main::Session*> session)
 , _savedMessages(std::make_unique<SavedMessages>(this))
 , _chatbots(std::make_unique<Chatbots>(this))
 , _businessInfo(std::make_unique<BusinessInfo>(this))
+, _localSearchIndex(std::make_unique<LocalSearchIndex>(session))
+, _historyCache(std::make_unique<HistoryCache>(session))
 , _shortcutMessages(std::make_unique<ShortcutMessages>(this)) {
 	_cache->open(_session->local().cacheKey());
 	_bigFileCache->open(_session->local().cacheBigFileKey());
@@ -406,6 +410,8 @@ void Session::subscribeForTopicRepliesLists() {
 void Session::clear() {
 	_sessionDataAboutToBeCleared.fire({});
 
+	_localSearchIndex->writeChanged();
+
 	// Optimization: clear notifications before destroying items.
 	Core::App().notifications().clearFromSession(_session);
 
@@ -452,8 +458,7 @@ void Session::clear() {
 	_stories->clear();
 
 	_dependentMessages.clear();
-	base::take(_messages);
-	base::take(_nonChannelMessages);
+	_messages.clear();
 	_messageByRandomId.clear();
 	_sentMessagesData.clear();
 	cSetRecentStickers(RecentStickerPack());
@@ -1537,6 +1542,8 @@ void Session::deleteConversationLocally(not_null<PeerData*> peer) {
 	} else {
 		markLeft();
 	}
+	_localSearchIndex->purge(peer->id);
+	_historyCache->remove(peer->id);
 }
 
 bool Session::chatsListLoaded(Data::Folder *folder) {
@@ -1950,27 +1957,20 @@ rpl::producer<GiftAuctionGot> Session::giftAuctionGots() const {
 }
 
 HistoryItem *Session::changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId) {
-	const auto list = messagesListForInsert(peerId);
-	const auto i = list->find(wasId);
-	if (i == list->end()) {
+	const auto item = _messages.changeId(peerId, wasId, nowId);
+	if (!item) {
 		return nullptr;
 	}
-	const auto item = i->second;
-	list->erase(i);
-	const auto &[j, ok] = list->emplace(nowId, item);
 
 	if (!peerIsChannel(peerId)) {
 		if (IsServerMsgId(wasId)) {
-			const auto k = _nonChannelMessages.find(wasId);
-			Assert(k != end(_nonChannelMessages));
-			_nonChannelMessages.erase(k);
+			const auto removed = _messages.remove(PeerId(), wasId);
+			Assert(removed == item);
 		}
 		if (IsServerMsgId(nowId)) {
-			_nonChannelMessages.emplace(nowId, item);
+			_messages.insert(PeerId(), nowId, item);
 		}
 	}
-
-	Ensures(ok);
 	return item;
 }
 
@@ -2808,6 +2808,10 @@ void Session::updateEditedMessage(const MTPMessage &data) {
 		existing->applyEdition(data);
 	}, [&](const auto &data) {
 		existing->applyEdition(HistoryMessageEdition(_session, data));
+		_localSearchIndex->remove(
+			existing->history()->peer->id,
+			{ existing->id });
+		_localSearchIndex->add(existing);
 	});
 }
 
@@ -2828,12 +2832,18 @@ void Session::processMessages(
 		const auto id = IdFromMessage(message); // Only 32 bit values here.
 		indices.emplace((uint64(uint32(id.bare)) << 32) | uint64(i), i);
 	}
+	auto added = std::vector<not_null<HistoryItem*>>();
+	added.reserve(indices.size());
 	for (const auto &[position, index] : indices) {
-		addNewMessage(
+		const auto item = addNewMessage(
 			data[index],
 			MessageFlags(),
 			type);
+		if (item) {
+			added.push_back(item);
+		}
 	}
+	_localSearchIndex->add(added);
 }
 
 void Session::processMessages(
@@ -2867,29 +2877,17 @@ void Session::processExistingMessages(
 	});
 }
 
-const Session::Messages *Session::messagesList(PeerId peerId) const {
-	const auto i = _messages.find(peerId);
-	return (i != end(_messages)) ? &i->second : nullptr;
-}
-
-auto Session::messagesListForInsert(PeerId peerId)
--> not_null<Messages*> {
-	return &_messages[peerId];
-}
-
 void Session::registerMessage(not_null<HistoryItem*> item) {
 	const auto peerId = item->history()->peer->id;
-	const auto list = messagesListForInsert(peerId);
 	const auto itemId = item->id;
-	const auto i = list->find(itemId);
-	if (i != list->end()) {
+	if (const auto was = _messages.find(peerId, itemId)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		was->destroy();
 	}
-	list->emplace(itemId, item);
+	_messages.insert(peerId, itemId, item);
 
 	if (!peerIsChannel(peerId) && IsServerMsgId(itemId)) {
-		_nonChannelMessages.emplace(itemId, item);
+		_messages.insert(PeerId(), itemId, item);
 	}
 }
 
@@ -3000,7 +2998,13 @@ void Session::checkFormattedDateUpdates() {
 void Session::processMessagesDeleted(
 		PeerId peerId,
 		const QVector<MTPint> &data) {
-	const auto list = messagesList(peerId);
+	_localSearchIndex->remove(peerId, ranges::views::all(
+		data
+	) | ranges::views::transform([](const MTPint &id) {
+		return MsgId(id.v);
+	}) | ranges::to_vector);
+
+	const auto list = _messages.hasPeer(peerId);
 	const auto affected = historyLoaded(peerId);
 	if (!list && !affected) {
 		return;
@@ -3009,10 +3013,10 @@ void Session::processMessagesDeleted(
 	auto toDestroy = std::vector<not_null<HistoryItem*>>();
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto &messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			toDestroy.push_back(i->second);
+		const auto item = list ? _messages.find(peerId, messageId.v) : nullptr;
+		if (item) {
+			const auto history = item->history();
+			toDestroy.push_back(item);
 			historiesToCheck.emplace(history);
 		} else if (affected) {
 			affected->unknownMessageDeleted(messageId.v);
@@ -3039,6 +3043,7 @@ void Session::processNonChannelMessagesDeleted(const QVector<MTPint> &data) {
 			const auto history = item->history();
 			toDestroy.push_back(item);
 			historiesToCheck.emplace(history);
+			_localSearchIndex->remove(history->peer->id, { item->id });
 		}
 	}
 	if (!toDestroy.empty()) {
@@ -3092,10 +3097,10 @@ void Session::unregisterMessage(not_null<HistoryItem*> item) {
 			++i;
 		}
 	}
-	messagesListForInsert(peerId)->erase(itemId);
+	_messages.remove(peerId, itemId);
 
 	if (!peerIsChannel(peerId) && IsServerMsgId(itemId)) {
-		_nonChannelMessages.erase(itemId);
+		_messages.remove(PeerId(), itemId);
 	}
 }
 
@@ -3120,17 +3125,10 @@ bool Session::suggestToGigagroup(not_null<ChannelData*> group) const {
 }
 
 HistoryItem *Session::message(PeerId peerId, MsgId itemId) const {
-	if (!itemId) {
-		return nullptr;
-	}
-
-	const auto data = messagesList(peerId);
-	if (!data) {
+	if (!itemId || !peerId) {
 		return nullptr;
 	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return _messages.find(peerId, itemId);
 }
 
 HistoryItem *Session::message(
@@ -3153,16 +3151,16 @@ void Session::removeReactionsFromParticipant(
 		if (const auto item = message(peer, msgId)) {
 			item->removeReactionsFromParticipant(participant, reaction);
 		}
-	} else if (const auto list = messagesList(peer->id)) {
-		for (const auto &entry : *list) {
+	} else {
+		_messages.enumerate(peer->id, [&](not_null<HistoryItem*> item) {
 			const auto knownReaction = (originMsgId
-				&& (entry.second->id == originMsgId))
+				&& (item->id == originMsgId))
 				? reaction
 				: ReactionId();
-			entry.second->removeReactionsFromParticipant(
+			item->removeReactionsFromParticipant(
 				participant,
 				knownReaction);
-		}
+		});
 	}
 	notifyReactionsRemoved({
 		.peer = peer,
@@ -3175,8 +3173,7 @@ HistoryItem *Session::nonChannelMessage(MsgId itemId) const {
 	if (!IsServerMsgId(itemId)) {
 		return nullptr;
 	}
-	const auto i = _nonChannelMessages.find(itemId);
-	return (i != end(_nonChannelMessages)) ? i->second.get() : nullptr;
+	return _messages.find(PeerId(), itemId);
 }
 
 void Session::updateDependentMessages(not_null<HistoryItem*> item) {
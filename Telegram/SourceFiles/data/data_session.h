@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_databases.h"
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
+#include "data/data_messages_index.h"
 #include "data/data_cloud_file.h"
 #include "data/data_star_gift.h"
 #include "history/history_location_manager.h"
@@ -76,6 +77,8 @@ class SavedMusic;
 class SavedMessages;
 class Chatbots;
 class BusinessInfo;
+class LocalSearchIndex;
+class HistoryCache;
 struct ReactionId;
 struct UnavailableReason;
 struct CreditsStatusSlice;
@@ -243,6 +246,12 @@ public:
 	[[nodiscard]] BusinessInfo &businessInfo() const {
 		return *_businessInfo;
 	}
+	[[nodiscard]] LocalSearchIndex &localSearchIndex() const {
+		return *_localSearchIndex;
+	}
+	[[nodiscard]] HistoryCache &historyCache() const {
+		return *_historyCache;
+	}
 
 	[[nodiscard]] MsgId nextNonHistoryEntryId() {
 		return ++_nonHistoryEntryId;
@@ -611,6 +620,9 @@ public:
 	[[nodiscard]] HistoryItem *message(FullMsgId itemId) const;
 
 	[[nodiscard]] HistoryItem *nonChannelMessage(MsgId itemId) const;
+	[[nodiscard]] const MessagesIndex &messagesIndex() const {
+		return _messages;
+	}
 
 	void updateDependentMessages(not_null<HistoryItem*> item);
 	void registerDependentMessage(
@@ -1014,8 +1026,6 @@ public:
 	[[nodiscard]] HistoryItem *messageWithPeer(PeerId id) const;
 
 private:
-	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
-
 	struct NextToUpgradeGift {
 		std::optional<Data::SavedStarGift> gift;
 		Fn<void(std::optional<Data::SavedStarGift>)> done;
@@ -1049,8 +1059,6 @@ private:
 		Folder *requestFolder,
 		const MTPDdialogFolder &data);
 
-	const Messages *messagesList(PeerId peerId) const;
-	not_null<Messages*> messagesListForInsert(PeerId peerId);
 	not_null<HistoryItem*> registerMessage(
 		std::unique_ptr<HistoryItem> item);
 	HistoryItem *changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId);
@@ -1230,7 +1238,9 @@ private:
 	Dialogs::IndexedList _contactsNoChatsList;
 
 	MsgId _localMessageIdCounter = StartClientMsgId;
-	std::unordered_map<PeerId, Messages> _messages;
+	// Non-channel server messages are also indexed with an empty PeerId,
+	// because updates refer to them by MsgId only.
+	MessagesIndex _messages;
 	std::map<
 		not_null<HistoryItem*>,
 		base::flat_set<not_null<HistoryItem*>>> _dependentMessages;
@@ -1240,8 +1250,6 @@ private:
 	std::map<TimeId, std::vector<base::weak_ptr<HistoryView::Element>>> _formattedDateUpdates;
 	base::Timer _formattedDateTimer;
 
-	std::unordered_map<MsgId, not_null<HistoryItem*>> _nonChannelMessages;
-
 	base::flat_map<uint64, FullMsgId> _messageByRandomId;
 	base::flat_map<uint64, SentData> _sentMessagesData;
 
@@ -1403,6 +1411,8 @@ private:
 	const std::unique_ptr<SavedMessages> _savedMessages;
 	const std::unique_ptr<Chatbots> _chatbots;
 	const std::unique_ptr<BusinessInfo> _businessInfo;
+	const std::unique_ptr<LocalSearchIndex> _localSearchIndex;
+	const std::unique_ptr<HistoryCache> _historyCache;
 	std::unique_ptr<ShortcutMessages> _shortcutMessages;
 
 	MsgId _nonHistoryEntryId = ShortcutMaxMsgId;
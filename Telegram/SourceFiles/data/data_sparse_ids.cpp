@@ -181,19 +181,21 @@ bool SparseIdsSliceBuilder::applyUpdate(
 	if (!needMergeMessages && !update.count) {
 		return false;
 	}
-	auto skippedBefore = (update.range.from == 0)
-		? 0
-		: std::optional<int> {};
-	auto skippedAfter = (update.range.till == ServerMaxMsgId)
-		? 0
-		: std::optional<int> {};
+	if (!needMergeMessages) {
+		mergeSliceData(
+			update.count,
+			base::flat_set<MsgId> {},
+			std::nullopt,
+			std::nullopt);
+		return true;
+	}
+
+	const auto window = update.window(_key, _limitBefore, _limitAfter);
 	mergeSliceData(
 		update.count,
-		needMergeMessages
-			? *update.messages
-			: base::flat_set<MsgId> {},
-		skippedBefore,
-		skippedAfter);
+		window.messageIds,
+		window.skippedBefore,
+		window.skippedAfter);
 	return true;
 }
 
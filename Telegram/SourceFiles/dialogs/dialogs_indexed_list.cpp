@@ -26,6 +26,7 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 	}
 
 	auto result = RowsByLetter{ _list.addToEnd(key) };
+	indexNameWords(key);
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -42,6 +43,7 @@ Row *IndexedList::addByName(Key key) {
 	}
 
 	const auto result = _list.addByName(key);
+	indexNameWords(key);
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -127,6 +129,9 @@ void IndexedList::adjustByName(
 	const auto mainRow = _list.adjustByName(key);
 	if (!mainRow) return;
 
+	unindexNameWords(key);
+	indexNameWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
@@ -164,6 +169,9 @@ void IndexedList::adjustNames(
 	auto mainRow = _list.getRow(key);
 	if (!mainRow) return;
 
+	unindexNameWords(key);
+	indexNameWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
@@ -208,8 +216,16 @@ void IndexedList::unfreeze() {
 	}
 }
 
+void IndexedList::nameWordsChanged(Key key) {
+	if (_wordsByKey.contains(key)) {
+		unindexNameWords(key);
+		indexNameWords(key);
+	}
+}
+
 void IndexedList::remove(Key key, Row *replacedBy) {
 	if (_list.remove(key, replacedBy)) {
+		unindexNameWords(key);
 		for (const auto &ch : key.entry()->chatListFirstLetters()) {
 			if (const auto it = _index.find(ch); it != _index.cend()) {
 				it->second.remove(key, replacedBy);
@@ -221,55 +237,95 @@ void IndexedList::remove(Key key, Row *replacedBy) {
 void IndexedList::clear() {
 	_list.clear();
 	_index.clear();
+	_words.clear();
+	_wordsByKey.clear();
+}
+
+void IndexedList::indexNameWords(Key key) {
+	const auto &words = key.entry()->chatListNameWords();
+	for (const auto &word : words) {
+		_words.emplace(word, key);
+	}
+	_wordsByKey.emplace(key, words);
+}
+
+void IndexedList::unindexNameWords(Key key) {
+	const auto i = _wordsByKey.find(key);
+	if (i == end(_wordsByKey)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		_words.erase(std::pair(word, key));
+	}
+	_wordsByKey.erase(i);
 }
 
 std::vector<not_null<Row*>> IndexedList::filtered(
 		const QStringList &words) const {
-	const auto minimal = [&]() -> const Dialogs::List* {
-		if (empty()) {
-			return nullptr;
+	auto result = std::vector<not_null<Row*>>();
+	if (empty()) {
+		return result;
+	}
+
+	// Choose the query word matching the least name words.
+	const auto wordsEnd = end(_words);
+	const auto rangeStart = [&](const QString &word) {
+		return _words.lower_bound(std::pair(word, Key()));
+	};
+	auto minimal = (const QString*)nullptr;
+	auto minimalCount = std::numeric_limits<int>::max();
+	for (const auto &word : words) {
+		if (word.isEmpty()) {
+			continue;
 		}
-		auto result = (const Dialogs::List*)nullptr;
-		for (const auto &word : words) {
-			if (word.isEmpty()) {
-				continue;
-			}
-			const auto found = filtered(word[0]);
-			if (!found || found->empty()) {
-				return nullptr;
-			} else if (!result || result->size() > found->size()) {
-				result = found;
+		auto count = 0;
+		for (auto i = rangeStart(word)
+			; i != wordsEnd && i->first.startsWith(word)
+			; ++i) {
+			if (++count >= minimalCount) {
+				break;
 			}
 		}
-		return result;
-	}();
-	auto result = std::vector<not_null<Row*>>();
-	if (!minimal || minimal->empty()) {
+		if (!count) {
+			return result;
+		} else if (count < minimalCount) {
+			minimal = &word;
+			minimalCount = count;
+		}
+	}
+	if (!minimal) {
 		return result;
 	}
-	result.reserve(minimal->size());
-	for (const auto &row : *minimal) {
-		const auto &nameWords = row->entry()->chatListNameWords();
+
+	auto keys = std::vector<Key>();
+	keys.reserve(minimalCount);
+	for (auto i = rangeStart(*minimal)
+		; i != wordsEnd && i->first.startsWith(*minimal)
+		; ++i) {
+		keys.push_back(i->second);
+	}
+	ranges::sort(keys);
+	keys.erase(ranges::unique(keys), end(keys));
+
+	result.reserve(keys.size());
+	for (const auto &key : keys) {
+		const auto &nameWords = _wordsByKey.find(key)->second;
 		const auto found = [&](const QString &word) {
-			for (const auto &name : nameWords) {
-				if (name.startsWith(word)) {
-					return true;
-				}
+			if (&word == minimal) {
+				return true;
 			}
-			return false;
+			const auto i = nameWords.lower_bound(word);
+			return (i != nameWords.end()) && i->startsWith(word);
 		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
-				}
+		if (ranges::all_of(words, found)) {
+			if (const auto row = _list.getRow(key)) {
+				result.push_back(row);
 			}
-			return true;
-		}();
-		if (allFound) {
-			result.push_back(row);
 		}
 	}
+	ranges::sort(result, ranges::less(), [](not_null<Row*> row) {
+		return row->index();
+	});
 	return result;
 }
 
@@ -43,6 +43,10 @@ public:
 		not_null<PeerData*> peer,
 		const base::flat_set<QChar> &oldChars);
 
+	// For entries with names not tracked by peerNameChanged (topics,
+	// sublists), after their chatListNameWords() have changed.
+	void nameWordsChanged(Key key);
+
 	void remove(Key key, Row *replacedBy = nullptr);
 	void clear();
 
@@ -95,11 +99,18 @@ private:
 		not_null<History*> history,
 		const base::flat_set<QChar> &oldChars);
 
+	void indexNameWords(Key key);
+	void unindexNameWords(Key key);
+
 	SortMode _sortMode = SortMode();
 	FilterId _filterId = 0;
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	// All name words sorted, so a query word prefix is a continuous range.
+	std::set<std::pair<QString, Key>> _words;
+	std::map<Key, base::flat_set<QString>> _wordsByKey;
+
 };
 
 } // namespace Dialogs
@@ -23,8 +23,9 @@ namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
-constexpr auto kFileRequestsCount = 2;
-//constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileChunkSizeBig = 512 * 1024;
+constexpr auto kFileBigSize = 4 * 1024 * 1024;
+constexpr auto kFileRequestsCount = 4;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -189,12 +190,17 @@ struct ApiWrap::FileProcess {
 	Data::FileOrigin origin;
 	int64 offset = 0;
 	int64 size = 0;
+	int chunkSize = kFileChunkSize;
+	crl::time started = 0;
 
 	struct Request {
 		int64 offset = 0;
 		QByteArray bytes;
+		mtpRequestId requestId = 0;
 	};
 	std::deque<Request> requests;
+
+	// File reference refresh, parts are not requested while it is running.
 	mtpRequestId requestId = 0;
 };
 
@@ -411,13 +417,21 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 			MTP_flags(0),
 			location.data,
 			MTP_long(offset),
-			MTP_int(kFileChunkSize))
+			MTP_int(_fileProcess->chunkSize))
 	)).fail([=](const MTP::Error &result) {
-		_fileProcess->requestId = 0;
+		using Request = FileProcess::Request;
+		auto &requests = _fileProcess->requests;
+		const auto i = ranges::find(
+			requests,
+			offset,
+			[](const Request &request) { return request.offset; });
+		Assert(i != end(requests));
+		i->requestId = 0;
+
 		if (result.type() == u"TAKEOUT_FILE_EMPTY"_q
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
-				0,
+				offset,
 				MTP_upload_file(
 					MTP_storage_filePartial(),
 					MTP_int(0),
@@ -428,7 +442,7 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 			filePartUnavailable();
 		} else if (result.code() == 400
 			&& result.type().startsWith(u"FILE_REFERENCE_"_q)) {
-			filePartRefreshReference(offset);
+			filePartRefreshReference();
 		} else {
 			error(std::move(result));
 		}
@@ -1549,8 +1563,7 @@ void ApiWrap::skipFile(uint64 randomId) {
 	}
 	LOG(("Export Info: File skipped."));
 	Assert(!_fileProcess->requests.empty());
-	Assert(_fileProcess->requestId != 0);
-	_mtp.request(base::take(_fileProcess->requestId)).cancel();
+	cancelFileParts();
 	base::take(_fileProcess)->done(QString());
 }
 
@@ -2730,6 +2743,7 @@ void ApiWrap::loadFile(
 	_fileProcess = prepareFileProcess(file, origin);
 	_fileProcess->progress = std::move(progress);
 	_fileProcess->done = std::move(done);
+	_fileProcess->started = crl::now();
 
 	if (_fileProcess->progress) {
 		const auto progress = FileProgress{
@@ -2743,7 +2757,7 @@ void ApiWrap::loadFile(
 
 	loadFilePart();
 
-	Ensures(_fileProcess->requestId != 0);
+	Ensures(!_fileProcess->requests.empty());
 }
 
 auto ApiWrap::prepareFileProcess(
@@ -2761,42 +2775,65 @@ auto ApiWrap::prepareFileProcess(
 	result->relativePath = relativePath;
 	result->location = file.location;
 	result->size = file.size;
+	result->chunkSize = (file.size >= kFileBigSize)
+		? kFileChunkSizeBig
+		: kFileChunkSize;
 	result->origin = origin;
 	result->randomId = base::RandomValue<uint64>();
 	return result;
 }
 
 void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requestId
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+	if (!_fileProcess || _fileProcess->requestId) {
 		return;
 	}
 
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	_fileProcess->requestId = fileRequest(
+	// Files of unknown size are read part by part until an empty one.
+	const auto parallel = (_fileProcess->size > 0)
+		? kFileRequestsCount
+		: 1;
+	auto &requests = _fileProcess->requests;
+	while (int(requests.size()) < parallel
+		&& (!_fileProcess->size
+			|| _fileProcess->offset < _fileProcess->size)) {
+		const auto offset = _fileProcess->offset;
+		requests.push_back({ offset });
+		requests.back().requestId = sendFilePart(offset);
+		_fileProcess->offset += _fileProcess->chunkSize;
+	}
+}
+
+mtpRequestId ApiWrap::sendFilePart(int64 offset) {
+	return fileRequest(
 		_fileProcess->location,
-		_fileProcess->offset
+		offset
 	).done([=](const MTPupload_File &result) {
-		_fileProcess->requestId = 0;
 		filePartDone(offset, result);
 	}).send();
-	_fileProcess->offset += kFileChunkSize;
+}
+
+void ApiWrap::resendFileParts() {
+	Expects(_fileProcess != nullptr);
+	Expects(_fileProcess->requestId == 0);
+
+	for (auto &request : _fileProcess->requests) {
+		if (!request.requestId && request.bytes.isEmpty()) {
+			request.requestId = sendFilePart(request.offset);
+		}
+	}
+	loadFilePart();
+}
+
+void ApiWrap::cancelFileParts() {
+	Expects(_fileProcess != nullptr);
 
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		// Only one request at a time supported right now.
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	for (auto &request : _fileProcess->requests) {
+		if (request.requestId) {
+			_mtp.request(base::take(request.requestId)).cancel();
+		}
+	}
+	if (_fileProcess->requestId) {
+		_mtp.request(base::take(_fileProcess->requestId)).cancel();
 	}
 }
 
@@ -2804,6 +2841,15 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 	Expects(_fileProcess != nullptr);
 	Expects(!_fileProcess->requests.empty());
 
+	using Request = FileProcess::Request;
+	auto &requests = _fileProcess->requests;
+	const auto i = ranges::find(
+		requests,
+		offset,
+		[](const Request &request) { return request.offset; });
+	Assert(i != end(requests));
+	i->requestId = 0;
+
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		error("Cdn redirect is not supported.");
 		return;
@@ -2820,14 +2866,6 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 			return;
 		}
 	} else {
-		using Request = FileProcess::Request;
-		auto &requests = _fileProcess->requests;
-		const auto i = ranges::find(
-			requests,
-			offset,
-			[](const Request &request) { return request.offset; });
-		Assert(i != end(requests));
-
 		i->bytes = data.vbytes().v;
 
 		auto &file = _fileProcess->file;
@@ -2855,14 +2893,23 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 	}
 
 	auto process = base::take(_fileProcess);
+	if (_stats) {
+		_stats->incrementDownloaded(
+			process->file.size(),
+			crl::now() - process->started);
+	}
 	const auto relativePath = process->relativePath;
 	_fileCache->save(process->location, relativePath);
 	process->done(process->relativePath);
 }
 
-void ApiWrap::filePartRefreshReference(int64 offset) {
+void ApiWrap::filePartRefreshReference() {
 	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+
+	if (_fileProcess->requestId) {
+		// Several parts failed at once, one refresh is enough.
+		return;
+	}
 
 	const auto &origin = _fileProcess->origin;
 	if (origin.storyId) {
@@ -2875,7 +2922,7 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPstories_Stories &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 		return;
 	} else if (!origin.messageId) {
@@ -2903,7 +2950,7 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 	} else {
 		_fileProcess->requestId = splitRequest(
@@ -2919,13 +2966,12 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
 			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			filePartExtractReference(result);
 		}).send();
 	}
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
 		const MTPmessages_Messages &result) {
 	Expects(_fileProcess != nullptr);
 	Expects(_fileProcess->requestId == 0);
@@ -2952,13 +2998,7 @@ void ApiWrap::filePartExtractReference(
 					_fileProcess->location,
 					message.thumb().file.location);
 				if (refresh1 || refresh2) {
-					_fileProcess->requestId = fileRequest(
-						_fileProcess->location,
-						offset
-					).done([=](const MTPupload_File &result) {
-						_fileProcess->requestId = 0;
-						filePartDone(offset, result);
-					}).send();
+					resendFileParts();
 					return;
 				}
 			}
@@ -2968,7 +3008,6 @@ void ApiWrap::filePartExtractReference(
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
 		const MTPstories_Stories &result) {
 	Expects(_fileProcess != nullptr);
 	Expects(_fileProcess->requestId == 0);
@@ -2985,13 +3024,7 @@ void ApiWrap::filePartExtractReference(
 				_fileProcess->location,
 				story.thumb().file.location);
 			if (refresh1 || refresh2) {
-				_fileProcess->requestId = fileRequest(
-					_fileProcess->location,
-					offset
-				).done([=](const MTPupload_File &result) {
-					_fileProcess->requestId = 0;
-					filePartDone(offset, result);
-				}).send();
+				resendFileParts();
 				return;
 			}
 		}
@@ -3005,6 +3038,7 @@ void ApiWrap::filePartUnavailable() {
 
 	LOG(("Export Error: File unavailable."));
 
+	cancelFileParts();
 	base::take(_fileProcess)->done(QString());
 }
 
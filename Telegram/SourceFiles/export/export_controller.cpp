@@ -827,6 +827,9 @@ ProcessingState ControllerObject::stateTopic(
 }
 
 void ControllerObject::setFinishedState() {
+	LOG(("Export Info: Finished, download %1 KB/s, write %2 KB/s."
+		).arg(_stats.downloadSpeed() / 1024
+		).arg(_stats.writeSpeed() / 1024));
 	setState(FinishedState{
 		_writer->mainFilePath(),
 		_stats.filesCount(),
@@ -9,13 +9,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "countries/countries_instance.h"
 #include "export/output/export_output_result.h"
+#include "export/output/export_output_serialize.h"
 #include "export/data/export_data_types.h"
 #include "core/utils.h"
 #include "ui/text/format_values.h"
 
 #include <QtCore/QSize>
 #include <QtCore/QFile>
-#include <QtCore/QDateTime>
 
 namespace Export {
 namespace Output {
@@ -107,49 +107,9 @@ auto CalculateThumbSize(
 }
 
 QByteArray SerializeString(const QByteArray &value) {
-	const auto size = value.size();
-	const auto begin = value.data();
-	const auto end = begin + size;
-
 	auto result = QByteArray();
-	result.reserve(size * 6);
-	for (auto p = begin; p != end; ++p) {
-		const auto ch = *p;
-		if (ch == '\n') {
-			result.append("<br>", 4);
-		} else if (ch == '"') {
-			result.append("&quot;", 6);
-		} else if (ch == '&') {
-			result.append("&amp;", 5);
-		} else if (ch == '\'') {
-			result.append("&apos;", 6);
-		} else if (ch == '<') {
-			result.append("&lt;", 4);
-		} else if (ch == '>') {
-			result.append("&gt;", 4);
-		} else if (ch >= 0 && ch < 32) {
-			result.append("&#x", 3).append('0' + (ch >> 4));
-			const auto left = (ch & 0x0F);
-			if (left >= 10) {
-				result.append('A' + (left - 10));
-			} else {
-				result.append('0' + left);
-			}
-			result.append(';');
-		} else if (ch == char(0xE2)
-			&& (p + 2 < end)
-			&& *(p + 1) == char(0x80)) {
-			if (*(p + 2) == char(0xA8)) { // Line separator.
-				result.append("<br>", 4);
-			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
-				result.append("<br>", 4);
-			} else {
-				result.append(ch);
-			}
-		} else {
-			result.append(ch);
-		}
-	}
+	result.reserve(value.size() + value.size() / 8);
+	AppendHtmlEscaped(result, value);
 	return result;
 }
 
@@ -315,16 +275,23 @@ Data::Utf8String FormatUsername(const Data::Utf8String &username) {
 	return username.isEmpty() ? username : ('@' + username);
 }
 
+bool SameLocalDay(TimeId a, TimeId b) {
+	const auto first = ParseLocalDateTime(a);
+	const auto second = ParseLocalDateTime(b);
+	return (first.day == second.day)
+		&& (first.month == second.month)
+		&& (first.year == second.year);
+}
+
 bool DisplayDate(TimeId date, TimeId previousDate) {
 	if (!previousDate) {
 		return true;
 	}
-	return QDateTime::fromSecsSinceEpoch(date).date()
-		!= QDateTime::fromSecsSinceEpoch(previousDate).date();
+	return !SameLocalDay(date, previousDate);
 }
 
 QByteArray FormatDateText(TimeId date) {
-	const auto parsed = QDateTime::fromSecsSinceEpoch(date).date();
+	const auto parsed = ParseLocalDateTime(date);
 	const auto month = [](int index) {
 		switch (index) {
 		case 1: return "January";
@@ -342,18 +309,22 @@ QByteArray FormatDateText(TimeId date) {
 		}
 		return "Unknown";
 	};
-	return Data::NumberToString(parsed.day())
-		+ ' '
-		+ month(parsed.month())
-		+ ' '
-		+ Data::NumberToString(parsed.year());
+	auto result = QByteArray();
+	result.reserve(20);
+	AppendNumber(result, parsed.day);
+	result.append(' ').append(month(parsed.month)).append(' ');
+	AppendNumber(result, parsed.year);
+	return result;
 }
 
 QByteArray FormatTimeText(TimeId date) {
-	const auto parsed = QDateTime::fromSecsSinceEpoch(date).time();
-	return Data::NumberToString(parsed.hour(), 2)
-		+ ':'
-		+ Data::NumberToString(parsed.minute(), 2);
+	const auto parsed = ParseLocalDateTime(date);
+	auto result = QByteArray();
+	result.reserve(5);
+	AppendNumber(result, parsed.hour, 2);
+	result.append(':');
+	AppendNumber(result, parsed.minute, 2);
+	return result;
 }
 
 } // namespace
@@ -1862,8 +1833,7 @@ bool HtmlWriter::Wrap::messageNeedsWrap(
 		return true;
 	} else if (message.viaBotId != previous->viaBotId) {
 		return true;
-	} else if (QDateTime::fromSecsSinceEpoch(previous->date).date()
-		!= QDateTime::fromSecsSinceEpoch(message.date).date()) {
+	} else if (!SameLocalDay(previous->date, message.date)) {
 		return true;
 	} else if (message.forwarded != previous->forwarded
 		|| message.showForwardedAsOriginal != previous->showForwardedAsOriginal
@@ -3501,7 +3471,10 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 		: 0;
 	auto previous = _lastMessageInfo.get();
 	auto saved = std::optional<MessageInfo>();
-	auto block = QByteArray();
+
+	// Reuse the slice buffer, resize() keeps the allocated capacity.
+	auto &block = _sliceBuffer;
+	block.resize(0);
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
@@ -3515,7 +3488,7 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 				_lastMessageIdsPerFile.push_back(saved
 					? saved->id
 					: _lastMessageInfo->id);
-				block = QByteArray();
+				block.resize(0);
 				_lastMessageInfo = nullptr;
 				previous = nullptr;
 				saved = std::nullopt;
@@ -173,6 +173,7 @@ private:
 	DialogsMode _dialogsMode = DialogsMode::None;
 
 	int _messagesCount = 0;
+	QByteArray _sliceBuffer;
 	std::unique_ptr<MessageInfo> _lastMessageInfo;
 	int _dateMessageId = 0;
 	std::unique_ptr<Wrap> _chats;
@@ -8,10 +8,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/output/export_output_json.h"
 
 #include "export/output/export_output_result.h"
+#include "export/output/export_output_serialize.h"
 #include "export/data/export_data_types.h"
 #include "core/utils.h"
 
-#include <QtCore/QDateTime>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
@@ -24,58 +24,30 @@ namespace {
 using Context = details::JsonContext;
 
 QByteArray SerializeString(const QByteArray &value) {
-	const auto size = value.size();
-	const auto begin = value.data();
-	const auto end = begin + size;
-
 	auto result = QByteArray();
-	result.reserve(2 + size * 4);
+	result.reserve(2 + value.size() + value.size() / 8);
 	result.append('"');
-	for (auto p = begin; p != end; ++p) {
-		const auto ch = *p;
-		if (ch == '\n') {
-			result.append("\\n", 2);
-		} else if (ch == '\r') {
-			result.append("\\r", 2);
-		} else if (ch == '\t') {
-			result.append("\\t", 2);
-		} else if (ch == '"') {
-			result.append("\\\"", 2);
-		} else if (ch == '\\') {
-			result.append("\\\\", 2);
-		} else if (ch >= 0 && ch < 32) {
-			result.append("\\x", 2).append('0' + (ch >> 4));
-			const auto left = (ch & 0x0F);
-			if (left >= 10) {
-				result.append('A' + (left - 10));
-			} else {
-				result.append('0' + left);
-			}
-		} else if (ch == char(0xE2)
-			&& (p + 2 < end)
-			&& *(p + 1) == char(0x80)) {
-			if (*(p + 2) == char(0xA8)) { // Line separator.
-				result.append("\\u2028", 6);
-			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
-				result.append("\\u2029", 6);
-			} else {
-				result.append(ch);
-			}
-		} else {
-			result.append(ch);
-		}
-	}
+	AppendJsonEscaped(result, value);
 	result.append('"');
 	return result;
 }
 
 QByteArray SerializeDate(TimeId date) {
-	return SerializeString(
-		QDateTime::fromSecsSinceEpoch(date).toString(Qt::ISODate).toUtf8());
+	auto result = QByteArray();
+	result.reserve(21);
+	result.append('"');
+	AppendIsoDateTime(result, date);
+	result.append('"');
+	return result;
 }
 
 QByteArray SerializeDateRaw(TimeId date) {
-	return SerializeString(QString::number(date).toUtf8());
+	auto result = QByteArray();
+	result.reserve(12);
+	result.append('"');
+	AppendNumber(result, date);
+	result.append('"');
+	return result;
 }
 
 QByteArray StringAllowEmpty(const Data::Utf8String &data) {
@@ -103,8 +75,14 @@ QByteArray SerializeObject(
 	const auto guard = gsl::finally([&] { context.nesting.pop_back(); });
 	const auto next = '\n' + Indentation(context);
 
+	auto size = 2 + indent.size();
+	for (const auto &[key, value] : values) {
+		size += next.size() + key.size() + value.size() + 5;
+	}
+
 	auto first = true;
 	auto result = QByteArray();
+	result.reserve(size);
 	result.append('{');
 	for (const auto &[key, value] : values) {
 		if (value.isEmpty()) {
@@ -115,7 +93,9 @@ QByteArray SerializeObject(
 		} else {
 			result.append(',');
 		}
-		result.append(next).append(SerializeString(key)).append(": ", 2);
+		result.append(next).append('"');
+		AppendJsonEscaped(result, key);
+		result.append("\": ", 3);
 		result.append(value);
 	}
 	result.append('\n').append(indent).append("}");
@@ -128,8 +108,14 @@ QByteArray SerializeArray(
 	const auto indent = Indentation(context.nesting.size());
 	const auto next = '\n' + Indentation(context.nesting.size() + 1);
 
+	auto size = 2 + indent.size();
+	for (const auto &value : values) {
+		size += next.size() + value.size() + 1;
+	}
+
 	auto first = true;
 	auto result = QByteArray();
+	result.reserve(size);
 	result.append('[');
 	for (const auto &value : values) {
 		if (first) {
@@ -1694,12 +1680,15 @@ Result JsonWriter::validateDialogsMode(bool isLeftChannel) {
 Result JsonWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	Expects(_output != nullptr);
 
-	auto block = QByteArray();
+	// Reuse the slice buffer, resize() keeps the allocated capacity.
+	auto &block = _sliceBuffer;
+	block.resize(0);
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
 		}
-		block.append(prepareArrayItemStart() + SerializeMessage(
+		block.append(prepareArrayItemStart());
+		block.append(SerializeMessage(
 			_context,
 			message,
 			data.peers,
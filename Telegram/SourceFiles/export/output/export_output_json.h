@@ -104,6 +104,7 @@ private:
 
 	Context _context;
 	bool _currentNestingHadItem = false;
+	QByteArray _sliceBuffer;
 	DialogsMode _dialogsMode = DialogsMode::None;
 
 	std::unique_ptr<File> _output;
@@ -0,0 +1,274 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_serialize.h"
+
+#include <QtCore/QDateTime>
+
+#include <array>
+#include <cstring>
+#include <optional>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kOffsetCacheBucket = TimeId(15 * 60);
+constexpr auto kOnes = uint64(0x0101010101010101ULL);
+constexpr auto kHighs = uint64(0x8080808080808080ULL);
+
+// Byte-parallel checks on eight chars at once, see "Bit Twiddling Hacks".
+[[nodiscard]] inline uint64 HasZero(uint64 word) {
+	return (word - kOnes) & ~word & kHighs;
+}
+
+[[nodiscard]] inline uint64 HasByte(uint64 word, uchar value) {
+	return HasZero(word ^ (kOnes * value));
+}
+
+[[nodiscard]] inline uint64 HasControl(uint64 word) {
+	return (word - kOnes * 0x20) & ~word & kHighs;
+}
+
+[[nodiscard]] inline bool JsonClean(uint64 word) {
+	return !(HasControl(word)
+		| HasByte(word, '"')
+		| HasByte(word, '\\')
+		| HasByte(word, 0xE2));
+}
+
+[[nodiscard]] inline bool HtmlClean(uint64 word) {
+	return !(HasControl(word)
+		| HasByte(word, '"')
+		| HasByte(word, '&')
+		| HasByte(word, '\'')
+		| HasByte(word, '<')
+		| HasByte(word, '>')
+		| HasByte(word, 0xE2));
+}
+
+[[nodiscard]] inline bool JsonClean(char ch) {
+	return (uchar(ch) >= 0x20)
+		&& (ch != '"')
+		&& (ch != '\\')
+		&& (ch != char(0xE2));
+}
+
+[[nodiscard]] inline bool HtmlClean(char ch) {
+	return (uchar(ch) >= 0x20)
+		&& (ch != '"')
+		&& (ch != '&')
+		&& (ch != '\'')
+		&& (ch != '<')
+		&& (ch != '>')
+		&& (ch != char(0xE2));
+}
+
+// Returns the first char that may need escaping, skipping whole words.
+template <typename CleanWord, typename CleanChar>
+[[nodiscard]] const char *FindSpecial(
+		const char *from,
+		const char *till,
+		CleanWord cleanWord,
+		CleanChar cleanChar) {
+	auto word = uint64();
+	while (till - from >= sizeof(word)) {
+		memcpy(&word, from, sizeof(word));
+		if (!cleanWord(word)) {
+			break;
+		}
+		from += sizeof(word);
+	}
+	while (from != till && cleanChar(*from)) {
+		++from;
+	}
+	return from;
+}
+
+void AppendHex(QByteArray &to, char ch) {
+	const auto left = (ch & 0x0F);
+	to.append('0' + (ch >> 4));
+	to.append((left >= 10) ? ('A' + (left - 10)) : ('0' + left));
+}
+
+// Days since 1970-01-01 to civil date, see "chrono-Compatible Low-Level
+// Date Algorithms" by Howard Hinnant.
+void FillDate(LocalDateTime &result, int64 days) {
+	days += 719468;
+	const auto era = (days >= 0 ? days : days - 146096) / 146097;
+	const auto dayOfEra = days - era * 146097;
+	const auto yearOfEra = (dayOfEra
+		- dayOfEra / 1460
+		+ dayOfEra / 36524
+		- dayOfEra / 146096) / 365;
+	const auto dayOfYear = dayOfEra
+		- (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	const auto monthIndex = (5 * dayOfYear + 2) / 153;
+	result.day = int(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+	result.month = int(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+	result.year = int(yearOfEra + era * 400 + (result.month <= 2 ? 1 : 0));
+}
+
+} // namespace
+
+LocalDateTime ParseLocalDateTime(TimeId date) {
+	struct Cached {
+		std::optional<TimeId> bucket;
+		int offset = 0;
+	};
+
+	// Two buckets, so comparing two dates back and forth still hits.
+	thread_local auto cached = std::array<Cached, 2>();
+
+	const auto bucket = date / kOffsetCacheBucket;
+	if (cached[0].bucket != bucket) {
+		std::swap(cached[0], cached[1]);
+		if (cached[0].bucket != bucket) {
+			cached[0].bucket = bucket;
+			cached[0].offset = QDateTime::fromSecsSinceEpoch(
+				date).offsetFromUtc();
+		}
+	}
+	const auto local = int64(date) + cached[0].offset;
+	const auto days = (local >= 0 ? local : local - 86399) / 86400;
+	const auto seconds = int(local - days * 86400);
+
+	auto result = LocalDateTime();
+	FillDate(result, days);
+	result.hour = seconds / 3600;
+	result.minute = (seconds / 60) % 60;
+	result.second = seconds % 60;
+	return result;
+}
+
+void AppendJsonEscaped(QByteArray &to, const QByteArray &value) {
+	const auto begin = value.data();
+	const auto end = begin + value.size();
+	for (auto p = begin; p != end;) {
+		const auto special = FindSpecial(
+			p,
+			end,
+			[](uint64 word) { return JsonClean(word); },
+			[](char ch) { return JsonClean(ch); });
+		if (special != p) {
+			to.append(p, int(special - p));
+			p = special;
+			continue;
+		}
+		const auto ch = *p;
+		if (ch == '\n') {
+			to.append("\\n", 2);
+		} else if (ch == '\r') {
+			to.append("\\r", 2);
+		} else if (ch == '\t') {
+			to.append("\\t", 2);
+		} else if (ch == '"') {
+			to.append("\\\"", 2);
+		} else if (ch == '\\') {
+			to.append("\\\\", 2);
+		} else if (ch >= 0 && ch < 32) {
+			to.append("\\x", 2);
+			AppendHex(to, ch);
+		} else if (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)
+			&& *(p + 2) == char(0xA8)) { // Line separator.
+			to.append("\\u2028", 6);
+		} else if (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)
+			&& *(p + 2) == char(0xA9)) { // Paragraph separator.
+			to.append("\\u2029", 6);
+		} else {
+			to.append(ch);
+		}
+		++p;
+	}
+}
+
+void AppendHtmlEscaped(QByteArray &to, const QByteArray &value) {
+	const auto begin = value.data();
+	const auto end = begin + value.size();
+	for (auto p = begin; p != end;) {
+		const auto special = FindSpecial(
+			p,
+			end,
+			[](uint64 word) { return HtmlClean(word); },
+			[](char ch) { return HtmlClean(ch); });
+		if (special != p) {
+			to.append(p, int(special - p));
+			p = special;
+			continue;
+		}
+		const auto ch = *p;
+		if (ch == '\n') {
+			to.append("<br>", 4);
+		} else if (ch == '"') {
+			to.append("&quot;", 6);
+		} else if (ch == '&') {
+			to.append("&amp;", 5);
+		} else if (ch == '\'') {
+			to.append("&apos;", 6);
+		} else if (ch == '<') {
+			to.append("&lt;", 4);
+		} else if (ch == '>') {
+			to.append("&gt;", 4);
+		} else if (ch >= 0 && ch < 32) {
+			to.append("&#x", 3);
+			AppendHex(to, ch);
+			to.append(';');
+		} else if (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)
+			&& (*(p + 2) == char(0xA8) // Line separator.
+				|| *(p + 2) == char(0xA9))) { // Paragraph separator.
+			to.append("<br>", 4);
+		} else {
+			to.append(ch);
+		}
+		++p;
+	}
+}
+
+void AppendIsoDateTime(QByteArray &to, TimeId date) {
+	const auto parsed = ParseLocalDateTime(date);
+	if (parsed.year < 0 || parsed.year > 9999) {
+		return;
+	}
+	AppendNumber(to, parsed.year, 4);
+	to.append('-');
+	AppendNumber(to, parsed.month, 2);
+	to.append('-');
+	AppendNumber(to, parsed.day, 2);
+	to.append('T');
+	AppendNumber(to, parsed.hour, 2);
+	to.append(':');
+	AppendNumber(to, parsed.minute, 2);
+	to.append(':');
+	AppendNumber(to, parsed.second, 2);
+}
+
+void AppendNumber(QByteArray &to, int64 value, int length) {
+	char buffer[24];
+	auto position = int(sizeof(buffer));
+	const auto negative = (value < 0);
+	auto left = negative ? (0 - uint64(value)) : uint64(value);
+	do {
+		buffer[--position] = char('0' + (left % 10));
+		left /= 10;
+	} while (left);
+	while (int(sizeof(buffer)) - position < length && position > 1) {
+		buffer[--position] = '0';
+	}
+	if (negative) {
+		buffer[--position] = '-';
+	}
+	to.append(buffer + position, int(sizeof(buffer)) - position);
+}
+
+} // namespace Output
+} // namespace Export
@@ -0,0 +1,42 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <QtCore/QByteArray>
+
+namespace Export {
+namespace Output {
+
+struct LocalDateTime {
+	int year = 0;
+	int month = 0;
+	int day = 0;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+};
+
+// Same result as QDateTime::fromSecsSinceEpoch(), but the local time
+// offset is looked up only once per quarter of an hour of dates.
+[[nodiscard]] LocalDateTime ParseLocalDateTime(TimeId date);
+
+// Appends the value escaped for a JSON string, without the quotes.
+void AppendJsonEscaped(QByteArray &to, const QByteArray &value);
+
+// Appends the value escaped for HTML text or an attribute value.
+void AppendHtmlEscaped(QByteArray &to, const QByteArray &value);
+
+// "yyyy-MM-ddTHH:mm:ss" in local time, as Qt::ISODate does.
+void AppendIsoDateTime(QByteArray &to, TimeId date);
+
+void AppendNumber(QByteArray &to, int64 value, int length = 0);
+
+} // namespace Output
+} // namespace Export
@@ -12,7 +12,10 @@ namespace Output {
 
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
-, _bytes(other._bytes.load()) {
+, _bytes(other._bytes.load())
+, _writeTime(other._writeTime.load())
+, _downloaded(other._downloaded.load())
+, _downloadTime(other._downloadTime.load()) {
 }
 
 void Stats::incrementFiles() {
@@ -23,6 +26,15 @@ void Stats::incrementBytes(int count) {
 	_bytes += count;
 }
 
+void Stats::incrementWriteTime(crl::profile_time duration) {
+	_writeTime += duration;
+}
+
+void Stats::incrementDownloaded(int64 count, crl::time duration) {
+	_downloaded += count;
+	_downloadTime += duration;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -31,5 +43,15 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+int64 Stats::writeSpeed() const {
+	const auto time = _writeTime.load();
+	return time ? (_bytes * 1'000'000 / time) : 0;
+}
+
+int64 Stats::downloadSpeed() const {
+	const auto time = _downloadTime.load();
+	return time ? (_downloaded * 1'000 / time) : 0;
+}
+
 } // namespace Output
 } // namespace Export
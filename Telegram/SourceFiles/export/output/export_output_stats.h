@@ -19,13 +19,22 @@ public:
 
 	void incrementFiles();
 	void incrementBytes(int count);
+	void incrementWriteTime(crl::profile_time duration);
+	void incrementDownloaded(int64 count, crl::time duration);
 
 	int filesCount() const;
 	int64 bytesCount() const;
 
+	// Average speeds in bytes per second, zero if nothing was measured.
+	int64 writeSpeed() const;
+	int64 downloadSpeed() const;
+
 private:
 	std::atomic<int> _files;
 	std::atomic<int64> _bytes;
+	std::atomic<crl::profile_time> _writeTime = 0;
+	std::atomic<int64> _downloaded = 0;
+	std::atomic<crl::time> _downloadTime = 0;
 
 };
 
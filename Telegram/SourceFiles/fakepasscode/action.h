@@ -2,8 +2,11 @@
 #define TELEGRAM_ACTION_H
 
 #include <QByteArray>
+#include <array>
 #include <memory>
 
+#include "base/basic_types.h"
+
 namespace FakePasscode {
     enum class ActionType {
         ClearProxy = 0,
@@ -47,6 +50,13 @@ namespace FakePasscode {
         virtual void Prepare();
         virtual void Execute() = 0;
 
+        // Actions that keep working in the background after Execute()
+        // call done when they finish, dependent actions wait for that.
+        virtual void ExecuteAsync(Fn<void()> done) {
+            Execute();
+            done();
+        }
+
         virtual QByteArray Serialize() const = 0;
 
         virtual ActionType GetType() const = 0;
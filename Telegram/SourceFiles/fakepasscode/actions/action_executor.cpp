@@ -2,11 +2,12 @@
 
 #include <algorithm>
 #include <map>
-#include <range/v3/view/transform.hpp>
-#include <range/v3/range/conversion.hpp>
+#include <range/v3/algorithm/all_of.hpp>
 
 #include "../action.h"
 #include "../log/fake_log.h"
+#include "base/algorithm.h"
+#include "core/utils.h"
 
 namespace FakePasscode {
 
@@ -24,60 +25,247 @@ static const std::array ActionExecutionOrder = {
 static_assert((std::size(kAvailableGlobalActions) + std::size(kAvailableAccountActions))
               <= std::size(ActionExecutionOrder), "Don't forget to specify order for new actions");
 
+struct ActionAccess {
+    ActionType type;
+    ActionResources reads;
+    ActionResources writes;
+};
+
+// ClearCache looks at the accounts only inside Execute() and its background
+// wipe survives sessions going away, so until completion it holds only the
+// caches. Every action reads its own settings, so DeleteActions waits for all.
+static const std::array ActionResourceAccess = {
+    ActionAccess{
+        ActionType::Command,
+        ActionResource::Process | ActionResource::PasscodeSettings,
+        ActionResource::Process },
+    ActionAccess{
+        ActionType::ClearCache,
+        ActionResource::PasscodeSettings,
+        ActionResource::Caches },
+    ActionAccess{
+        ActionType::DeleteChats,
+        (ActionResource::Accounts
+            | ActionResource::Network
+            | ActionResource::PasscodeSettings),
+        ActionResources() },
+    ActionAccess{
+        ActionType::DeleteContacts,
+        (ActionResource::Accounts
+            | ActionResource::Network
+            | ActionResource::PasscodeSettings),
+        ActionResources() },
+    ActionAccess{
+        ActionType::UnblockUsers,
+        (ActionResource::Accounts
+            | ActionResource::Network
+            | ActionResource::PasscodeSettings),
+        ActionResources() },
+    ActionAccess{
+        ActionType::Logout,
+        ActionResource::Network | ActionResource::PasscodeSettings,
+        ActionResource::Accounts | ActionResource::LocalStorage },
+    ActionAccess{
+        ActionType::ClearProxy,
+        ActionResource::PasscodeSettings,
+        ActionResource::Network },
+    ActionAccess{
+        ActionType::DeleteActions,
+        ActionResources(),
+        ActionResource::PasscodeSettings },
+};
+
+static_assert(std::size(ActionResourceAccess) == std::size(ActionExecutionOrder),
+              "Don't forget to specify resources for new actions");
+
 static int execOrder(ActionType type);
+static ActionAccess resourceAccess(ActionType type);
+
+static bool conflicts(const ActionAccess& earlier, const ActionAccess& later) {
+    return (earlier.writes & (later.reads | later.writes))
+        || (later.writes & earlier.reads);
+}
 
 static bool strictActionOrder(const std::shared_ptr<Action>& lhs, const std::shared_ptr<Action>& rhs) {
     return execOrder(lhs->GetType()) < execOrder(rhs->GetType());
 }
 
-void ExecuteActions(std::vector<std::shared_ptr<Action>>&& actions, QString name) {
+namespace {
+
+enum class ScheduledState {
+    Waiting,
+    Running,
+    Finished,
+};
+
+struct ScheduledAction {
+    ActionType type;
+    std::weak_ptr<Action> weak;
+    std::shared_ptr<Action> running; // Keeps the action alive until done.
+    std::vector<int> dependencies;
+    ScheduledState state = ScheduledState::Waiting;
+    ActionTrace trace;
+};
+
+struct Execution {
+    QString name;
+    std::vector<ScheduledAction> actions;
+    Fn<void(std::vector<ActionTrace>)> done;
+    QString executedList;
+    crl::time started = 0;
+    int finished = 0;
+    bool scheduling = false;
+};
+
+void Schedule(const std::shared_ptr<Execution>& execution);
+
+void Finish(const std::shared_ptr<Execution>& execution, int index) {
+    auto& entry = execution->actions[index];
+    if (entry.state == ScheduledState::Finished) {
+        return;
+    }
+    entry.state = ScheduledState::Finished;
+    entry.trace.finished = crl::now() - execution->started;
+    entry.running = nullptr;
+    ++execution->finished;
+    if (!execution->scheduling) {
+        Schedule(execution);
+    }
+}
+
+void Start(const std::shared_ptr<Execution>& execution, int index) {
+    auto& entry = execution->actions[index];
+    const auto type = entry.type;
+    entry.state = ScheduledState::Running;
+    entry.trace.started = crl::now() - execution->started;
+
+    auto action = entry.weak.lock();
+    if (!action) {
+        FAKE_LOG(qsl("OUT-OF-ORDER execution of action %1 for passcode %2. It was removed while executing one of the following: [%3]")
+            .arg(int(type))
+            .arg(execution->name)
+            .arg(execution->executedList));
+        entry.trace.skipped = true;
+        Finish(execution, index);
+        return;
+    }
+    entry.running = action;
+    if (!execution->executedList.isEmpty()) {
+        execution->executedList += ", ";
+    }
+    execution->executedList += QString::number(int(type));
+    try {
+        FAKE_LOG(qsl("Execute of action type %1 for passcode %2")
+             .arg(int(type))
+             .arg(execution->name));
+        action->ExecuteAsync([=] {
+            Finish(execution, index);
+        });
+    } catch (...) {
+        FAKE_LOG(qsl("Execution of action type %1 failed for passcode %2")
+            .arg(int(type))
+            .arg(execution->name));
+        execution->actions[index].trace.failed = true;
+        Finish(execution, index);
+    }
+}
+
+void Complete(const std::shared_ptr<Execution>& execution) {
+    FAKE_LOG(qsl("Totally executed: %1").arg(execution->executedList));
+
+    auto timeline = std::vector<ActionTrace>();
+    timeline.reserve(execution->actions.size());
+    QString traced;
+    for (const auto& entry : execution->actions) {
+        const auto& trace = entry.trace;
+        timeline.push_back(trace);
+        if (!traced.isEmpty()) {
+            traced += ", ";
+        }
+        traced += qsl("%1 +%2ms..+%3ms%4")
+            .arg(int(trace.type))
+            .arg(trace.started)
+            .arg(trace.finished)
+            .arg(trace.failed
+                ? qsl(" failed")
+                : trace.skipped
+                ? qsl(" skipped")
+                : QString());
+    }
+    FAKE_LOG(qsl("Execution timeline for passcode %1: [%2]").arg(execution->name).arg(traced));
+
+    if (const auto done = base::take(execution->done)) {
+        done(std::move(timeline));
+    }
+}
+
+void Schedule(const std::shared_ptr<Execution>& execution) {
+    // Dependencies always point to earlier actions, so one pass in the
+    // execution order also starts everything that synchronous actions
+    // have unblocked during this pass.
+    execution->scheduling = true;
+    const auto count = int(execution->actions.size());
+    for (auto i = 0; i != count; ++i) {
+        const auto& entry = execution->actions[i];
+        if (entry.state != ScheduledState::Waiting) {
+            continue;
+        }
+        const auto ready = ranges::all_of(entry.dependencies, [&](int j) {
+            return (execution->actions[j].state == ScheduledState::Finished);
+        });
+        if (ready) {
+            Start(execution, i);
+        }
+    }
+    execution->scheduling = false;
+
+    if (execution->finished == count) {
+        Complete(execution);
+    }
+}
+
+} // namespace
+
+void ExecuteActions(
+        std::vector<std::shared_ptr<Action>>&& actions,
+        QString name,
+        Fn<void(std::vector<ActionTrace>)> done) {
     if (actions.empty()) {
+        if (done) {
+            done({});
+        }
         return;
     }
 
     //1. Order actions
     std::sort(std::begin(actions), std::end(actions), strictActionOrder);
 
-    //2. Map to weak_ptr to detect out of order execution
-    struct WeakAction {
-        ActionType type;
-        std::weak_ptr<Action> action;
-    };
-    auto weakActions = actions | ranges::views::transform([](auto& action){
-        return WeakAction{
-            .type = action->GetType(),
-            .action = action
+    //2. Map to weak_ptr to detect out of order execution and find
+    //   the earlier actions each one has to wait for.
+    const auto execution = std::make_shared<Execution>();
+    execution->name = name;
+    execution->done = std::move(done);
+    execution->actions.reserve(actions.size());
+    for (size_t i = 0; i < actions.size(); ++i) {
+        const auto type = actions[i]->GetType();
+        const auto access = resourceAccess(type);
+        auto entry = ScheduledAction{
+            .type = type,
+            .weak = actions[i],
+            .trace = { .type = type },
         };
-    }) | ranges::to_vector;
+        for (size_t j = 0; j < i; ++j) {
+            if (conflicts(resourceAccess(actions[j]->GetType()), access)) {
+                entry.dependencies.push_back(int(j));
+            }
+        }
+        execution->actions.push_back(std::move(entry));
+    }
     actions.clear();
 
     //3. Execute
-    QString executedList;
-    for (auto& [type, weak] : weakActions) {
-        auto action = weak.lock();
-        if (!action) {
-            FAKE_LOG(qsl("OUT-OF-ORDER execution of action %1 for passcode %2. It was removed while executing one of the following: [%3]")
-                .arg(int(type))
-                .arg(name)
-                .arg(executedList));
-            continue;
-        }
-        try {
-            FAKE_LOG(qsl("Execute of action type %1 for passcode %2")
-                 .arg(int(type))
-                 .arg(name));
-            action->Execute();
-        } catch (...) {
-            FAKE_LOG(qsl("Execution of action type %1 failed for passcode %2")
-                .arg(int(type))
-                .arg(name));
-        }
-        if (!executedList.isEmpty()) {
-            executedList += ", ";
-        }
-        executedList += QString::number(int(type));
-    }
-    FAKE_LOG(qsl("Totally executed: %1").arg(executedList));
+    execution->started = crl::now();
+    Schedule(execution);
 }
 
 static std::map<ActionType, int> makeOrderMap() {
@@ -99,4 +287,20 @@ static int execOrder(ActionType type) {
     return -1-int(type);
 }
 
+static ActionAccess resourceAccess(ActionType type) {
+    for (const auto& access : ActionResourceAccess) {
+        if (access.type == type) {
+            return access;
+        }
+    }
+    //unknown action conflicts with everything
+    const auto all = ActionResource::Accounts
+        | ActionResource::LocalStorage
+        | ActionResource::Caches
+        | ActionResource::Network
+        | ActionResource::Process
+        | ActionResource::PasscodeSettings;
+    return { type, all, all };
+}
+
 }
@@ -4,11 +4,44 @@
 #include <memory>
 #include <vector>
 
+#include "base/basic_types.h"
+#include "base/flags.h"
+
+#include <crl/crl_time.h>
+
 namespace FakePasscode {
 
 class Action;
+enum class ActionType;
+
+// Resources an action reads or modifies until it is completed.
+enum class ActionResource {
+    Accounts = (1 << 0),
+    LocalStorage = (1 << 1),
+    Caches = (1 << 2),
+    Network = (1 << 3),
+    Process = (1 << 4),
+    PasscodeSettings = (1 << 5),
+};
+inline constexpr bool is_flag_type(ActionResource) { return true; }
+using ActionResources = base::flags<ActionResource>;
+
+struct ActionTrace {
+    ActionType type;
+    crl::time started = 0; // Relative to the execution start.
+    crl::time finished = 0; // When the action reported its completion.
+    bool failed = false;
+    bool skipped = false;
+};
 
-void ExecuteActions(std::vector<std::shared_ptr<Action>>&& actions, QString name);
+// An action starts as soon as every earlier action it shares a modified
+// resource with is completed, so independent actions overlap while one
+// of them keeps working in the background. Must be called on main thread,
+// done receives the timeline after the last action is completed.
+void ExecuteActions(
+    std::vector<std::shared_ptr<Action>>&& actions,
+    QString name,
+    Fn<void(std::vector<ActionTrace>)> done = nullptr);
 
 }
 
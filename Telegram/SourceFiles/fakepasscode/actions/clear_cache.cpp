@@ -10,8 +10,20 @@
 #include "fakepasscode/utils/file_utils.h"
 
 void FakePasscode::ClearCache::Execute() {
+    ExecuteAsync([] {});
+}
+
+void FakePasscode::ClearCache::ExecuteAsync(Fn<void()> done) {
     Expects(Core::App().maybePrimarySession() != nullptr);
-    FileUtils::ClearCaches();
+    // Both the caches and the download folder are wiped in background.
+    const auto left = std::make_shared<int>(2);
+    const auto finish = [=] {
+        if (!--*left) {
+            FAKE_LOG(qsl("Caches and download folder cleared"));
+            done();
+        }
+    };
+    FileUtils::ClearCaches(true, finish);
     /*QString emojiPath = Ui::Emoji::internal::CacheFileFolder();
     FAKE_LOG(qsl("Clear emoji folder %1").arg(emojiPath));
     FileUtils::DeleteFolderRecursively(emojiPath);*/
@@ -31,7 +43,9 @@ void FakePasscode::ClearCache::Execute() {
     }
 
     FAKE_LOG(qsl("Clear download folder %1").arg(download_path));
-    FileUtils::DeleteFolderRecursively(download_path);
+    FileUtils::DeleteFolderRecursivelyAsync(download_path, false, [=](bool) {
+        finish();
+    });
 }
 
 QByteArray FakePasscode::ClearCache::Serialize() const {
@@ -7,6 +7,7 @@ namespace FakePasscode {
     class ClearCache : public Action {
     public:
         void Execute() override;
+        void ExecuteAsync(Fn<void()> done) override;
 
         QByteArray Serialize() const override;
 
@@ -0,0 +1,81 @@
+#include "autodelete_schedule.h"
+
+namespace FakePasscode {
+
+TimeId AutoDeleteRetryDelay(int attempt) {
+    auto result = kAutoDeleteRetryDelay;
+    for (auto i = 0; i < attempt && result < kAutoDeleteMaxRetryDelay; ++i) {
+        result *= 2;
+    }
+    return std::min(result, kAutoDeleteMaxRetryDelay);
+}
+
+void AutoDeleteSchedule::schedule(int index, FullMsgId msgId, TimeId deadline) {
+    _scheduled[index][msgId] = deadline;
+    _deadlines.push({ .when = deadline, .index = index, .msgId = msgId });
+}
+
+void AutoDeleteSchedule::remove(int index, FullMsgId msgId) {
+    const auto it = _scheduled.find(index);
+    if (it != _scheduled.end()) {
+        it->second.erase(msgId);
+    }
+}
+
+void AutoDeleteSchedule::removeAccount(int index) {
+    _scheduled.erase(index);
+    _flushed.remove(index);
+}
+
+auto AutoDeleteSchedule::takeExpired(
+        TimeId now,
+        Fn<bool(int)> immediately) -> Expired {
+    auto result = Expired();
+    while (!_deadlines.empty() && _deadlines.top().when <= now) {
+        const auto top = _deadlines.top();
+        _deadlines.pop();
+        const auto it = _scheduled.find(top.index);
+        if (it == _scheduled.end()) {
+            continue;
+        }
+        const auto found = it->second.find(top.msgId);
+        if (found != it->second.end() && found->second == top.when) {
+            result[top.index].push_back(top.msgId);
+        }
+    }
+    // Only the accounts are checked on every call, the messages
+    // are walked once, when the account switches to immediate mode.
+    for (const auto &[index, messages] : _scheduled) {
+        if (!immediately(index)) {
+            _flushed.remove(index);
+        } else if (!messages.empty() && _flushed.emplace(index).second) {
+            auto &list = result[index];
+            for (const auto &[msgId, deadline] : messages) {
+                if (deadline > now) {
+                    list.push_back(msgId);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void AutoDeleteSchedule::requeue(int index, TimeId now) {
+    const auto it = _scheduled.find(index);
+    if (it == _scheduled.end()) {
+        return;
+    }
+    for (const auto &[msgId, deadline] : it->second) {
+        if (deadline <= now) {
+            _deadlines.push({ .when = deadline, .index = index, .msgId = msgId });
+        }
+    }
+    _flushed.remove(index);
+}
+
+const AutoDeleteSchedule::DeletionMap *AutoDeleteSchedule::find(int index) const {
+    const auto it = _scheduled.find(index);
+    return (it != _scheduled.end()) ? &it->second : nullptr;
+}
+
+} // namespace FakePasscode
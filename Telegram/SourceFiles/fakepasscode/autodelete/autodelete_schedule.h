@@ -0,0 +1,89 @@
+#ifndef TELEGRAM_AUTODELETE_SCHEDULE_H
+#define TELEGRAM_AUTODELETE_SCHEDULE_H
+
+#include <base/basic_types.h>
+#include <base/flat_map.h>
+#include <base/flat_set.h>
+#include <data/data_msg_id.h>
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+namespace FakePasscode {
+
+// Server accepts at most that many ids in one delete request.
+inline constexpr auto kAutoDeleteChunkSize = 100;
+
+inline constexpr TimeId kAutoDeleteRetryDelay = 5;
+inline constexpr TimeId kAutoDeleteMaxRetryDelay = 60 * 60;
+
+template <typename Container>
+[[nodiscard]] std::vector<Container> SplitToChunks(
+        const Container &ids,
+        int size = kAutoDeleteChunkSize) {
+    auto result = std::vector<Container>();
+    result.reserve((ids.size() + size - 1) / size);
+    for (auto from = 0; from < int(ids.size()); from += size) {
+        const auto till = std::min(from + size, int(ids.size()));
+        result.push_back(Container(ids.begin() + from, ids.begin() + till));
+    }
+    return result;
+}
+
+// Delay before the next attempt after attempt failed attempts.
+[[nodiscard]] TimeId AutoDeleteRetryDelay(int attempt);
+
+// Deadlines of the scheduled messages of all accounts.
+class AutoDeleteSchedule final {
+public:
+    using DeletionMap = std::map<FullMsgId, TimeId>;
+    using Expired = base::flat_map<int, std::vector<FullMsgId>>;
+
+    // A later call for the same message replaces its deadline.
+    void schedule(int index, FullMsgId msgId, TimeId deadline);
+    void remove(int index, FullMsgId msgId);
+    void removeAccount(int index);
+
+    // Messages due at now. When immediately(index) becomes true all
+    // the messages of the account are returned once, so the messages
+    // scheduled after that should be scheduled at now.
+    [[nodiscard]] Expired takeExpired(
+        TimeId now,
+        Fn<bool(int)> immediately);
+
+    // Due messages of the account were taken, but not sent, return them.
+    void requeue(int index, TimeId now);
+
+    [[nodiscard]] const DeletionMap *find(int index) const;
+    [[nodiscard]] const base::flat_map<int, DeletionMap> &accounts() const {
+        return _scheduled;
+    }
+
+private:
+    // Entries are removed lazily: a popped entry is ignored if
+    // _scheduled no longer has the same deadline for this message.
+    struct Deadline {
+        TimeId when = 0;
+        int index = 0;
+        FullMsgId msgId;
+
+        friend inline auto operator<=>(
+            const Deadline&,
+            const Deadline&) = default;
+    };
+    using DeadlineQueue = std::priority_queue<
+        Deadline,
+        std::vector<Deadline>,
+        std::greater<>>;
+
+    base::flat_map<int, DeletionMap> _scheduled;
+    DeadlineQueue _deadlines;
+    base::flat_set<int> _flushed;
+
+};
+
+} // namespace FakePasscode
+
+#endif //TELEGRAM_AUTODELETE_SCHEDULE_H
@@ -14,6 +14,7 @@
 #include <data/data_user.h>
 #include <history/history.h>
 #include <history/history_item.h>
+#include <mtproto/mtproto_response.h>
 #include <storage/storage_domain.h>
 
 #include "fakepasscode/log/fake_log.h"
@@ -47,27 +48,31 @@ AutoDeleteService::AutoDeleteService(Storage::Domain* owner)
     timer.callEach(1000);
 }
 
-void AutoDeleteService::tick() const {
-    timeStream.fire(base::unixtime::now());
-}
-
-rpl::producer<TimeId> AutoDeleteService::nowTicks() const {
-    return timeStream.events_starting_with(base::unixtime::now());
-}
-
-rpl::producer<TimeId> AutoDeleteService::nextTicks() const {
-    return timeStream.events();
+void AutoDeleteService::tick() {
+    for (const auto &[index, messages] : waitRead) {
+        if (messages.empty()) {
+            continue;
+        }
+        if (auto account = getAccount(index)) {
+            if (auto session = account->maybeSession()) {
+                checkRead(index, session);
+            }
+        }
+    }
+    checkDeadlines(base::unixtime::now());
 }
 
 void AutoDeleteService::DeleteAll() {
     base::flat_map<int, std::vector<FullMsgId>> remove;
-    for (auto& mp : { waitRead, scheduled }) {
+    const auto collect = [&](const AccountMap& mp) {
         for (auto& [index, messages]: mp) {
             for (auto& [msgId, _]: messages) {
                 remove[index].push_back(msgId);
             }
         }
-    }
+    };
+    collect(waitRead);
+    collect(scheduled.accounts());
     for (auto& [index, messages] : remove) {
         deleteAll[index] = true;
         if (auto account = getAccount(index)) {
@@ -88,15 +93,18 @@ void AutoDeleteService::DeleteAll(Main::Session* session) {
 
     deleteAll[index] = true;
     std::vector<FullMsgId> remove;
-    for (auto& mp : { waitRead, scheduled }) {
-        auto it = mp.find(index);
-        if (it == mp.end()) {
-            continue;
+    const auto collect = [&](const DeletionMap* mp) {
+        if (!mp) {
+            return;
         }
-        for (auto& [msgId, _]: it->second) {
+        for (auto& [msgId, _]: *mp) {
             remove.push_back(msgId);
         }
+    };
+    if (const auto it = waitRead.find(index); it != waitRead.end()) {
+        collect(&it->second);
     }
+    collect(scheduled.find(index));
 
     if (remove.empty()) {
         return;
@@ -128,7 +136,7 @@ void AutoDeleteService::RegisterAutoDeleteMessage(Main::Session* session, uint64
         .timeout = timeout,
         .created = base::unixtime::now()
     };
-    postponeSave();
+    postponeSave(index);
 }
 
 void AutoDeleteService::UnregisterMessageRandomId(Main::Session* session, uint64 randomId) {
@@ -140,7 +148,7 @@ void AutoDeleteService::UnregisterMessageRandomId(Main::Session* session, uint64
 
     auto removed = registered[index].erase(randomId);
     if (removed) {
-        postponeSave();
+        postponeSave(index);
     }
 }
 
@@ -164,36 +172,61 @@ void AutoDeleteService::UpdateMessageId(Main::Session *session, uint64 randomId,
     const TimeId timeout = it->second.timeout;
     const FullMsgId msgId = FullMsgId(it->second.peer, newMsgId);
     waitRead[index][msgId] = timeout;
-    postponeSave();
-    postponeCall(crl::guard(session, [=]{
-        waitUntilRead(session, index, msgId, timeout);
-    }));
+    postponeSave(index);
 }
 
-void AutoDeleteService::waitUntilRead(Main::Session* session, int index, FullMsgId msgId, TimeId timeout) {
-    messageRead(session, msgId)
-        | rpl::filter([=] (bool read) {
-            return read || deleteImmediately(index);
-        })
-        | rpl::take(1)
-        | rpl::on_next([=](){
-            waitRead[index].erase(msgId);
-            scheduled[index][msgId] = scheduleDeleteWithTimeout(session, index, msgId, timeout);
-            postponeSave();
-        }, session->lifetime());
-}
+void AutoDeleteService::checkRead(int index, Main::Session *session) {
+    //we reimplement HistoryItem::unread, telegram may load not all messages we are interested in
 
-rpl::producer<bool> AutoDeleteService::messageRead(Main::Session *session, FullMsgId msgId) const {
-    return nowTicks()
-        | rpl::start_spawning(session->lifetime())
-        | rpl::map([=]{ return isRead(session, msgId); });
-}
+    auto& waiting = waitRead[index];
+    const bool immediately = deleteImmediately(index);
+    std::vector<std::pair<FullMsgId, TimeId>> read;
+
+    // Messages are ordered by (peer, msg), so the read state is computed
+    // once per peer and unread tails are skipped with a single lookup.
+    auto it = waiting.begin();
+    while (it != waiting.end()) {
+        const PeerId peerId = it->first.peer;
+        const auto peerEnd = waiting.upper_bound(
+            FullMsgId(peerId, MsgId(std::numeric_limits<int64>::max())));
+        if (immediately) {
+            for (; it != peerEnd; ++it) {
+                read.emplace_back(it->first, it->second);
+            }
+            continue;
+        }
+        not_null<PeerData*> peer = session->data().peer(peerId);
+        if (isPeerAlwaysRead(session, peer)) {
+            for (; it != peerEnd; ++it) {
+                read.emplace_back(it->first, it->second);
+            }
+            continue;
+        }
+        not_null<History*> history = session->data().history(peerId);
+        const MsgId readTill = history->outboxReadTillId();
+        for (; it != peerEnd && it->first.msg <= readTill; ++it) {
+            read.emplace_back(it->first, it->second);
+        }
+        if (it != peerEnd && !history->lastMessageKnown()) {
+            //request history if it is not loaded
+            session->data().histories().requestDialogEntry(history);
+        }
+        it = peerEnd;
+    }
 
-bool AutoDeleteService::isRead(Main::Session *session, FullMsgId msgId) const {
-    //we reimplement HistoryItem::unread, telegram may load not all messages we are interested in
+    if (read.empty()) {
+        return;
+    }
+    for (const auto &[msgId, timeout] : read) {
+        waiting.erase(msgId);
+        // In immediate mode the whole schedule was already taken once.
+        scheduleDeleteWithTimeout(index, msgId, immediately ? 0 : timeout);
+    }
+    postponeSave(index);
+}
 
+bool AutoDeleteService::isPeerAlwaysRead(Main::Session *session, not_null<PeerData*> peer) const {
     // Messages from myself are always read, unless scheduled.
-    not_null<PeerData*> peer = session->data().peer(msgId.peer);
     if (peer->isSelf()) {
         return true;
     }
@@ -203,11 +236,6 @@ bool AutoDeleteService::isRead(Main::Session *session, FullMsgId msgId) const {
         return true;
     }
 
-    not_null<History*> history = session->data().history(msgId.peer);
-    const MsgId readTill = history->outboxReadTillId();
-    if (msgId.msg <= readTill) {
-        return true;
-    }
     if (const auto user = peer->asUser()) {
         if (user->isBot() && !user->isSupport()) {
             return true;
@@ -217,30 +245,37 @@ bool AutoDeleteService::isRead(Main::Session *session, FullMsgId msgId) const {
             return true;
         }
     }
+    return false;
+}
 
-    //request history if it is not loaded
-    if (!history->lastMessageKnown()) {
-        session->data().histories().requestDialogEntry(history);
+void AutoDeleteService::checkDeadlines(TimeId now) {
+    const auto expired = scheduled.takeExpired(now, [=](int index) {
+        return deleteImmediately(index);
+    });
+    for (const auto& [index, messages] : expired) {
+        const auto account = getAccount(index);
+        if (!account) {
+            FAKE_LOG(qsl("Account %1 is removed, forget %2 scheduled messages").arg(index).arg(messages.size()));
+            for (FullMsgId msgId : messages) {
+                forget(index, msgId);
+            }
+            postponeSave(index);
+        } else if (const auto session = account->maybeSession()) {
+            autoDelete(session, index, messages);
+        } else {
+            waitForSession(index, account);
+        }
     }
-
-    return false;
 }
 
-TimeId AutoDeleteService::scheduleDeleteWithTimeout(Main::Session* session, int index, FullMsgId msgId, TimeId timeout) {
+TimeId AutoDeleteService::scheduleDeleteWithTimeout(int index, FullMsgId msgId, TimeId timeout) {
     const TimeId deadline = base::unixtime::now() + timeout;
-    scheduleDeleteWithDeadline(session, index, msgId, deadline);
+    scheduleDeleteWithDeadline(index, msgId, deadline);
     return deadline;
 }
 
-void AutoDeleteService::scheduleDeleteWithDeadline(Main::Session *session, int index, FullMsgId msgId, TimeId deadline) {
-    nowTicks()
-        | rpl::filter([=] (TimeId now) {
-            return now >= deadline || deleteImmediately(index);
-        })
-        | rpl::take(1)
-        | rpl::on_next([=] {
-            autoDelete(session, index, {msgId});
-        }, session->lifetime());
+void AutoDeleteService::scheduleDeleteWithDeadline(int index, FullMsgId msgId, TimeId deadline) {
+    scheduled.schedule(index, msgId, deadline);
 }
 
 void AutoDeleteService::autoDelete(Main::Session *session, int index, const std::vector<FullMsgId>& messages) {
@@ -248,57 +283,121 @@ void AutoDeleteService::autoDelete(Main::Session *session, int index, const std:
 
     struct Messages {
         QVector<HistoryItem*> items;
-        QVector<MTPint> ids;
         QVector<FullMsgId> messages;
     };
     base::flat_map<History*, Messages> historyItems;
-    base::flat_map<PeerData*, Messages> peerItems;
+    base::flat_map<PeerData*, QVector<FullMsgId>> peerItems;
     auto& data = session->data();
+    auto& inFlight = deleting[index];
 
     for (FullMsgId msgId : messages) {
+        if (!inFlight.emplace(msgId).second) {
+            // Request for this message is already sent.
+            continue;
+        }
         if (const auto item = data.message(msgId)) {
             auto& ref = historyItems[item->history()];
             ref.items.push_back(item);
             ref.messages.push_back(msgId);
         } else {
-            not_null<PeerData*> peer = data.peer(msgId.peer);
-            auto& ref = peerItems[peer];
-            ref.ids.push_back(MTP_int(msgId.msg));
-            ref.messages.push_back(msgId);
+            peerItems[data.peer(msgId.peer)].push_back(msgId);
         }
     }
 
     auto onDone = [=] (QVector<FullMsgId> msgs) {
-        return [=] {
+        return crl::guard(this, [=] {
+            if (!isWatching(index)) {
+                // Account was logged out while the request was running.
+                return;
+            }
             for (FullMsgId msgId : msgs) {
-                waitRead[index].erase(msgId);
-                scheduled[index].erase(msgId);
+                forget(index, msgId);
             }
-            postponeSave();
-        };
+            postponeSave(index);
+        });
     };
 
     auto onError = [=] (QVector<FullMsgId> msgs) {
-        return [=] {
-            for (FullMsgId msgId : msgs) {
-                scheduleDeleteWithTimeout(session, index, msgId, 5);
-            }
-        };
+        return crl::guard(this, [=](const MTP::Error& error) {
+            autoDeleteFailed(index, msgs, error);
+        });
     };
 
     for (auto&[history, grouped] : historyItems) {
-        QVector<FullMsgId> msgs = grouped.messages;
-        autoDeleteItems(session, history, grouped.items, onDone(msgs), onError(msgs));
+        const auto items = SplitToChunks(grouped.items);
+        const auto msgs = SplitToChunks(grouped.messages);
+        for (size_t i = 0; i < items.size(); ++i) {
+            autoDeleteItems(session, history, items[i], onDone(msgs[i]), onError(msgs[i]));
+        }
     }
     for (auto&[peer, grouped] : peerItems) {
-        QVector<FullMsgId> msgs = grouped.messages;
-        autoDeleteRaw(session, peer, grouped.ids, onDone(msgs), onError(msgs));
+        for (const auto& msgs : SplitToChunks(grouped)) {
+            QVector<MTPint> ids;
+            ids.reserve(msgs.size());
+            for (FullMsgId msgId : msgs) {
+                ids.push_back(MTP_int(msgId.msg));
+            }
+            autoDeleteRaw(session, peer, ids, onDone(msgs), onError(msgs));
+        }
     }
 
     data.sendHistoryChangeNotifications();
 }
 
-void AutoDeleteService::autoDeleteItems(Main::Session* session, History* history, QVector<HistoryItem*> items, Fn<void()> onDone, Fn<void()> onError) {
+void AutoDeleteService::autoDeleteFailed(int index, const QVector<FullMsgId>& messages, const MTP::Error& error) {
+    if (!isWatching(index)) {
+        // Account was logged out while the request was running.
+        return;
+    }
+    for (FullMsgId msgId : messages) {
+        deleting[index].erase(msgId);
+    }
+    if (MTP::IsTemporaryError(error)) {
+        auto& attempts = failedAttempts[index];
+        for (FullMsgId msgId : messages) {
+            scheduleDeleteWithTimeout(index, msgId, AutoDeleteRetryDelay(attempts[msgId]++));
+        }
+    } else if (messages.size() > 1) {
+        // Find the messages that can't be deleted, splitting the request.
+        FAKE_LOG(qsl("Delete of %1 messages failed with %2, split the request")
+            .arg(messages.size())
+            .arg(error.type()));
+        const auto account = getAccount(index);
+        const auto session = account ? account->maybeSession() : nullptr;
+        const auto half = messages.size() / 2;
+        for (const auto& part : { messages.mid(0, half), messages.mid(half) }) {
+            if (session) {
+                autoDelete(session, index, std::vector<FullMsgId>(part.begin(), part.end()));
+            } else {
+                for (FullMsgId msgId : part) {
+                    scheduleDeleteWithTimeout(index, msgId, kAutoDeleteRetryDelay);
+                }
+            }
+        }
+    } else {
+        FAKE_LOG(qsl("Message %1 in %2 can't be deleted: %3, forget it")
+            .arg(messages.front().msg.bare)
+            .arg(messages.front().peer.value)
+            .arg(error.type()));
+        forget(index, messages.front());
+    }
+    postponeSave(index);
+}
+
+void AutoDeleteService::forget(int index, FullMsgId msgId) {
+    if (const auto it = deleting.find(index); it != deleting.end()) {
+        it->second.erase(msgId);
+    }
+    if (const auto it = waitRead.find(index); it != waitRead.end()) {
+        it->second.erase(msgId);
+    }
+    if (const auto it = failedAttempts.find(index); it != failedAttempts.end()) {
+        it->second.erase(msgId);
+    }
+    scheduled.remove(index, msgId);
+}
+
+void AutoDeleteService::autoDeleteItems(Main::Session* session, History* history, QVector<HistoryItem*> items, Fn<void()> onDone, Fn<void(const MTP::Error&)> onError) {
     using namespace Data;
 
     QVector<MTPint> messages;
@@ -314,9 +413,9 @@ void AutoDeleteService::autoDeleteItems(Main::Session* session, History* history
                     history->requestChatListMessage();
                     onDone();
                 },
-                [=] {
+                [=](const MTP::Error& error) {
                     finish();
-                    onError();
+                    onError(error);
                 });
         });
 
@@ -331,14 +430,14 @@ void AutoDeleteService::autoDeleteItems(Main::Session* session, History* history
     }
 }
 
-mtpRequestId AutoDeleteService::autoDeleteRaw(Main::Session* session, PeerData* peer, QVector<MTPint> messages, Fn<void()> onDone, Fn<void()> onError) {
+mtpRequestId AutoDeleteService::autoDeleteRaw(Main::Session* session, PeerData* peer, QVector<MTPint> messages, Fn<void()> onDone, Fn<void(const MTP::Error&)> onError) {
     auto ids = MTP_vector(messages);
     auto done = [=](const MTPmessages_AffectedMessages &result) {
         session->api().applyAffectedMessages(peer, result);
         onDone();
     };
     auto error = [=](const MTP::Error &error, const MTP::Response &response) {
-        onError();
+        onError(error);
     };
     if (const auto channel = peer->asChannel()) {
         return FAKE_CRITICAL_REQUEST(session) session->api().request(MTPchannels_DeleteMessages(channel->inputChannel(), ids))
@@ -366,14 +465,37 @@ void AutoDeleteService::watchSession(Main::Session* session, int index) {
         }, lifetime);
 }
 
+void AutoDeleteService::waitForSession(int index, not_null<Main::Account*> account) {
+    if (!waitingSession.emplace(index).second) {
+        return;
+    }
+    // Expired messages stay scheduled and are taken again with the session.
+    FAKE_LOG(qsl("No session for account %1, postpone deleting").arg(index));
+    account->sessionChanges()
+        | rpl::filter([] (Main::Session* s) {
+            return s != nullptr;
+        })
+        | rpl::take(1)
+        | rpl::on_next([=]{
+            waitingSession.remove(index);
+            scheduled.requeue(index, base::unixtime::now());
+        }, lifetime);
+}
+
+bool AutoDeleteService::isWatching(int index) const {
+    return watchingSessions.contains(index);
+}
+
 void AutoDeleteService::onLogout(int index) {
     //At this point session is already destroyed. So we can't delete scheduled messages. Just cleanup
     //DeleteAll operation is performed by Application::logoutWithChecksAndClear
     registered.erase(index);
     waitRead.erase(index);
-    scheduled.erase(index);
+    scheduled.removeAccount(index);
+    deleting.erase(index);
+    failedAttempts.erase(index);
     watchingSessions.erase(index);
-    postponeSave();
+    postponeSave(index);
 }
 
 void AutoDeleteService::save() {
@@ -383,7 +505,8 @@ void AutoDeleteService::save() {
     }
 }
 
-void AutoDeleteService::postponeSave() {
+void AutoDeleteService::postponeSave(int index) {
+    serializedDirty.emplace(index);
     dirty = true;
     postponeCall([=]{ save(); });
 }
@@ -394,8 +517,16 @@ QByteArray AutoDeleteService::Serialize() const {
         QByteArray data;
     };
     std::vector<AccountData> data;
+    const auto now = base::unixtime::now();
     for (const auto &[index, _] : Core::App().domain().accounts()) {
-        QByteArray accData = serialize(index);
+        auto cached = serializedCache.find(index);
+        if (cached == serializedCache.end()
+            || serializedDirty.contains(index)
+            || (cached->second.expires && cached->second.expires <= now)) {
+            cached = serializedCache.insert_or_assign(index, serialize(index)).first;
+            serializedDirty.remove(index);
+        }
+        const QByteArray &accData = cached->second.data;
         if (!accData.isEmpty()) {
             data.push_back({index, accData});
         }
@@ -414,14 +545,16 @@ QByteArray AutoDeleteService::Serialize() const {
     return serialized;
 }
 
-QByteArray AutoDeleteService::serialize(int index) const {
-    QByteArray data;
+auto AutoDeleteService::serialize(int index) const -> SerializedAccount {
+    SerializedAccount result;
+    QByteArray &data = result.data;
     RandomIdsMap reg;
     DeletionMap waiting;
     DeletionMap sched;
 
     constexpr TimeId day = 24*60*60;
-    TimeId old = base::unixtime::now() - 2*day;
+    constexpr TimeId keep = 2*day;
+    TimeId old = base::unixtime::now() - keep;
     if (auto it = registered.find(index); it != registered.end()) {
         reg = it->second
             | ranges::views::filter([ old ] (auto& pair) {
@@ -429,15 +562,22 @@ QByteArray AutoDeleteService::serialize(int index) const {
             })
             | ranges::to<RandomIdsMap>();
     }
+    for (const auto &[randomId, rec] : reg) {
+        // The blob has to be rebuilt when the oldest id gets too old.
+        const auto expires = rec.created + keep;
+        if (!result.expires || expires < result.expires) {
+            result.expires = expires;
+        }
+    }
     if (auto it = waitRead.find(index); it != waitRead.end()) {
         waiting = it->second;
     }
-    if (auto it = scheduled.find(index); it != scheduled.end()) {
-        sched = it->second;
+    if (const auto found = scheduled.find(index)) {
+        sched = *found;
     }
 
     if (reg.empty() && waiting.empty() && sched.empty()) {
-        return data;
+        return result;
     }
 
     QDataStream stream(&data, QIODevice::WriteOnly);
@@ -454,7 +594,7 @@ QByteArray AutoDeleteService::serialize(int index) const {
         stream << messageId.peer.value << messageId.msg.bare << deadline;
     }
 
-    return data;
+    return result;
 }
 
 void AutoDeleteService::DeSerialize(QByteArray data) {
@@ -484,7 +624,6 @@ void AutoDeleteService::deserialize(int index, QByteArray data) {
     if (!account->sessionExists()) {
         return;
     }
-    auto* session = account->maybeSession();
 
     QDataStream stream(&data, QIODevice::ReadOnly);
     int size = -1;
@@ -501,20 +640,15 @@ void AutoDeleteService::deserialize(int index, QByteArray data) {
         TimeId timeout;
         stream >> msgId.peer.value >> msgId.msg.bare >> timeout;
         waitRead[index][msgId] = timeout;
-        postponeCall(crl::guard(session, [=]{
-            waitUntilRead(session, index, msgId, timeout);
-        }));
     }
     stream >> size;
     for (int i = 0; i < size; ++i) {
         FullMsgId msgId;
         TimeId deadline;
         stream >> msgId.peer.value >> msgId.msg.bare >> deadline;
-        scheduled[index][msgId] = deadline;
-        postponeCall(crl::guard(session, [=]{
-            scheduleDeleteWithDeadline(session, index, msgId, deadline);
-        }));
+        scheduleDeleteWithDeadline(index, msgId, deadline);
     }
+    watchSession(account->maybeSession(), index);
 }
 
 template<typename Fn>
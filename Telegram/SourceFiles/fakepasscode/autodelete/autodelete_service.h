@@ -4,17 +4,26 @@
 #include <base/basic_types.h>
 #include <base/weak_ptr.h>
 #include <base/flat_map.h>
+#include <base/flat_set.h>
 #include <base/timer.h>
 #include <data/data_msg_id.h>
 
+#include "fakepasscode/autodelete/autodelete_schedule.h"
+
 #include <map>
+#include <set>
 #include <vector>
 #include <rpl/rpl.h>
 
 namespace Main {
+class Account;
 class Session;
 }
 
+namespace MTP {
+class Error;
+}
+
 namespace Data{
 class Session;
 }
@@ -52,39 +61,53 @@ private:
     using DeletionMap = std::map<FullMsgId, TimeId>;
     using AccountMap = base::flat_map<int, DeletionMap>;
 
+    // Blob of an account with the time its registered ids start expiring.
+    struct SerializedAccount {
+        QByteArray data;
+        TimeId expires = 0;
+    };
+
     base::flat_map<int, RandomIdsMap> registered;
     AccountMap waitRead;
-    AccountMap scheduled;
+    AutoDeleteSchedule scheduled;
+    base::flat_map<int, std::set<FullMsgId>> deleting;
+    base::flat_map<int, std::map<FullMsgId, int>> failedAttempts;
+    base::flat_set<int> waitingSession;
     bool dirty = false;
 
+    // Serialize() reuses per-account blobs until the account changes.
+    mutable base::flat_map<int, SerializedAccount> serializedCache;
+    mutable base::flat_set<int> serializedDirty;
+
     Storage::Domain* owner;
     base::flat_map<int, bool> watchingSessions;
     base::flat_map<int, bool> deleteAll;
     base::Timer timer;
-    rpl::event_stream<TimeId> timeStream;
     rpl::lifetime lifetime;
 
-    void tick() const;
-    rpl::producer<TimeId> nowTicks() const;
-    rpl::producer<TimeId> nextTicks() const;
-    rpl::producer<bool> messageRead(Main::Session* session, FullMsgId msgId) const;
-    bool isRead(Main::Session* session, FullMsgId msgId) const;
+    void tick();
+    void checkRead(int index, Main::Session* session);
+    void checkDeadlines(TimeId now);
+    bool isPeerAlwaysRead(Main::Session* session, not_null<PeerData*> peer) const;
     bool deleteImmediately(int index) const;
 
-    void waitUntilRead(Main::Session* session, int index, FullMsgId msgId, TimeId timeout);
-    TimeId scheduleDeleteWithTimeout(Main::Session* session, int index, FullMsgId msgId, TimeId timeout);
-    void scheduleDeleteWithDeadline(Main::Session* session, int index, FullMsgId msgId, TimeId deadline);
+    TimeId scheduleDeleteWithTimeout(int index, FullMsgId msgId, TimeId timeout);
+    void scheduleDeleteWithDeadline(int index, FullMsgId msgId, TimeId deadline);
 
     void autoDelete(Main::Session* session, int index, const std::vector<FullMsgId>& messages);
-    void autoDeleteItems(Main::Session* session, History* history, QVector<HistoryItem*> items, Fn<void()> onDone, Fn<void()> onError);
-    mtpRequestId autoDeleteRaw(Main::Session* session, PeerData* peer, QVector<MTPint> messages, Fn<void()> onDone, Fn<void()> onError);
+    void autoDeleteItems(Main::Session* session, History* history, QVector<HistoryItem*> items, Fn<void()> onDone, Fn<void(const MTP::Error&)> onError);
+    mtpRequestId autoDeleteRaw(Main::Session* session, PeerData* peer, QVector<MTPint> messages, Fn<void()> onDone, Fn<void(const MTP::Error&)> onError);
+    void autoDeleteFailed(int index, const QVector<FullMsgId>& messages, const MTP::Error& error);
+    void forget(int index, FullMsgId msgId);
 
     void watchSession(Main::Session* session, int index);
+    void waitForSession(int index, not_null<Main::Account*> account);
+    bool isWatching(int index) const;
     void onLogout(int index);
 
     void save();
-    void postponeSave();
-    QByteArray serialize(int index) const;
+    void postponeSave(int index);
+    SerializedAccount serialize(int index) const;
     void deserialize(int index, QByteArray data);
 
     template<typename Fn>
@@ -66,8 +66,15 @@ FakePasscode::FakePasscode::GetActions() const {
             state_changed_.events() | rpl::map([=] { return &actions_; }));
 }
 
-void FakePasscode::FakePasscode::Execute() {
-    ExecuteActions(actions_ | ranges::views::values | ranges::to_vector, name_);
+void FakePasscode::FakePasscode::Execute(Fn<void()> done) {
+    ExecuteActions(
+        actions_ | ranges::views::values | ranges::to_vector,
+        name_,
+        [=](std::vector<ActionTrace>) {
+            if (done) {
+                done();
+            }
+        });
 }
 
 FakePasscode::FakePasscode::FakePasscode() {
@@ -75,7 +82,10 @@ FakePasscode::FakePasscode::FakePasscode() {
 }
 
 bool FakePasscode::FakePasscode::CheckPasscode(const QByteArray &passcode) const {
-    const auto checkKey = GetFakePasscodeKey(passcode);
+    return CheckPasscodeKey(GetFakePasscodeKey(passcode));
+}
+
+bool FakePasscode::FakePasscode::CheckPasscodeKey(const MTP::AuthKeyPtr &checkKey) const {
     MTP::AuthKeyPtr fake_passcode = GetFakePasscodeKey();
     return checkKey->equals(fake_passcode);
 }
@@ -24,7 +24,8 @@ namespace FakePasscode {
 
       virtual ~FakePasscode() = default;
 
-      void Execute();
+      // done is called when the background parts of the actions complete.
+      void Execute(Fn<void()> done = nullptr);
 
       [[nodiscard]] MTP::AuthKeyPtr GetFakePasscodeKey() const;
       void ReEncryptPasscode();
@@ -36,6 +37,7 @@ namespace FakePasscode {
       void SetName(QString name);
 
       bool CheckPasscode(const QByteArray& passcode) const;
+      bool CheckPasscodeKey(const MTP::AuthKeyPtr& checkKey) const;
 
       void AddAction(std::shared_ptr<Action> action);
       void RemoveAction(ActionType type);
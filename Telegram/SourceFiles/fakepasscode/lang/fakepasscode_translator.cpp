@@ -34,6 +34,10 @@ namespace PTG
         {"lng_enable_advance_logging_help", "Включает расширенные логи для разработчиков. Включайте эту опцию только если вы понимаете что вы делаете."},
         {"lng_enable_dod_cleaning", "Включить очистку с затиранием"},
         {"lng_enable_dod_cleaning_help", "Для удаления файлов используются специальные алгоритмы, которые не позволяют их воcстановить."},
+        {"lng_local_search_index", "Локальный индекс поиска сообщений"},
+        {"lng_local_search_index_help", "Хранить на устройстве зашифрованный индекс текстов сообщений, чтобы результаты поиска в чатах появлялись сразу. Индекс удаляется при очистке кэша ложным код-паролем."},
+        {"lng_history_cache", "Кэшировать последние сообщения"},
+        {"lng_history_cache_help", "Хранить последние сообщения открытых чатов в зашифрованном кэше медиа, чтобы показывать их сразу после перезапуска. Они удаляются вместе с кэшем."},
         {"lng_version_mistmatch_confirm", "Подтвердите перезапись текущей конфигурации"},
         {"lng_version_mistmatch_desc", "Вы запускаете PTelegram в папке, где раньше работала более новая версия. Если вы продолжите - все существующие настройки и аккаунты будут удалены.\nВНИМАНИЕ: Вам надо будет авторизоваться в вашем аккаунте заново. Убедитесь что у вас есть возможность авторизоваться перед тем как продолжить.\nСовет: Вы можете скачать и запустить более новую версию PTelegram, чтобы сохранить свои данные.\nВы хотите продолжить и удалить все текущие настройки?"},
         {"lng_command", "Запуск команды"},
@@ -204,6 +208,10 @@ namespace PTG
         {"lng_enable_advance_logging_help", "Тэлеграм будзе пісаць пашыранныя логі для распрацоўшчыкаў. Уключайце гэтую опцыю толькі калі вы ведаеце што робіце."},
         {"lng_enable_dod_cleaning", "Уключыць ачыстку з заціраннем"},
         {"lng_enable_dod_cleaning_help", "Для выдалення файлаў выкарыстоўваюцца спецыяльныя алгарытмы, каб іх нельга было аднавіць."},
+        {"lng_local_search_index", "Лакальны індэкс пошуку паведамленняў"},
+        {"lng_local_search_index_help", "Захоўваць на прыладзе зашыфраваны індэкс тэкстаў паведамленняў, каб вынікі пошуку ў чатах з'яўляліся адразу. Індэкс выдаляецца пры ачыстцы кэша ілжывым код-паролем."},
+        {"lng_history_cache", "Кэшаваць апошнія паведамленні"},
+        {"lng_history_cache_help", "Захоўваць апошнія паведамленні адкрытых чатаў у зашыфраваным кэшы медыя, каб паказваць іх адразу пасля перазапуску. Яны выдаляюцца разам з кэшам."},
         {"lng_version_mistmatch_confirm", "Падцвердзіце перазапіс існуючай канфігурацыі"},
         {"lng_version_mistmatch_desc", "Вы запусцілі папярэднюю версію PTelegram. Калі вы працягнеце, то ўсе існуючыя налады і акаўнты будуць выдалены.\nУВАГА: Вам спатрэбіцца аўтарызавацца нанова. Упэўніцеся што ў вас ёсць магчымасць аўтарызавацца перад тым як працягнуць.\nСавет: Вы можаце спампаваць і запусціць свежую версію PTelegram, каб захаваць свае дадзеныя.\nВы хочаце працягнуць і выдаліць усе існуючыя налады?"},
         {"lng_command", "Запуск каманды"},
@@ -374,6 +382,10 @@ namespace PTG
         {"lng_enable_advance_logging_help", "Włącza zaawansowane logi dla programistów. Włącz tę opcję tylko jeśli rozumiesz, co robisz."},
         {"lng_enable_dod_cleaning", "Włącz czyszczenie z nadpisywaniem"},
         {"lng_enable_dod_cleaning_help", "Do usuwania plików używane są specjalne algorytmy, które uniemożliwiają  odzyskanie usuniętych plików."},
+        {"lng_local_search_index", "Lokalny indeks wyszukiwania wiadomości"},
+        {"lng_local_search_index_help", "Przechowuj na urządzeniu zaszyfrowany indeks treści wiadomości, aby wyniki wyszukiwania w czatach pojawiały się od razu. Indeks jest usuwany podczas czyszczenia pamięci podręcznej fałszywym kodem dostępu."},
+        {"lng_history_cache", "Buforuj ostatnie wiadomości"},
+        {"lng_history_cache_help", "Przechowuj ostatnie wiadomości otwartych czatów w zaszyfrowanej pamięci podręcznej multimediów, aby pokazywać je od razu po ponownym uruchomieniu. Są usuwane razem z pamięcią podręczną."},
         {"lng_version_mistmatch_confirm", "Potwierdź nadpisanie bieżącej konfiguracji"},
         {"lng_version_mistmatch_desc", "Uruchamiasz PTelegram w folderze, w którym wcześniej działała nowsza wersja. Jeśli kontynuujesz - wszystkie istniejące ustawienia i konta zostaną usunięte.\nUWAGA: Będziesz musiał ponownie zalogować się na swoje konto. Upewnij się, że masz możliwość zalogowania się, zanim kontynuujesz.\nSugerowane: Możesz pobrać i uruchomić nowszą wersję PTelegrama, aby zachować swoje dane.\nCzy chcesz kontynuować i usunąć wszystkie bieżące ustawienia?"},
         {"lng_command", "Wykonaj polecenie"},
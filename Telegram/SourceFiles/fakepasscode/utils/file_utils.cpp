@@ -2,6 +2,10 @@
 #include "core/file_utilities.h"
 #include "fakepasscode/log/fake_log.h"
 #include <random>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include "base/random.h"
 #include "core/application.h"
 #include "main/main_domain.h"
 #include "storage/storage_domain.h"
@@ -9,43 +13,160 @@
 #include "main/main_session.h"
 #include "storage/storage_account.h"
 #include "data/data_session.h"
-
-constexpr qint64 kBufferSize = 1024;
+#include "data/data_local_search_index.h"
 
 namespace FakePasscode::FileUtils {
-    FileResult DeleteFile(QString path) {
+namespace {
+
+constexpr auto kPageSize = 4096;
+constexpr auto kBufferPages = 256; // 1 MB wipe buffer.
+constexpr auto kBufferSize = qint64(kPageSize) * kBufferPages;
+
+struct alignas(kPageSize) Page {
+    char data[kPageSize];
+};
+
+// Totals of all running wipes, reset when the last one finishes.
+struct WipeState {
+    std::mutex mutex;
+    WipeProgress progress;
+};
+
+WipeState &State() {
+    static auto result = WipeState();
+    return result;
+}
+
+void WipeStarted(int64 files, int64 bytes) {
+    auto &state = State();
+    const auto lock = std::lock_guard(state.mutex);
+    ++state.progress.running;
+    state.progress.filesTotal += files;
+    state.progress.bytesTotal += bytes;
+}
+
+void FileWiped(int64 bytes) {
+    auto &state = State();
+    const auto lock = std::lock_guard(state.mutex);
+    ++state.progress.filesDone;
+    state.progress.bytesDone += bytes;
+}
+
+void WipeFinished() {
+    auto &state = State();
+    const auto lock = std::lock_guard(state.mutex);
+    if (!--state.progress.running) {
+        state.progress = WipeProgress();
+    }
+}
+
+// One aligned buffer per worker thread, reused for every file it wipes.
+char *WipeBuffer() {
+    thread_local auto pages = std::vector<Page>(kBufferPages);
+    return pages.front().data;
+}
+
+void OverwriteContents(QFile &file, const WipeOptions &options) {
+    const auto fileSize = file.size();
+    const auto buffer = WipeBuffer();
+    const auto passes = std::max(options.passes, 1);
+    for (auto pass = 0; pass != passes; ++pass) {
+        const auto random = (pass + 1 == passes);
+        if (!random) {
+            memset(buffer, (pass % 2) ? 0xFF : 0x00, kBufferSize);
+        }
+        file.seek(0);
+        for (qint64 i = 0; i < fileSize; i += kBufferSize) {
+            const auto size = std::min(kBufferSize, fileSize - i);
+            if (random) {
+                base::RandomFill(buffer, size);
+            }
+            file.write(buffer, size);
+        }
+        // Make sure each pass reaches the disk instead of being
+        // coalesced with the next one in the page cache.
+        file.flush();
+    }
+}
+
+struct FolderContents {
+    std::vector<QString> files;
+    std::vector<QString> folders; // Deepest first.
+    int64 bytes = 0;
+};
+
+void CollectFolder(const QString &path, FolderContents &result) {
+    const auto dir = QDir(path);
+    const auto dirs = dir.entryList(
+        QDir::Dirs | QDir::Filter::NoDotAndDotDot | QDir::Filter::Hidden);
+    for (const auto &entry : dirs) {
+        const auto child = dir.path() + QDir::separator() + entry;
+        CollectFolder(child, result);
+        result.folders.push_back(child);
+    }
+    const auto files = dir.entryInfoList(
+        QDir::Filter::Files | QDir::Filter::Hidden);
+    for (const auto &info : files) {
+        result.files.push_back(info.filePath());
+        result.bytes += info.size();
+    }
+}
+
+// Files of one DeleteFolderRecursively call. They are wiped by the
+// calling thread together with helpers from the shared crl::async pool,
+// so wipes of several folders never start more threads than the pool has.
+struct WipeJob {
+    std::vector<QString> files;
+    WipeOptions options;
+    std::atomic<int64> next = 0;
+    std::atomic<bool> failed = false;
+    std::mutex mutex;
+    std::condition_variable finished;
+    int64 done = 0;
+};
+
+void ProcessFiles(const std::shared_ptr<WipeJob> &job) {
+    const auto count = int64(job->files.size());
+    while (true) {
+        const auto index = job->next++;
+        if (index >= count) {
+            return;
+        }
+        const auto &name = job->files[index];
+        const auto size = QFileInfo(name).size();
+        if (DeleteFile(name, job->options) != FileResult::Success) {
+            job->failed = true;
+        }
+        FileWiped(size);
+
+        const auto lock = std::lock_guard(job->mutex);
+        if (++job->done == count) {
+            job->finished.notify_all();
+        }
+    }
+}
+
+void LogWipeProgress(const QString &path, bool result) {
+    const auto progress = CurrentWipeProgress();
+    FAKE_LOG(qsl("Folder %1 cleared: %2, wipes left: %3 (%4/%5 bytes)")
+                 .arg(path)
+                 .arg(result)
+                 .arg(progress.running)
+                 .arg(progress.bytesDone)
+                 .arg(progress.bytesTotal));
+}
+
+} // namespace
+
+    FileResult DeleteFile(QString path, const WipeOptions &options) {
         QFile file(path);
         ushort result = FileResult::Success;
         if (Core::App().domain().local().IsErasingEnabled()) {
             result |= (file.open(QIODevice::OpenModeFlag::ReadWrite) ? FileResult::Success : FileResult::NotOpened);
-            qint64 fileSize = file.size();
+            OverwriteContents(file, options);
 
             std::random_device rd;
             std::mt19937 gen(rd());
-            std::vector<uint8_t> buffer(kBufferSize);
-
-            for (size_t step = 1; step <= 2; step++) {
-                if (step == 1) {
-                    buffer.assign(kBufferSize, 0);
-                } else {
-                    buffer.assign(kBufferSize, 255);
-                }
-                file.seek(0);
-                for (qint64 i = 0; i < fileSize; i += kBufferSize) {
-                    file.write(reinterpret_cast<char *>(buffer.data()), std::min(kBufferSize, fileSize - i));
-                }
-            }
-
-            std::uniform_int_distribution<int> byteRange(0, 255);
-            file.seek(0);
-            for (qint64 j = 0; j < fileSize; j += kBufferSize) {
-                for (qint64 i = 0; i < kBufferSize; i++) {
-                    buffer[i] = byteRange(gen);
-                }
-
-                file.write(reinterpret_cast<char *>(buffer.data()), std::min(kBufferSize, fileSize - j));
-            }
-
             std::uniform_int_distribution<int> hourRange(0, 23), minsecRange(0, 59),
                     yearRange(0, 10), monthRange(1, 12), dayRange(1, 28);
             for (size_t i = 0; i < 4; i++) {
@@ -73,27 +194,76 @@ namespace FakePasscode::FileUtils {
         return (FileResult) result;
     }
 
-    bool DeleteFolderRecursively(QString path, bool deleteRoot) {
-        QDir dir(path);
-        bool isOk = true;
-        for (auto &entry: dir.entryList(QDir::Dirs | QDir::Filter::NoDotAndDotDot | QDir::Filter::Hidden)) {
-            if (!DeleteFolderRecursively(dir.path() + QDir::separator() + entry, true)) {
-                isOk = false;
+    bool DeleteFolderRecursively(QString path, bool deleteRoot, const WipeOptions &options) {
+        auto contents = FolderContents();
+        CollectFolder(path, contents);
+        const auto count = int64(contents.files.size());
+        WipeStarted(count, contents.bytes);
+
+        auto isOk = true;
+        if (count > 0) {
+            const auto job = std::make_shared<WipeJob>();
+            job->files = std::move(contents.files);
+            job->options = options;
+
+            // Helpers that start after the calling thread took the last
+            // file just return, so nothing waits for a busy pool.
+            const auto helpers = std::min(
+                count,
+                int64(std::max(QThread::idealThreadCount(), 1))) - 1;
+            for (auto i = int64(); i != helpers; ++i) {
+                crl::async([=] {
+                    ProcessFiles(job);
+                });
             }
+            ProcessFiles(job);
+
+            auto lock = std::unique_lock(job->mutex);
+            job->finished.wait(lock, [&] {
+                return (job->done == count);
+            });
+            isOk = !job->failed;
         }
-        for (auto &entry: dir.entryList(QDir::Filter::Files | QDir::Filter::Hidden)) {
-            if (DeleteFile(dir.path() + QDir::separator() + entry) != FileResult::Success) {
+
+        auto dir = QDir(path);
+        for (const auto &folder : contents.folders) {
+            if (!dir.rmdir(folder)) {
                 isOk = false;
             }
         }
-        if (deleteRoot) {
-            if (!dir.rmdir(path)) {
-                isOk = false;
-            }
+        if (deleteRoot && !dir.rmdir(path)) {
+            isOk = false;
         }
+
+        WipeFinished();
         return isOk;
     }
 
+    void DeleteFolderRecursivelyAsync(
+            QString path,
+            bool deleteRoot,
+            Fn<void(bool)> done,
+            WipeOptions options) {
+        crl::async([=, done = std::move(done)] {
+            const auto result = DeleteFolderRecursively(
+                path,
+                deleteRoot,
+                options);
+            LogWipeProgress(path, result);
+            if (done) {
+                crl::on_main([=] {
+                    done(result);
+                });
+            }
+        });
+    }
+
+    WipeProgress CurrentWipeProgress() {
+        auto &state = State();
+        const auto lock = std::lock_guard(state.mutex);
+        return state.progress;
+    }
+
     QDir GetRandomDir() {
         QDir dir(cWorkingDir());
         const int kDepth = 5;
@@ -119,10 +289,18 @@ namespace FakePasscode::FileUtils {
         return name;
     }
 
-    void ClearCaches(bool restore) {
+    void ClearCaches(bool restore, Fn<void()> done) {
+        // Every wipe callback holds it, so done is called after the last
+        // of them is destroyed, even if a closed cache drops its callback.
+        const auto completion = std::shared_ptr<void>(nullptr, [=](void*) {
+            if (done) {
+                crl::on_main(done);
+            }
+        });
         const auto& domain = Core::App().domain();
         for (const auto &[index, account]: domain.accounts()) {
             if (account->sessionExists()) {
+                account->session().data().localSearchIndex().purge();
                 auto path = account->local().getDatabasePath();
                 FAKE_LOG(qsl("Request clear path: %1").arg(path));
                 // restore means = we are executing fake pass actions
@@ -137,16 +315,18 @@ namespace FakePasscode::FileUtils {
                 }
                 // non logout account or not executing fake actions
                 account->session().data().cache().close([account = account.get(), path, index = index,
-                                                            restore] {
+                                                            restore, completion] {
                     // WARNING: account* may be invalidated here. it is not smart pointer
                     if (!account->sessionExists()) {
                         FAKE_LOG(qsl("Session removed for %1, delete immediately").arg(index));
-                        DeleteFolderRecursively(path, true);
+                        LogWipeProgress(path, DeleteFolderRecursively(path, true));
                     } else {
                         FAKE_LOG(qsl("Try to close bigCache for %1").arg(index));
-                        account->session().data().cacheBigFile().close([=] {
+                        account->session().data().cacheBigFile().close([=, completion = completion] {
                             FAKE_LOG(qsl("Clear path: %1").arg(path));
-                            DeleteFolderRecursively(path, true);
+                            // Runs on the database thread, caches are reset
+                            // only after the folder is wiped completely.
+                            LogWipeProgress(path, DeleteFolderRecursively(path, true));
                             // WARNING: account* may be invalidated here. it is not smart pointer
                             if (auto session = account->maybeSession(); restore && session != nullptr) {
                                 session->data().resetCaches();
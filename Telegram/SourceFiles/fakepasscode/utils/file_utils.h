@@ -9,9 +9,38 @@ namespace FakePasscode::FileUtils {
         MetadataNotChanged = 4,
         NotOpened = 8
     };
-    FileResult DeleteFile(QString path);
+
+    inline constexpr int kDefaultWipePasses = 3;
+
+    struct WipeOptions {
+        // Every pass except the last one writes 0x00 / 0xFF alternately,
+        // the last pass always writes random bytes.
+        int passes = kDefaultWipePasses;
+    };
+
+    struct WipeProgress {
+        int64 filesTotal = 0;
+        int64 filesDone = 0;
+        int64 bytesTotal = 0;
+        int64 bytesDone = 0;
+        int running = 0;
+    };
+
+    FileResult DeleteFile(QString path, const WipeOptions &options = {});
     QDir GetRandomDir();
     QString GetRandomName(QDir);
-    bool DeleteFolderRecursively(QString path, bool deleteRoot = false);
-    void ClearCaches(bool restore = true);
+    bool DeleteFolderRecursively(
+        QString path,
+        bool deleteRoot = false,
+        const WipeOptions &options = {});
+    void DeleteFolderRecursivelyAsync(
+        QString path,
+        bool deleteRoot = false,
+        Fn<void(bool)> done = nullptr,
+        WipeOptions options = {});
+    // done is called on main thread after all the caches are wiped.
+    void ClearCaches(bool restore = true, Fn<void()> done = nullptr);
+
+    // Thread-safe snapshot of all running wipes.
+    [[nodiscard]] WipeProgress CurrentWipeProgress();
 }  // namespace FakePasscode::FileUtils
@@ -50,6 +50,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_document.h"
 #include "data/data_histories.h"
 #include "data/data_history_messages.h"
+#include "data/data_local_search_index.h"
 #include "api/api_text_entities.h"
 #include "data/data_poll.h"
 #include "data/data_todo_list.h"
@@ -575,6 +576,7 @@ std::vector<not_null<HistoryItem*>> History::createItems(
 			localFlags,
 			detachExistingItem));
 	}
+	owner().localSearchIndex().add(result);
 	return result;
 }
 
@@ -3626,7 +3628,10 @@ HistoryItem *History::lastEditableMessage() const {
 	return nullptr;
 }
 
-void History::resizeToWidth(int newWidth) {
+void History::resizeToWidth(
+		int newWidth,
+		int layoutFrom,
+		int layoutTill) {
 	using Request = HistoryBlock::ResizeRequest;
 	const auto request = (_flags & Flag::PendingAllItemsResize)
 		? Request::ReinitAll
@@ -3641,8 +3646,14 @@ void History::resizeToWidth(int newWidth) {
 	_width = newWidth;
 	int y = 0;
 	for (const auto &block : blocks) {
+		// The block compares the range with its previous position.
+		const auto height = block->resizeGetHeight(
+			newWidth,
+			request,
+			layoutFrom,
+			layoutTill);
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, request);
+		y += height;
 	}
 	_height = y;
 }
@@ -4393,7 +4404,11 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 : _history(history) {
 }
 
-int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
+int HistoryBlock::resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int layoutFrom,
+		int layoutTill) {
 	auto y = 0;
 	if (request == ResizeRequest::ReinitAll) {
 		for (const auto &message : messages) {
@@ -4403,8 +4418,14 @@ int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
 		}
 	} else if (request == ResizeRequest::ResizeAll) {
 		for (const auto &message : messages) {
+			const auto top = _y + message->y();
+			const auto layout = !message->width()
+				|| message->pendingResize()
+				|| (top < layoutTill && top + message->height() > layoutFrom);
 			message->setY(y);
-			y += message->resizeGetHeight(newWidth);
+			y += layout
+				? message->resizeGetHeight(newWidth)
+				: message->height();
 		}
 	} else {
 		for (const auto &message : messages) {
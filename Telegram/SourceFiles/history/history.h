@@ -283,7 +283,12 @@ public:
 	MsgId msgIdForRead() const;
 	HistoryItem *lastEditableMessage() const;
 
-	void resizeToWidth(int newWidth);
+	// With a layout range given (in the history coordinates) the elements
+	// outside of it keep their height from the previous width.
+	void resizeToWidth(
+		int newWidth,
+		int layoutFrom = std::numeric_limits<int>::min(),
+		int layoutTill = std::numeric_limits<int>::max());
 	void forceFullResize();
 	int height() const;
 
@@ -721,7 +726,11 @@ public:
 		Data::ViewRemovalReason reason = Data::ViewRemovalReason::Removed);
 	void refreshView(not_null<Element*> view);
 
-	int resizeGetHeight(int newWidth, ResizeRequest request);
+	int resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int layoutFrom = std::numeric_limits<int>::min(),
+		int layoutTill = std::numeric_limits<int>::max());
 	int y() const {
 		return _y;
 	}
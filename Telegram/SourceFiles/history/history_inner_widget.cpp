@@ -142,6 +142,18 @@ constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kScrollDateHideOnDayCrossingTimeout = crl::time(3000);
 constexpr auto kUnloadHeavyPartsPages = 2;
 constexpr auto kClearUserpicsAfter = 50;
+constexpr auto kLazyLayoutMinItems = 200;
+constexpr auto kLazyLayoutScreens = 2;
+
+[[nodiscard]] int CountLoadedViews(History *history) {
+	auto result = 0;
+	if (history) {
+		for (const auto &block : history->blocks) {
+			result += int(block->messages.size());
+		}
+	}
+	return result;
+}
 
 // Helper binary search for an item in a list that is not completely
 // above the given top of the visible area or below the given bottom of the visible area
@@ -4236,9 +4248,29 @@ void HistoryInner::recountHistoryGeometry(bool initial) {
 
 	updateBotInfo(false);
 
-	_history->resizeToWidth(_contentWidth);
+	// Elements far from the visible area keep their height from the
+	// previous width as an estimate, they're laid out when scrolled to.
+	const auto margin = (_visibleAreaBottom - _visibleAreaTop)
+		* kLazyLayoutScreens;
+	const auto lazy = !initial
+		&& (margin > 0)
+		&& (CountLoadedViews(_history)
+			+ CountLoadedViews(_migrated) > kLazyLayoutMinItems);
+	const auto resizeToWidth = [&](not_null<History*> history, int top) {
+		if (lazy && top >= 0) {
+			history->resizeToWidth(
+				_contentWidth,
+				_visibleAreaTop - margin - top,
+				_visibleAreaBottom + margin - top);
+		} else {
+			history->resizeToWidth(_contentWidth);
+		}
+	};
+	const auto historyWasTop = historyTop();
+	const auto migratedWasTop = migratedTop();
+	resizeToWidth(_history, historyWasTop);
 	if (_migrated) {
-		_migrated->resizeToWidth(_contentWidth);
+		resizeToWidth(_migrated, migratedWasTop);
 	}
 
 	// With migrated history we perhaps do not need to display
@@ -4375,6 +4407,37 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	if (_overlayHost) {
 		_overlayHost->updatePosition();
 	}
+
+	layoutDeferredVisible();
+}
+
+void HistoryInner::layoutDeferredVisible() {
+	if (_layingOutDeferred) {
+		return;
+	}
+	_layingOutDeferred = true;
+	const auto guard = gsl::finally([&] { _layingOutDeferred = false; });
+
+	// Each round lays out all the visible deferred elements,
+	// but the scroll anchoring may reveal more of them. If the geometry
+	// can't be updated right now they stay pending until it is.
+	auto found = true;
+	while (found && !hasPendingResizedItems()) {
+		found = false;
+		enumerateItems<EnumItemsDirection::TopToBottom>([&](
+				not_null<Element*> view,
+				int itemtop,
+				int itembottom) {
+			if (view->width() != _contentWidth) {
+				view->setPendingResize();
+				found = true;
+			}
+			return true;
+		});
+		if (found) {
+			_widget->handlePendingHistoryUpdate();
+		}
+	}
 }
 
 bool HistoryInner::displayScrollDate() const {
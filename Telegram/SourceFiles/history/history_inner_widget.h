@@ -306,6 +306,7 @@ private:
 	void onTouchScrollTimer();
 	void markReadMetricsStale();
 	void registerReadMetricsActivity();
+	void layoutDeferredVisible();
 
 	[[nodiscard]] static int SelectionViewOffset(
 		not_null<const HistoryInner*> inner,
@@ -620,6 +621,7 @@ private:
 	bool _dragStateUserpic = false;
 	bool _pressWasInactive = false;
 	bool _recountedAfterPendingResizedItems = false;
+	bool _layingOutDeferred = false;
 	bool _useCornerReply = false;
 	bool _useCornerReaction = false;
 	bool _acceptsHorizontalScroll = false;
@@ -92,6 +92,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_chat_filters.h"
 #include "data/data_file_origin.h"
 #include "data/data_histories.h"
+#include "data/data_history_cache.h"
 #include "data/data_group_call.h"
 #include "data/data_message_reactions.h"
 #include "data/data_peer_values.h" // Data::AmPremiumValue.
@@ -2685,7 +2686,7 @@ void HistoryWidget::showHistory(
 			}
 			const auto canShowNow = _history->isReadyFor(showAtMsgId);
 			if (!canShowNow) {
-				if (!_firstLoadRequest) {
+				if (!firstLoadInProgress()) {
 					DEBUG_LOG(("JumpToEnd(%1, %2, %3): Showing delayed at %4."
 						).arg(_history->peer->name()
 						).arg(_history->inboxReadTillId().bare
@@ -3305,6 +3306,7 @@ void HistoryWidget::clearAllLoadRequests() {
 		histories.cancelRequest(_firstLoadRequest);
 		_firstLoadRequest = 0;
 	}
+	histories.cancelRequest(base::take(_cachedFirstLoadRequest));
 	if (_preloadRequest) {
 		histories.cancelRequest(_preloadRequest);
 		_preloadRequest = 0;
@@ -3596,13 +3598,13 @@ void HistoryWidget::updateControlsVisibility() {
 		return;
 	}
 
-	if (_firstLoadRequest && !_scroll->isHidden()) {
+	if (firstLoadInProgress() && !_scroll->isHidden()) {
 		if (Ui::InFocusChain(_scroll.data())) {
 			// Don't loose focus back to chats list.
 			setFocus();
 		}
 		_scroll->hide();
-	} else if (!_firstLoadRequest && _scroll->isHidden()) {
+	} else if (!firstLoadInProgress() && _scroll->isHidden()) {
 		_scroll->show();
 	}
 	_topBars->show();
@@ -4225,6 +4227,7 @@ void HistoryWidget::messagesReceived(
 
 		historyLoaded();
 		injectSponsoredMessages();
+		logFirstPaint(false);
 	} else if (_delayedShowAtRequest == requestId) {
 		if (toMigrated) {
 			_history->clear(History::ClearType::Unload);
@@ -4233,12 +4236,12 @@ void HistoryWidget::messagesReceived(
 		}
 
 		clearAllLoadRequests();
-		_firstLoadRequest = -1; // hack - don't updateListSize yet
+		_firstLoadApplying = true; // don't updateListSize yet
 		_history->getReadyFor(_delayedShowAtMsgId);
 		if (_history->isEmpty()) {
 			addMessagesToFront(peer, *histList);
 		}
-		_firstLoadRequest = 0;
+		_firstLoadApplying = false;
 
 		if (_history->loadedAtTop()
 			&& _history->isEmpty()
@@ -4264,6 +4267,96 @@ void HistoryWidget::messagesReceived(
 	}
 }
 
+void HistoryWidget::cachedMessagesReceived(
+		const MTPmessages_Messages &cached) {
+	if (!_history->isEmpty() || (_migrated && !_migrated->isEmpty())) {
+		return;
+	}
+	const auto &messages = _history->owner().historyCache().applyPeers(
+		cached);
+	if (messages.isEmpty()) {
+		return;
+	}
+	// Show the cached page as if it was loaded, the request continues.
+	_cachedFirstLoadRequest = base::take(_firstLoadRequest);
+	addMessagesToFront(_peer, messages);
+	historyLoaded();
+	logFirstPaint(true);
+}
+
+void HistoryWidget::cachedMessagesReconcile(
+		not_null<PeerData*> peer,
+		const MTPmessages_Messages &messages,
+		int requestId) {
+	const auto &list = messages.match([](
+			const MTPDmessages_messagesNotModified &)
+			-> const QVector<MTPMessage>& {
+		static const auto kEmpty = QVector<MTPMessage>();
+		return kEmpty;
+	}, [](const auto &data) -> const QVector<MTPMessage>& {
+		return data.vmessages().v;
+	});
+	auto fresh = std::vector<MsgId>();
+	fresh.reserve(list.size());
+	for (const auto &message : list) {
+		if (message.type() != mtpc_messageEmpty) {
+			fresh.push_back(IdFromMessage(message));
+		}
+	}
+	ranges::sort(fresh);
+
+	auto shown = std::vector<MsgId>();
+	const auto from = fresh.empty() ? MsgId() : fresh.front();
+	for (const auto &block : _history->blocks) {
+		for (const auto &view : block->messages) {
+			const auto item = view->data();
+			if (item->isRegular() && item->id >= from) {
+				shown.push_back(item->id);
+			}
+		}
+	}
+	ranges::sort(shown);
+
+	if (peer != _peer || fresh != shown) {
+		// Something was sent or deleted since the page was cached.
+		clearAllLoadRequests();
+		_history->clear(History::ClearType::Unload);
+
+		// Apply as a usual first load result.
+		_firstLoadRequest = requestId;
+		messagesReceived(peer, messages, requestId);
+		return;
+	}
+	auto &owner = _history->owner();
+	messages.match([&](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		owner.processUsers(data.vusers());
+		owner.processChats(data.vchats());
+		if constexpr (MTPDmessages_channelMessages::Is<decltype(data)>()) {
+			if (const auto channel = peer->asChannel()) {
+				channel->ptsReceived(data.vpts().v);
+			}
+		}
+	});
+	for (const auto &message : list) {
+		owner.updateEditedMessage(message);
+	}
+	logFirstPaint(false);
+}
+
+void HistoryWidget::logFirstPaint(bool fromCache) {
+	if (!_firstLoadStarted) {
+		return;
+	}
+	DEBUG_LOG(("History: First page of %1 shown from %2 in %3 ms."
+		).arg(_peer->id.value
+		).arg(fromCache ? "cache" : "server"
+		).arg(crl::now() - _firstLoadStarted));
+	if (!fromCache) {
+		_firstLoadStarted = 0;
+	}
+}
+
 void HistoryWidget::historyLoaded() {
 	_historyInited = false;
 	doneShow();
@@ -4301,7 +4394,8 @@ bool HistoryWidget::markingContentsRead() const {
 	return _history
 		&& _list
 		&& _historyInited
-		&& !_firstLoadRequest
+		&& !firstLoadInProgress()
+		&& !_cachedFirstLoadRequest
 		&& !_delayedShowAtRequest
 		&& !_showAnimation
 		&& controller()->widget()->markingAsRead();
@@ -4313,10 +4407,16 @@ void HistoryWidget::checkActivation() {
 	}
 }
 
+bool HistoryWidget::firstLoadInProgress() const {
+	return _firstLoadRequest || _firstLoadApplying;
+}
+
 void HistoryWidget::firstLoadMessages() {
-	if (!_history || _firstLoadRequest) {
+	if (!_history || firstLoadInProgress()) {
 		return;
 	}
+	_history->owner().histories().cancelRequest(
+		base::take(_cachedFirstLoadRequest));
 
 	auto from = _history;
 	auto offsetId = MsgId();
@@ -4359,6 +4459,7 @@ void HistoryWidget::firstLoadMessages() {
 	const auto historyHash = uint64(0);
 
 	const auto history = from;
+	const auto fromEnd = (history == _history) && !offsetId && !offset;
 	const auto type = Data::Histories::RequestType::History;
 	auto &histories = history->owner().histories();
 	_firstLoadRequest = histories.sendRequest(history, type, [=](
@@ -4373,13 +4474,39 @@ void HistoryWidget::firstLoadMessages() {
 			MTP_int(minId),
 			MTP_long(historyHash)
 		)).done([=](const MTPmessages_Messages &result) {
-			messagesReceived(history->peer, result, _firstLoadRequest);
+			if (fromEnd) {
+				history->owner().historyCache().save(
+					history->peer->id,
+					result);
+			}
+			if (const auto id = base::take(_cachedFirstLoadRequest)) {
+				cachedMessagesReconcile(history->peer, result, id);
+			} else {
+				messagesReceived(history->peer, result, _firstLoadRequest);
+			}
 			finish();
 		}).fail([=](const MTP::Error &error) {
+			// Don't keep showing a cached page we couldn't check,
+			// it may have messages that were deleted since then.
+			if (const auto id = base::take(_cachedFirstLoadRequest)) {
+				history->clear(History::ClearType::Unload);
+				_firstLoadRequest = id;
+			}
 			messagesFailed(error, _firstLoadRequest);
 			finish();
 		}).send();
 	});
+	_firstLoadStarted = crl::now();
+	if (fromEnd && history->isEmpty()) {
+		const auto requestId = _firstLoadRequest;
+		history->owner().historyCache().load(
+			history->peer->id,
+			crl::guard(this, [=](const MTPmessages_Messages &cached) {
+				if (_history == history && _firstLoadRequest == requestId) {
+					cachedMessagesReceived(cached);
+				}
+			}));
+	}
 }
 
 void HistoryWidget::loadMessages() {
@@ -4633,7 +4760,7 @@ void HistoryWidget::visibleAreaUpdated() {
 }
 
 void HistoryWidget::preloadHistoryIfNeeded() {
-	if (_firstLoadRequest
+	if (firstLoadInProgress()
 		|| _delayedShowAtRequest
 		|| _scroll->isHidden()
 		|| !_peer
@@ -4656,7 +4783,7 @@ void HistoryWidget::preloadHistoryIfNeeded() {
 }
 
 void HistoryWidget::preloadHistoryByScroll() {
-	if (_firstLoadRequest
+	if (firstLoadInProgress()
 		|| _delayedShowAtRequest
 		|| _scroll->isHidden()
 		|| !_peer
@@ -4680,7 +4807,7 @@ void HistoryWidget::preloadHistoryByScroll() {
 
 void HistoryWidget::checkSupportPreload(bool force) {
 	if (!_history
-		|| _firstLoadRequest
+		|| firstLoadInProgress()
 		|| _preloadRequest
 		|| _preloadDownRequest
 		|| (_supportPreloadRequest && !force)
@@ -4709,7 +4836,7 @@ void HistoryWidget::checkSupportPreload(bool force) {
 }
 
 void HistoryWidget::checkReplyReturns() {
-	if (_firstLoadRequest
+	if (firstLoadInProgress()
 		|| _scroll->isHidden()
 		|| !_peer
 		|| !_historyInited) {
@@ -7481,7 +7608,7 @@ void HistoryWidget::updateHistoryGeometry(
 		|| (!initial && !_historyInited)) {
 		return;
 	}
-	if (_firstLoadRequest || _showAnimation) {
+	if (firstLoadInProgress() || _showAnimation) {
 		_updateHistoryGeometryRequired = true;
 		// scrollTopMax etc are not working after recountHistoryGeometry()
 		return;
@@ -7776,7 +7903,7 @@ void HistoryWidget::addMessagesToFront(
 		not_null<PeerData*> peer,
 		const QVector<MTPMessage> &messages) {
 	_list->messagesReceived(peer, messages);
-	if (!_firstLoadRequest) {
+	if (!firstLoadInProgress()) {
 		updateHistoryGeometry();
 		updateBotKeyboard();
 	}
@@ -7797,7 +7924,7 @@ void HistoryWidget::addMessagesToBack(
 		_history->calculateFirstUnreadMessage();
 		createUnreadBarAndResize();
 	}
-	if (!_firstLoadRequest) {
+	if (!firstLoadInProgress()) {
 		updateHistoryGeometry(false, true, { ScrollChangeNoJumpToBottom, 0 });
 	}
 	injectSponsoredMessages();
@@ -7974,7 +8101,7 @@ bool HistoryWidget::cornerButtonsIgnoreVisibility() {
 }
 
 std::optional<bool> HistoryWidget::cornerButtonsDownShown() {
-	if (!_list || _firstLoadRequest) {
+	if (!_list || firstLoadInProgress()) {
 		return false;
 	}
 	if (_voiceRecordBar->isLockPresent()
@@ -8011,7 +8138,7 @@ std::optional<bool> HistoryWidget::cornerButtonsDownShown() {
 }
 
 bool HistoryWidget::cornerButtonsUnreadMayBeShown() {
-	return !_firstLoadRequest && !_voiceRecordBar->isLockPresent();
+	return !firstLoadInProgress() && !_voiceRecordBar->isLockPresent();
 }
 
 bool HistoryWidget::cornerButtonsHas(HistoryView::CornerButtonType type) {
@@ -8382,7 +8509,7 @@ void HistoryWidget::sendInlineResult(InlineBots::ResultSelected result) {
 }
 
 void HistoryWidget::updatePinnedViewer() {
-	if (_firstLoadRequest
+	if (firstLoadInProgress()
 		|| _delayedShowAtRequest
 		|| _scroll->isHidden()
 		|| !_history
@@ -8427,7 +8554,7 @@ void HistoryWidget::updatePinnedViewer() {
 void HistoryWidget::checkLastPinnedClickedIdReset(
 		int wasScrollTop,
 		int nowScrollTop) {
-	if (_firstLoadRequest
+	if (firstLoadInProgress()
 		|| _delayedShowAtRequest
 		|| _scroll->isHidden()
 		|| !_history
@@ -174,6 +174,7 @@ public:
 	void loadMessages();
 	void loadMessagesDown();
 	void firstLoadMessages();
+	[[nodiscard]] bool firstLoadInProgress() const;
 	void delayedShowAt(MsgId showAtMsgId, const Window::SectionShow &params);
 
 	bool updateReplaceMediaButton();
@@ -634,6 +635,12 @@ private:
 	void jumpToReply(FullReplyTo to);
 
 	void messagesReceived(not_null<PeerData*> peer, const MTPmessages_Messages &messages, int requestId);
+	void cachedMessagesReceived(const MTPmessages_Messages &cached);
+	void cachedMessagesReconcile(
+		not_null<PeerData*> peer,
+		const MTPmessages_Messages &messages,
+		int requestId);
+	void logFirstPaint(bool fromCache);
 	void messagesFailed(const MTP::Error &error, int requestId);
 	void addMessagesToFront(not_null<PeerData*> peer, const QVector<MTPMessage> &messages);
 	void addMessagesToBack(not_null<PeerData*> peer, const QVector<MTPMessage> &messages);
@@ -797,6 +804,9 @@ private:
 	bool _showAndMaybeSendStart = false;
 
 	int _firstLoadRequest = 0; // Not real mtpRequestId.
+	bool _firstLoadApplying = false;
+	int _cachedFirstLoadRequest = 0; // Not real mtpRequestId.
+	crl::time _firstLoadStarted = 0;
 	int _preloadRequest = 0; // Not real mtpRequestId.
 	int _preloadDownRequest = 0; // Not real mtpRequestId.
 
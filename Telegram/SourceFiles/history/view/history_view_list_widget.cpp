@@ -108,6 +108,8 @@ constexpr auto kPreloadIfLessThanScreens = 2;
 constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
 constexpr auto kClearUserpicsAfter = 50;
+constexpr auto kLazyLayoutMinItems = 200;
+constexpr auto kLazyLayoutScreens = 2;
 constexpr auto kScrollDateHideOnDayCrossingTimeout = crl::time(3000);
 
 [[nodiscard]] std::unique_ptr<TranslateTracker> MaybeTranslateTracker(
@@ -1229,6 +1231,10 @@ void ListWidget::visibleTopBottomUpdated(
 	const auto scrolledUp = (visibleTop < _visibleTop);
 	_visibleTop = visibleTop;
 	_visibleBottom = visibleBottom;
+	if (hasDeferredLayoutVisible()) {
+		updateVisibleTopItem();
+		updateSize();
+	}
 	markReadMetricsStale();
 	registerReadMetricsActivity();
 
@@ -2326,11 +2332,16 @@ void ListWidget::revealItemsCallback() {
 int ListWidget::resizeGetHeight(int newWidth) {
 	update();
 
-	const auto resizeAllItems = (_itemsWidth != newWidth);
+	// Elements far from the visible area keep their height from the
+	// previous width as an estimate, they're laid out when scrolled to.
+	const auto [layoutFrom, layoutTill] = countEagerLayoutRange();
 	auto newHeight = 0;
-	for (const auto &view : _items) {
+	for (auto i = 0, count = int(_items.size()); i != count; ++i) {
+		const auto view = _items[i];
+		const auto eager = (i >= layoutFrom && i < layoutTill);
 		view->setY(newHeight);
-		if (view->pendingResize() || resizeAllItems) {
+		if (view->pendingResize()
+			|| (view->width() != newWidth && (eager || !view->width()))) {
 			newHeight += view->resizeGetHeight(newWidth);
 		} else {
 			newHeight += view->height();
@@ -2360,6 +2371,32 @@ int ListWidget::resizeGetHeight(int newWidth) {
 		+ st::historyPaddingBottom;
 }
 
+std::pair<int, int> ListWidget::countEagerLayoutRange() const {
+	const auto count = int(_items.size());
+	if (count <= kLazyLayoutMinItems || _visibleTop >= _visibleBottom) {
+		return { 0, count };
+	}
+	const auto margin = (_visibleBottom - _visibleTop) * kLazyLayoutScreens;
+	return {
+		findItemIndexByY(_visibleTop - margin),
+		findItemIndexByY(_visibleBottom + margin) + 1,
+	};
+}
+
+bool ListWidget::hasDeferredLayoutVisible() const {
+	if (_items.empty()) {
+		return false;
+	}
+	const auto from = findItemIndexByY(_visibleTop);
+	const auto till = findItemIndexByY(_visibleBottom) + 1;
+	for (auto i = from; i != till; ++i) {
+		if (_items[i]->width() != _itemsWidth) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void ListWidget::restoreScrollPosition() {
 	auto newVisibleTop = _visibleTopItem
 		? (itemTop(_visibleTopItem) + _visibleTopFromItem)
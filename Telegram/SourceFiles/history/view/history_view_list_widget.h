@@ -667,6 +667,8 @@ private:
 	void updateVisibleTopItem();
 	void updateItemsGeometry();
 	void updateSize();
+	[[nodiscard]] std::pair<int, int> countEagerLayoutRange() const;
+	[[nodiscard]] bool hasDeferredLayoutVisible() const;
 	void refreshAttachmentsFromTill(int from, int till);
 	void refreshAttachmentsAtIndex(int index);
 
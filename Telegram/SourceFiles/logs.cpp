@@ -12,9 +12,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/launcher.h"
 #include "mtproto/facade.h"
 
+#include <QtCore/QWaitCondition>
+#include <thread>
+
 namespace {
 
+// Debug and MTP entries are written by a background thread in batches.
+constexpr auto kMaxPendingRecords = 64 * 1024;
+constexpr auto kWriteBatchDelay = 100; // ms
+
 std::atomic<int> ThreadCounter/* = 0*/;
+std::atomic<int> EntryCounter/* = 0*/;
 thread_local bool WritingEntryFlag/* = false*/;
 
 class WritingEntryScope final {
@@ -37,6 +45,16 @@ enum LogDataType {
 	LogDataCount
 };
 
+// Entry prefix is formatted lazily on the writer thread.
+struct LogRecord {
+	LogDataType type = LogDataDebug;
+	int32 dc = 0;
+	int threadId = 0;
+	int index = 0;
+	qint64 when = 0;
+	QString text;
+};
+
 QMutex *_logsMutex(LogDataType type, bool clear = false) {
 	static QMutex *LogsMutexes = 0;
 	if (clear) {
@@ -59,13 +77,62 @@ QString _logsFilePath(LogDataType type, const QString &postfix = QString()) {
 }
 
 int32 LogsStartIndexChosen = -1;
-QString _logsEntryStart() {
+LogRecord _logsRecord(LogDataType type, const QString &text) {
 	static thread_local auto threadId = ThreadCounter++;
-	static auto index = 0;
 
-	const auto tm = QDateTime::currentDateTime();
+	return {
+		.type = type,
+		.threadId = threadId,
+		.index = ++EntryCounter,
+		.when = QDateTime::currentMSecsSinceEpoch(),
+		.text = text,
+	};
+}
+
+QString _logsExpandedDc(int32 dc) {
+	const auto bare = MTP::isTemporaryDcId(dc)
+		? MTP::getRealIdFromTemporaryDcId(dc)
+		: MTP::BareDcId(dc);
+	const auto base = (MTP::isTemporaryDcId(dc) ? "temporary_" : "")
+		+ QString::number(bare);
+	const auto shift = MTP::GetDcIdShift(dc);
+	if (shift == 0) {
+		return base + "_main";
+	} else if (shift == MTP::kExportDcShift) {
+		return base + "_export";
+	} else if (shift == MTP::kExportMediaDcShift) {
+		return base + "_export_download";
+	} else if (shift == MTP::kConfigDcShift) {
+		return base + "_config_enumeration";
+	} else if (shift == MTP::kLogoutDcShift) {
+		return base + "_logout_guest";
+	} else if (shift == MTP::kUpdaterDcShift) {
+		return base + "_download_update";
+	} else if (shift == MTP::kGroupCallStreamDcShift) {
+		return base + "_stream";
+	} else if (MTP::isDownloadDcId(dc)) {
+		const auto index = shift - MTP::kBaseDownloadDcShift;
+		return base + "_download" + QString::number(index);
+	} else if (MTP::isUploadDcId(dc)) {
+		const auto index = shift - MTP::kBaseUploadDcShift;
+		return base + "_upload" + QString::number(index);
+	} else if (shift >= MTP::kDestroyKeyStartDcShift) {
+		const auto index = shift - MTP::kDestroyKeyStartDcShift;
+		return base + "_key_destroyer" + QString::number(index);
+	}
+	return base + "_unknown" + QString::number(shift);
+}
 
-	return QString("[%1 %2-%3]").arg(tm.toString("hh:mm:ss.zzz"), QString("%1").arg(threadId, 2, 10, QChar('0'))).arg(++index, 7, 10, QChar('0'));
+QString _logsFormat(const LogRecord &record) {
+	const auto tm = QDateTime::fromMSecsSinceEpoch(record.when);
+	const auto start = QString("[%1 %2-%3]").arg(tm.toString("hh:mm:ss.zzz"), QString("%1").arg(record.threadId, 2, 10, QChar('0'))).arg(record.index, 7, 10, QChar('0'));
+	if (record.type == LogDataMtp) {
+		return start
+			+ u" (dc:%1) "_q.arg(_logsExpandedDc(record.dc))
+			+ record.text
+			+ '\n';
+	}
+	return QString("%1 %2\n").arg(start, record.text);
 }
 
 class LogsDataFields {
@@ -77,6 +144,18 @@ public:
 		}
 	}
 
+	~LogsDataFields() {
+		{
+			QMutexLocker lock(&_pendingMutex);
+			_stopping = true;
+			_pendingCondition.wakeAll();
+		}
+		if (_writer.joinable()) {
+			_writer.join();
+		}
+		writePending();
+	}
+
 	bool openMain() {
 		return reopen(LogDataMain, 0, u"start"_q);
 	}
@@ -123,7 +202,116 @@ public:
 		file->flush();
 	}
 
+	// May be called from any thread, never blocks on the file system.
+	void enqueue(LogRecord &&record) {
+		QMutexLocker lock(&_pendingMutex);
+		if (_pending.size() >= std::size_t(kMaxPendingRecords)) {
+			++_dropped;
+			return;
+		}
+		_pending.push_back(std::move(record));
+		if (!_writer.joinable() && !_stopping) {
+			_writer = std::thread([this] { writerLoop(); });
+		}
+		if (_pending.size() == 1) {
+			_pendingCondition.wakeOne();
+		}
+	}
+
+	// When crashing the writer or the crashed thread may hold the locks,
+	// so the pending entries are written only if nobody does that already.
+	void writePending(bool crashing = false) {
+		if (crashing) {
+			if (!_writingMutex.tryLock()) {
+				return;
+			}
+		} else {
+			_writingMutex.lock();
+		}
+		const auto unlock = gsl::finally([&] {
+			_writingMutex.unlock();
+		});
+
+		auto records = std::vector<LogRecord>();
+		if (crashing) {
+			if (!_pendingMutex.tryLock()) {
+				return;
+			}
+			std::swap(records, _pending);
+			_pendingMutex.unlock();
+		} else {
+			QMutexLocker lock(&_pendingMutex);
+			std::swap(records, _pending);
+		}
+		if (records.empty()) {
+			return;
+		}
+		QByteArray batches[LogDataCount];
+		for (const auto &record : records) {
+			batches[record.type] += _logsFormat(record).toUtf8();
+		}
+		if (const auto dropped = _dropped.exchange(0)) {
+			batches[LogDataDebug] += QString(
+				"%1 log records dropped, writer is too slow.\n"
+			).arg(dropped).toUtf8();
+		}
+		for (auto type = 0; type != LogDataCount; ++type) {
+			if (batches[type].isEmpty()) {
+				continue;
+			}
+			const auto logType = LogDataType(type);
+			const auto mutex = _logsMutex(logType);
+			if (crashing) {
+				if (!mutex->tryLock()) {
+					continue;
+				}
+			} else {
+				mutex->lock();
+			}
+			const auto unlockType = gsl::finally([&] {
+				mutex->unlock();
+			});
+			WritingEntryScope scope;
+
+			if (logType != LogDataMain) {
+				reopenDebug();
+			}
+			const auto file = files[logType].get();
+			if (file && file->isOpen()) {
+				file->write(batches[type]);
+				file->flush();
+			}
+		}
+	}
+
 private:
+	void writerLoop() {
+		while (true) {
+			{
+				QMutexLocker lock(&_pendingMutex);
+				if (_stopping) {
+					return;
+				} else if (_pending.empty()) {
+					_pendingCondition.wait(&_pendingMutex);
+					continue;
+				}
+			}
+			// Let the callers fill a batch before touching the files.
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(kWriteBatchDelay));
+			writePending();
+		}
+	}
+
+	QMutex _pendingMutex;
+	QWaitCondition _pendingCondition;
+	std::vector<LogRecord> _pending;
+	bool _stopping = false;
+	std::thread _writer;
+
+	QMutex _writingMutex;
+	std::atomic<int64> _dropped = 0;
+
 	std::unique_ptr<QFile> files[LogDataCount];
 
 	int32 part = -1;
@@ -283,6 +471,16 @@ void _logsWrite(LogDataType type, const QString &msg) {
 	}
 }
 
+void _logsWrite(LogRecord &&record) {
+	if (LogsData && LogsStartIndexChosen < 0) {
+		if (Logs::DebugEnabled()) {
+			LogsData->enqueue(std::move(record));
+		}
+	} else {
+		_logsWrite(record.type, _logsFormat(record));
+	}
+}
+
 namespace Logs {
 namespace {
 
@@ -494,6 +692,7 @@ void multipleInstances() {
 void closeMain() {
 	LOG(("Explicitly closing main log and finishing crash handlers."));
 	if (LogsData) {
+		LogsData->writePending();
 		LogsData->closeMain();
 	}
 }
@@ -517,8 +716,7 @@ void writeMain(const QString &v) {
 }
 
 void writeDebug(const QString &v) {
-	const auto msg = QString("%1 %2\n").arg(_logsEntryStart(), v);
-	_logsWrite(LogDataDebug, msg);
+	_logsWrite(_logsRecord(LogDataDebug, v));
 
 #ifdef Q_OS_WIN
 	//OutputDebugString(reinterpret_cast<const wchar_t *>(msg.utf16()));
@@ -530,44 +728,21 @@ void writeDebug(const QString &v) {
 }
 
 void writeMtp(int32 dc, const QString &v) {
-	const auto expanded = [&] {
-		const auto bare = MTP::isTemporaryDcId(dc)
-			? MTP::getRealIdFromTemporaryDcId(dc)
-			: MTP::BareDcId(dc);
-		const auto base = (MTP::isTemporaryDcId(dc) ? "temporary_" : "")
-			+ QString::number(bare);
-		const auto shift = MTP::GetDcIdShift(dc);
-		if (shift == 0) {
-			return base + "_main";
-		} else if (shift == MTP::kExportDcShift) {
-			return base + "_export";
-		} else if (shift == MTP::kExportMediaDcShift) {
-			return base + "_export_download";
-		} else if (shift == MTP::kConfigDcShift) {
-			return base + "_config_enumeration";
-		} else if (shift == MTP::kLogoutDcShift) {
-			return base + "_logout_guest";
-		} else if (shift == MTP::kUpdaterDcShift) {
-			return base + "_download_update";
-		} else if (shift == MTP::kGroupCallStreamDcShift) {
-			return base + "_stream";
-		} else if (MTP::isDownloadDcId(dc)) {
-			const auto index = shift - MTP::kBaseDownloadDcShift;
-			return base + "_download" + QString::number(index);
-		} else if (MTP::isUploadDcId(dc)) {
-			const auto index = shift - MTP::kBaseUploadDcShift;
-			return base + "_upload" + QString::number(index);
-		} else if (shift >= MTP::kDestroyKeyStartDcShift) {
-			const auto index = shift - MTP::kDestroyKeyStartDcShift;
-			return base + "_key_destroyer" + QString::number(index);
-		}
-		return base + "_unknown" + QString::number(shift);
-	}();
-	const auto msg = _logsEntryStart()
-		+ u" (dc:%1) "_q.arg(expanded)
-		+ v
-		+ '\n';
-	_logsWrite(LogDataMtp, msg);
+	auto record = _logsRecord(LogDataMtp, v);
+	record.dc = dc;
+	_logsWrite(std::move(record));
+}
+
+void flush() {
+	if (LogsData) {
+		LogsData->writePending();
+	}
+}
+
+void flushCrashed() {
+	if (LogsData) {
+		LogsData->writePending(true);
+	}
 }
 
 QString full() {
@@ -32,6 +32,12 @@ void writeMtp(int32 dc, const QString &v);
 
 QString full();
 
+// Debug and MTP entries are written asynchronously in batches, these
+// write the pending ones right away, before an assertion or a crash
+// takes the process down. flushCrashed() never waits for the locks.
+void flush();
+void flushCrashed();
+
 inline const char *b(bool v) {
 	return v ? "[TRUE]" : "[FALSE]";
 }
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/serialize_peer.h"
 #include "storage/localstorage.h"
 #include "data/data_session.h"
+#include "data/data_local_search_index.h"
 #include "data/data_user.h"
 #include "data/data_changes.h"
 #include "window/window_controller.h"
@@ -232,6 +233,7 @@ void Account::destroySessionAfterAction() {
     _session->data().cache().close();
     _session->data().cacheBigFile().close();
     _session->unlockTerms();
+    _session->data().localSearchIndex().discardChanged();
     _session->data().clear();
 
 	_session = nullptr;
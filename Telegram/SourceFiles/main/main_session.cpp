@@ -47,6 +47,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "settings/settings_privacy_security_helpers.h"
 #include "settings/settings_recent_searches.h"
 #include "data/data_session.h"
+#include "data/data_local_search_index.h"
 #include "data/data_changes.h"
 #include "data/data_user.h"
 #include "data/data_download_manager.h"
@@ -304,6 +305,7 @@ QByteArray Session::validTmpPassword() const {
 // Can be called only right before ~Session.
 void Session::finishLogout() {
 	unlockTerms();
+	data().localSearchIndex().discardChanged();
 	data().clear();
 	data().clearLocalStorage();
 }
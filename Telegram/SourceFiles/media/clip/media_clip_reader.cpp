@@ -35,7 +35,13 @@ namespace {
 
 constexpr auto kClipThreadsCount = 8;
 constexpr auto kAverageGifSize = 320 * 240;
+constexpr auto kAverageGifCost = int64(25'000); // mcs of decoding per second
 constexpr auto kWaitBeforeGifPause = crl::time(200);
+constexpr auto kFramePoolSize = 16;
+constexpr auto kFramePoolBytes = int64(16 * 1024 * 1024);
+constexpr auto kFramePoolIdleTimeout = crl::time(1000);
+constexpr auto kMinFrameInterval = crl::time(10);
+constexpr auto kMaxFrameInterval = crl::time(1000);
 
 QImage PrepareFrame(
 		const FrameRequest &request,
@@ -107,6 +113,64 @@ QImage PrepareFrame(
 	return cache;
 }
 
+// Decoded frames are shared with Reader and with painting on the main
+// thread, so they can't be decoded into right away. They wait here until
+// all other references are dropped and then are reused by any reader
+// of the same thread instead of allocating a new frame storage.
+class FramePool final {
+public:
+	void release(QImage &&image) {
+		if (image.isNull()) {
+			return;
+		}
+		_bytes += image.sizeInBytes();
+		_images.push_back(std::move(image));
+		while (_images.size() > kFramePoolSize || _bytes > kFramePoolBytes) {
+			popFront();
+		}
+	}
+	[[nodiscard]] QImage take(QSize size, QImage::Format format) {
+		for (auto i = begin(_images); i != end(_images); ++i) {
+			if (i->isDetached()
+				&& i->size() == size
+				&& i->format() == format) {
+				auto result = std::move(*i);
+				_images.erase(i);
+				_bytes -= result.sizeInBytes();
+				return result;
+			}
+		}
+		return QImage();
+	}
+
+	// Frames nobody else references are kept only for reuse,
+	// drop them when the readers that could reuse them are gone.
+	void trim() {
+		for (auto i = begin(_images); i != end(_images);) {
+			if (i->isDetached()) {
+				_bytes -= i->sizeInBytes();
+				i = _images.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
+	void clear() {
+		_images.clear();
+		_bytes = 0;
+	}
+
+private:
+	void popFront() {
+		_bytes -= _images.front().sizeInBytes();
+		_images.pop_front();
+	}
+
+	std::deque<QImage> _images;
+	int64 _bytes = 0;
+
+};
+
 } // namespace
 
 enum class ProcessResult {
@@ -124,8 +188,12 @@ public:
 	explicit Manager(not_null<QThread*> thread);
 	~Manager();
 
-	int loadLevel() const {
-		return _loadLevel;
+	// Measured decoding time per second of all the readers plus
+	// an estimate by frame size for the readers not measured yet.
+	int64 loadLevel() const {
+		return _decodeCost.load(std::memory_order_relaxed)
+			+ int64(_loadLevel.loadRelaxed()) * kAverageGifCost
+				/ kAverageGifSize;
 	}
 	void append(Reader *reader, const Core::FileLocation &location, const QByteArray &data);
 	void start(Reader *reader);
@@ -139,7 +207,15 @@ private:
 	void callback(Reader *reader, Notification notification);
 	void clear();
 
+	[[nodiscard]] ProcessResult measuredFinishProcess(
+		ReaderPrivate *reader,
+		crl::time ms);
+	void updateCost(ReaderPrivate *reader, int64 cost);
+	void removeCost(ReaderPrivate *reader);
+
 	QAtomicInt _loadLevel;
+	std::atomic<int64> _decodeCost = 0;
+	FramePool _framePool;
 	using ReaderPointers = QMap<Reader*, QAtomicInt>;
 	ReaderPointers _readerPointers;
 	mutable QMutex _readerPointersMutex;
@@ -208,7 +284,7 @@ void Reader::init(const Core::FileLocation &location, const QByteArray &data) {
 		Workers.push_back(std::make_unique<Worker>());
 	} else {
 		_threadIndex = base::RandomIndex(Workers.size());
-		auto loadLevel = 0x7FFFFFFF;
+		auto loadLevel = std::numeric_limits<int64>::max();
 		for (int i = 0, l = int(Workers.size()); i < l; ++i) {
 			const auto level = Workers[i]->manager.loadLevel();
 			if (level < loadLevel) {
@@ -465,8 +541,13 @@ Reader::~Reader() {
 
 class ReaderPrivate {
 public:
-	ReaderPrivate(Reader *reader, const Core::FileLocation &location, const QByteArray &data)
+	ReaderPrivate(
+		Reader *reader,
+		not_null<FramePool*> framePool,
+		const Core::FileLocation &location,
+		const QByteArray &data)
 	: _interface(reader)
+	, _framePool(framePool)
 	, _data(data) {
 		if (_data.isEmpty()) {
 			_location = std::make_unique<Core::FileLocation>(location);
@@ -570,6 +651,7 @@ public:
 	bool renderFrame() {
 		Expects(_request.valid());
 
+		reuseOriginal();
 		if (!_implementation->renderFrame(frame()->original, frame()->alpha, frame()->index, _request.frame)) {
 			return false;
 		}
@@ -622,6 +704,22 @@ public:
 		_videoPausedAtMs = 0;
 	}
 
+	// The frame storage is overwritten completely by the decoder, so if it
+	// is still shared we take a free one from the pool instead of letting
+	// the decoder allocate a new one.
+	void reuseOriginal() {
+		frame()->prepared = QImage();
+
+		auto &original = frame()->original;
+		if (original.isNull() || original.isDetached()) {
+			return;
+		}
+		const auto size = original.size();
+		const auto format = original.format();
+		_framePool->release(base::take(original));
+		original = _framePool->take(size, format);
+	}
+
 	ProcessResult error() {
 		stop();
 		_state = State::Error;
@@ -646,6 +744,7 @@ public:
 
 private:
 	Reader *_interface;
+	const not_null<FramePool*> _framePool;
 	State _state = State::Reading;
 	crl::time _seekPositionMs = 0;
 
@@ -687,6 +786,10 @@ private:
 	bool _started = false;
 	crl::time _videoPausedAtMs = 0;
 
+	crl::profile_time _frameCost = 0;
+	int64 _cost = 0;
+	bool _costMeasured = false;
+
 	friend class Manager;
 
 };
@@ -702,7 +805,11 @@ Manager::Manager(not_null<QThread*> thread) {
 }
 
 void Manager::append(Reader *reader, const Core::FileLocation &location, const QByteArray &data) {
-	reader->_private = new ReaderPrivate(reader, location, data);
+	reader->_private = new ReaderPrivate(
+		reader,
+		&_framePool,
+		location,
+		data);
 	_loadLevel.fetchAndAddRelaxed(kAverageGifSize);
 	update(reader);
 }
@@ -824,10 +931,47 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 	return true;
 }
 
+ProcessResult Manager::measuredFinishProcess(
+		ReaderPrivate *reader,
+		crl::time ms) {
+	const auto was = reader->_nextFrameWhen;
+	const auto started = crl::profile();
+	const auto result = reader->finishProcess(ms);
+	if (result != ProcessResult::CopyFrame) {
+		return result;
+	}
+	const auto spent = crl::profile() - started;
+	reader->_frameCost = reader->_frameCost
+		? ((reader->_frameCost * 7 + spent) / 8)
+		: spent;
+	const auto interval = std::clamp(
+		reader->_nextFrameWhen - was,
+		kMinFrameInterval,
+		kMaxFrameInterval);
+	updateCost(reader, reader->_frameCost * 1000 / interval);
+	return result;
+}
+
+void Manager::updateCost(ReaderPrivate *reader, int64 cost) {
+	if (!reader->_costMeasured) {
+		reader->_costMeasured = true;
+		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+	}
+	_decodeCost += cost - std::exchange(reader->_cost, cost);
+}
+
+void Manager::removeCost(ReaderPrivate *reader) {
+	if (!reader->_costMeasured) {
+		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+	}
+	_decodeCost -= reader->_cost;
+}
+
 Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, crl::time ms) {
 	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+		removeCost(reader);
 		delete reader;
+		_framePool.trim();
 		return ResultHandleRemove;
 	}
 
@@ -851,7 +995,7 @@ Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessR
 				reader->_frame = index;
 			}
 		}
-		return handleResult(reader, reader->finishProcess(ms), ms);
+		return handleResult(reader, measuredFinishProcess(reader, ms), ms);
 	}
 
 	return ResultHandleContinue;
@@ -906,6 +1050,10 @@ void Manager::process() {
 				return;
 			}
 			ms = crl::now();
+			if (reader->_videoPausedAtMs || reader->_autoPausedGif) {
+				// Paused readers don't decode, don't count them as load.
+				updateCost(reader, 0);
+			}
 			if (reader->_videoPausedAtMs) {
 				i.value() = ms + 86400 * 1000ULL;
 			} else if (reader->_nextFrameWhen && reader->_started) {
@@ -917,8 +1065,9 @@ void Manager::process() {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
-				_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+				removeCost(reader);
 				delete reader;
+				_framePool.trim();
 				i = _readers.erase(i);
 				continue;
 			}
@@ -930,6 +1079,11 @@ void Manager::process() {
 	}
 
 	ms = crl::now();
+	if (_readers.isEmpty()) {
+		_framePool.clear();
+	} else if (!_needReProcess && minms - ms > kFramePoolIdleTimeout) {
+		_framePool.trim();
+	}
 	if (_needReProcess || minms <= ms) {
 		_needReProcess = false;
 		_timer.start(1);
@@ -955,9 +1109,11 @@ void Manager::clear() {
 	}
 
 	for (Readers::iterator i = _readers.begin(), e = _readers.end(); i != e; ++i) {
+		removeCost(i.key());
 		delete i.key();
 	}
 	_readers.clear();
+	_framePool.clear();
 }
 
 Manager::~Manager() {
@@ -21,10 +21,27 @@ constexpr auto kInSlice = uint32(kPartsInSlice * kPartSize);
 constexpr auto kMaxPartsInHeader = 64;
 constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
-constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
-constexpr auto kPreloadPartsAhead = 8;
+// Slices kept in memory are limited by the budget, but never less than two,
+// because a single read may span two adjacent slices.
+constexpr auto kSlicesMemoryBudget = 32 * 1024 * 1024;
+constexpr auto kSlicesInMemoryMin = 2;
+constexpr auto kSlicesInMemoryMax = 8;
+constexpr auto kSlicesInMemory = std::clamp(
+	kSlicesMemoryBudget / int(kInSlice),
+	kSlicesInMemoryMin,
+	kSlicesInMemoryMax);
+
+// From 1 MB to 4 MB of parts are requested from cloud ahead of reading
+// demand, depending on how fast the demuxer consumes the file.
+constexpr auto kPreloadPartsAheadMin = 8;
+constexpr auto kPreloadPartsAheadMax = 32;
+constexpr auto kPreloadDuration = crl::time(4000);
+constexpr auto kReadRateWindow = crl::time(1000);
+
+// Reads further than that from the previous one are treated as a seek.
+constexpr auto kSeekDistance = uint32(16 * kPartSize);
+
 constexpr auto kDownloaderRequestsLimit = 4;
 
 using PartsMap = base::flat_map<uint32, QByteArray>;
@@ -270,14 +287,14 @@ void Reader::Slice::addPart(uint32 offset, QByteArray bytes) {
 
 auto Reader::Slice::prepareFill(
 		uint32 from,
-		uint32 till) -> PrepareFillResult {
+		uint32 till,
+		int preloadParts) -> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -548,7 +565,10 @@ void Reader::Slices::processPart(
 	checkSliceFullLoaded(index + 1);
 }
 
-auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
+auto Reader::Slices::fill(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	Expects(!buffer.empty());
 	Expects(offset < _size);
 	Expects(offset + buffer.size() <= _size);
@@ -562,7 +582,7 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 		Assert(waitingForHeaderCache());
 		return {};
 	} else if (isFullInHeader()) {
-		return fillFromHeader(offset, buffer);
+		return fillFromHeader(offset, buffer, preloadParts);
 	}
 
 	auto result = FillResult();
@@ -616,9 +636,15 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	const auto secondTill = (till > (fromSlice + 1) * kInSlice)
 		? (till - (fromSlice + 1) * kInSlice)
 		: 0;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -650,13 +676,15 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	return result;
 }
 
-auto Reader::Slices::fillFromHeader(uint32 offset, bytes::span buffer)
--> FillResult {
+auto Reader::Slices::fillFromHeader(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = uint32(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -870,6 +898,7 @@ Reader::Reader(
 		}
 	}, _lifetime);
 
+	_readAhead.preloadParts = kPreloadPartsAheadMin;
 	if (_cacheHelper) {
 		readFromCache(0);
 	}
@@ -1262,6 +1291,8 @@ Reader::FillState Reader::fill(
 		return FillState::Failed;
 	}
 
+	updateReadAhead(uint32(offset), uint32(offset + buffer.size()));
+
 	auto lastResult = FillState();
 	do {
 		lastResult = fillFromSlices(uint32(offset), buffer);
@@ -1277,7 +1308,7 @@ Reader::FillState Reader::fill(
 Reader::FillState Reader::fillFromSlices(uint32 offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
-	auto result = _slices.fill(offset, buffer);
+	auto result = _slices.fill(offset, buffer, _readAhead.preloadParts);
 	if (result.state != FillState::Success && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return FillState::Failed;
@@ -1307,6 +1338,48 @@ Reader::FillState Reader::fillFromSlices(uint32 offset, bytes::span buffer) {
 	return result.state;
 }
 
+void Reader::updateReadAhead(uint32 from, uint32 till) {
+	auto &state = _readAhead;
+	if (from == state.lastFrom && till == state.lastTill) {
+		// The demuxer repeats the same read while waiting for the data.
+		return;
+	}
+	const auto now = crl::now();
+	if (!state.windowStart) {
+		state.windowStart = now;
+	}
+	const auto distance = (from > state.lastTill)
+		? (from - state.lastTill)
+		: (state.lastTill - from);
+	state.lastFrom = from;
+	state.lastTill = till;
+	if (distance > kSeekDistance) {
+		// Don't preload far ahead of a seek target until we know
+		// that the playback really continues from there.
+		state.windowStart = now;
+		state.windowBytes = 0;
+		state.preloadParts = kPreloadPartsAheadMin;
+		return;
+	}
+	state.windowBytes += (till - from);
+	const auto elapsed = now - state.windowStart;
+	if (elapsed < kReadRateWindow) {
+		return;
+	}
+	const auto rate = state.windowBytes * 1000 / elapsed;
+	state.bytesPerSecond = state.bytesPerSecond
+		? ((state.bytesPerSecond * 3 + rate) / 4)
+		: rate;
+	state.windowStart = now;
+	state.windowBytes = 0;
+
+	const auto ahead = state.bytesPerSecond * kPreloadDuration / 1000;
+	state.preloadParts = int(std::clamp(
+		(ahead + kPartSize - 1) / kPartSize,
+		int64(kPreloadPartsAheadMin),
+		int64(kPreloadPartsAheadMax)));
+}
+
 void Reader::cancelLoadInRange(uint32 from, uint32 till) {
 	Expects(from < till);
 
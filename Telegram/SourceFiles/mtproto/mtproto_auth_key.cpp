@@ -11,7 +11,288 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <QtCore/QDataStream>
 
+#include <openssl/evp.h>
+
 namespace MTP {
+namespace {
+
+constexpr auto kBlockSize = 16;
+constexpr auto kChunkBlocks = 256;
+
+using IgeKernel = void(*)(
+	const uchar *src,
+	uchar *dst,
+	uint32 len,
+	const uchar *key,
+	const uchar *iv);
+
+struct IgeKernels {
+	IgeKernel encrypt = nullptr;
+	IgeKernel decrypt = nullptr;
+	const char *name = nullptr;
+};
+
+struct Block {
+	uint64 a = 0;
+	uint64 b = 0;
+
+	[[nodiscard]] static Block Load(const uchar *from) {
+		auto result = Block();
+		memcpy(&result, from, kBlockSize);
+		return result;
+	}
+	void store(uchar *to) const {
+		memcpy(to, this, kBlockSize);
+	}
+	Block operator^(const Block &other) const {
+		return { a ^ other.a, b ^ other.b };
+	}
+};
+static_assert(sizeof(Block) == kBlockSize);
+
+void GenericIgeEncrypt(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const uchar *key,
+		const uchar *iv) {
+	uchar aes_iv[32];
+	memcpy(aes_iv, iv, 32);
+
+	AES_KEY aes;
+	AES_set_encrypt_key(key, 256, &aes);
+	AES_ige_encrypt(src, dst, len, &aes, aes_iv, AES_ENCRYPT);
+}
+
+void GenericIgeDecrypt(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const uchar *key,
+		const uchar *iv) {
+	uchar aes_iv[32];
+	memcpy(aes_iv, iv, 32);
+
+	AES_KEY aes;
+	AES_set_decrypt_key(key, 256, &aes);
+	AES_ige_encrypt(src, dst, len, &aes, aes_iv, AES_DECRYPT);
+}
+
+// EVP picks AES-NI / ARMv8 crypto extensions at runtime when available.
+// May return nullptr if the context could not be allocated.
+[[nodiscard]] EVP_CIPHER_CTX *CipherContext() {
+	struct Deleter {
+		void operator()(EVP_CIPHER_CTX *context) const {
+			EVP_CIPHER_CTX_free(context);
+		}
+	};
+	thread_local const auto result = std::unique_ptr<
+		EVP_CIPHER_CTX,
+		Deleter>(EVP_CIPHER_CTX_new());
+	return result.get();
+}
+
+// If EVP fails in the middle we continue from the first not yet
+// processed block with the generic kernel, the chain state is
+// just the last cipher and the last plain block, like the iv.
+void LogEvpFailure() {
+	static auto logged = std::atomic<bool>(false);
+	if (!logged.exchange(true)) {
+		LOG(("MTP Error: EVP AES-IGE call failed, using generic."));
+	}
+}
+
+void GenericIgeContinue(
+		bool encrypt,
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const uchar *key,
+		Block lastCipher,
+		Block lastPlain) {
+	LogEvpFailure();
+
+	uchar iv[32];
+	lastCipher.store(iv);
+	lastPlain.store(iv + kBlockSize);
+	if (encrypt) {
+		GenericIgeEncrypt(src, dst, len, key, iv);
+	} else {
+		GenericIgeDecrypt(src, dst, len, key, iv);
+	}
+}
+
+// With c[0] = iv1, p[0] = iv2 IGE encryption is
+//   c[i] = E(p[i] ^ c[i-1]) ^ p[i-1].
+// Substituting y[i] = c[i] ^ p[i-1] (and p[-1] = 0) gives
+//   y[i] = E((p[i] ^ p[i-2]) ^ y[i-1]), y[0] = iv1,
+// which is plain CBC encryption of p[i] ^ p[i-2] with iv iv1,
+// so the whole chain runs inside one pipelined CBC kernel.
+void EvpIgeEncrypt(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const uchar *key,
+		const uchar *iv) {
+	const auto context = CipherContext();
+	if (!context
+		|| EVP_EncryptInit_ex(
+			context,
+			EVP_aes_256_cbc(),
+			nullptr,
+			key,
+			iv) != 1
+		|| EVP_CIPHER_CTX_set_padding(context, 0) != 1) {
+		LogEvpFailure();
+		GenericIgeEncrypt(src, dst, len, key, iv);
+		return;
+	}
+
+	uchar buffer[kChunkBlocks * kBlockSize];
+	auto lastCipher = Block::Load(iv); // c[i-1]
+	auto prev = Block::Load(iv + kBlockSize); // p[i-1]
+	auto prevPrev = Block(); // p[i-2]
+	for (auto offset = uint32(0); offset + kBlockSize <= len;) {
+		const auto blocks = std::min(
+			uint32(kChunkBlocks),
+			(len - offset) / kBlockSize);
+		const auto from = src + offset;
+		auto p1 = prev;
+		auto p2 = prevPrev;
+		for (auto i = uint32(0); i != blocks; ++i) {
+			const auto p = Block::Load(from + i * kBlockSize);
+			(p ^ p2).store(buffer + i * kBlockSize);
+			p2 = p1;
+			p1 = p;
+		}
+		auto written = 0;
+		if (EVP_EncryptUpdate(
+				context,
+				buffer,
+				&written,
+				buffer,
+				blocks * kBlockSize) != 1
+			|| written != int(blocks * kBlockSize)) {
+			GenericIgeContinue(
+				true,
+				from,
+				dst + offset,
+				len - offset,
+				key,
+				lastCipher,
+				prev);
+			return;
+		}
+
+		// Read p[i] before writing c[i], so in-place calls work.
+		const auto to = dst + offset;
+		for (auto i = uint32(0); i != blocks; ++i) {
+			const auto p = Block::Load(from + i * kBlockSize);
+			lastCipher = Block::Load(buffer + i * kBlockSize) ^ prev;
+			lastCipher.store(to + i * kBlockSize);
+			prevPrev = prev;
+			prev = p;
+		}
+		offset += blocks * kBlockSize;
+	}
+}
+
+// p[i] = D(c[i] ^ p[i-1]) ^ c[i-1] is serial in both directions,
+// so blocks go through the hardware kernel one by one.
+void EvpIgeDecrypt(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const uchar *key,
+		const uchar *iv) {
+	const auto context = CipherContext();
+	if (!context
+		|| EVP_DecryptInit_ex(
+			context,
+			EVP_aes_256_ecb(),
+			nullptr,
+			key,
+			nullptr) != 1
+		|| EVP_CIPHER_CTX_set_padding(context, 0) != 1) {
+		LogEvpFailure();
+		GenericIgeDecrypt(src, dst, len, key, iv);
+		return;
+	}
+
+	auto prevCipher = Block::Load(iv);
+	auto prevPlain = Block::Load(iv + kBlockSize);
+	uchar buffer[kBlockSize];
+	for (auto offset = uint32(0); offset + kBlockSize <= len; offset += kBlockSize) {
+		const auto c = Block::Load(src + offset);
+		(c ^ prevPlain).store(buffer);
+		auto written = 0;
+		if (EVP_DecryptUpdate(
+				context,
+				buffer,
+				&written,
+				buffer,
+				kBlockSize) != 1
+			|| written != kBlockSize) {
+			GenericIgeContinue(
+				false,
+				src + offset,
+				dst + offset,
+				len - offset,
+				key,
+				prevCipher,
+				prevPlain);
+			return;
+		}
+		prevPlain = Block::Load(buffer) ^ prevCipher;
+		prevPlain.store(dst + offset);
+		prevCipher = c;
+	}
+}
+
+[[nodiscard]] bool KernelsMatch(const IgeKernels &tested) {
+	constexpr auto kTestSize = 37 * kBlockSize;
+	uchar key[32], iv[32];
+	uchar plain[kTestSize], expected[kTestSize], result[kTestSize];
+	for (auto i = 0; i != kTestSize; ++i) {
+		plain[i] = uchar(i * 131 + 7);
+	}
+	for (auto i = 0; i != 32; ++i) {
+		key[i] = uchar(i * 17 + 3);
+		iv[i] = uchar(i * 29 + 11);
+	}
+	GenericIgeEncrypt(plain, expected, kTestSize, key, iv);
+	tested.encrypt(plain, result, kTestSize, key, iv);
+	if (memcmp(expected, result, kTestSize)) {
+		return false;
+	}
+	tested.decrypt(expected, expected, kTestSize, key, iv);
+	return !memcmp(expected, plain, kTestSize);
+}
+
+[[nodiscard]] IgeKernels ChooseKernels() {
+	const auto generic = IgeKernels{
+		.encrypt = GenericIgeEncrypt,
+		.decrypt = GenericIgeDecrypt,
+		.name = "generic",
+	};
+	const auto evp = IgeKernels{
+		.encrypt = EvpIgeEncrypt,
+		.decrypt = EvpIgeDecrypt,
+		.name = "evp",
+	};
+	if (!KernelsMatch(evp)) {
+		LOG(("MTP Error: EVP AES-IGE kernel mismatch, using generic."));
+		return generic;
+	}
+	return evp;
+}
+
+[[nodiscard]] const IgeKernels &Kernels() {
+	static const auto result = ChooseKernels();
+	return result;
+}
+
+} // namespace
 
 AuthKey::AuthKey(Type type, DcId dcId, const Data &data)
 : _type(type)
@@ -149,23 +430,21 @@ void AuthKey::countKeyId() {
 }
 
 void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
-
-	AES_KEY aes;
-	AES_set_encrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_ENCRYPT);
+	Kernels().encrypt(
+		static_cast<const uchar*>(src),
+		static_cast<uchar*>(dst),
+		len,
+		static_cast<const uchar*>(key),
+		static_cast<const uchar*>(iv));
 }
 
 void aesIgeDecryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
-
-	AES_KEY aes;
-	AES_set_decrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_DECRYPT);
+	Kernels().decrypt(
+		static_cast<const uchar*>(src),
+		static_cast<uchar*>(dst),
+		len,
+		static_cast<const uchar*>(key),
+		static_cast<const uchar*>(iv));
 }
 
 void aesCtrEncrypt(bytes::span data, const void *key, CTRState *state) {
@@ -351,11 +351,11 @@ void Session::resetDone() {
 void Session::cancel(mtpRequestId requestId, mtpMsgId msgId) {
 	if (requestId) {
 		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().remove(requestId);
+		_data->toSendMap().erase(requestId);
 	}
 	if (msgId) {
 		QWriteLocker locker(_data->haveSentMutex());
-		_data->haveSentMap().remove(msgId);
+		_data->haveSentMap().erase(msgId);
 	}
 }
 
@@ -388,7 +388,7 @@ int32 Session::requestState(mtpRequestId requestId) const {
 		return MTP::RequestSent;
 	}
 
-	QWriteLocker locker(_data->toSendMutex());
+	QReadLocker locker(_data->toSendMutex());
 	return _data->toSendMap().contains(requestId)
 		? MTP::RequestSending
 		: MTP::RequestSent;
@@ -14,6 +14,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <QtCore/QTimer>
 
+#include <map>
+
 namespace MTP {
 
 class Instance;
@@ -52,6 +54,12 @@ struct SessionOptions {
 
 };
 
+// Both maps are ordered node-based maps: with thousands of requests in
+// flight responses erase entries from the middle, which in a flat_map
+// moves the whole tail while the lock is held.
+using ToSendMap = std::map<mtpRequestId, SerializedRequest>;
+using HaveSentMap = std::map<mtpMsgId, SerializedRequest>;
+
 class Session;
 class SessionData final {
 public:
@@ -78,10 +86,10 @@ public:
 		return &_haveReceivedLock;
 	}
 
-	base::flat_map<mtpRequestId, SerializedRequest> &toSendMap() {
+	ToSendMap &toSendMap() {
 		return _toSend;
 	}
-	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
+	HaveSentMap &haveSentMap() {
 		return _haveSent;
 	}
 	std::vector<Response> &haveReceivedMessages() {
@@ -119,10 +127,10 @@ private:
 	SessionOptions _options;
 	mutable QReadWriteLock _optionsLock;
 
-	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
+	ToSendMap _toSend; // map of request_id -> request, that is waiting to be sent
 	QReadWriteLock _toSendLock;
 
-	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
+	HaveSentMap _haveSent; // map of msg_id -> request, that was sent
 	QReadWriteLock _haveSentLock;
 
 	std::vector<Response> _receivedMessages; // list of responses / updates that should be processed in the main thread
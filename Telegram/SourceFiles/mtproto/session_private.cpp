@@ -102,7 +102,7 @@ using namespace details;
 void WrapInvokeAfter(
 		SerializedRequest &to,
 		const SerializedRequest &from,
-		const base::flat_map<mtpMsgId, SerializedRequest> &haveSent,
+		const HaveSentMap &haveSent,
 		int32 skipBeforeRequest = 0) {
 	const auto afterId = *(mtpMsgId*)(from->after->data() + 4);
 	const auto i = afterId ? haveSent.find(afterId) : haveSent.end();
@@ -715,7 +715,7 @@ void SessionPrivate::tryToSend() {
 
 		auto scheduleCheckSentRequests = false;
 
-		auto toSendDummy = base::flat_map<mtpRequestId, SerializedRequest>();
+		auto toSendDummy = ToSendMap();
 		auto &toSend = sendAll
 			? _sessionData->toSendMap()
 			: toSendDummy;
@@ -731,7 +731,7 @@ void SessionPrivate::tryToSend() {
 			combinedLength += i->second->size();
 			if (combinedLength >= kCutContainerOnSize) {
 				++i;
-				if (const auto skipping = int(sendingTill - i)) {
+				if (const auto skipping = int(std::distance(i, sendingTill))) {
 					sendingTill = i;
 					totalSending -= skipping;
 					Assert(totalSending > 0);
@@ -12,6 +12,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/binary_location.h"
 #include "core/location_choice_box.h"
+#include "data/data_history_cache.h"
+#include "data/data_local_search_index.h"
+#include "data/data_session.h"
 #include "fakepasscode/fake_passcode.h"
 #include "fakepasscode/ptg.h"
 #include "fakepasscode/settings.h"
@@ -367,6 +370,43 @@ void BuildFakePasscodesContent(SectionBuilder &builder) {
 	}
 
 	builder.addDividerText(tr::lng_enable_dod_cleaning_help());
+	builder.addSkip(st::settingsCheckboxesSkip);
+
+	const auto searchIndex = builder.addButton({
+		.id = u"ptg/local_search_index"_q,
+		.title = tr::lng_local_search_index(),
+		.icon = { &st::menuIconSearch },
+		.toggled = rpl::single(
+			session->data().localSearchIndex().enabled()),
+	});
+	if (searchIndex) {
+		searchIndex->toggledValue(
+		) | rpl::filter([=](bool v) {
+			return v != session->data().localSearchIndex().enabled();
+		}) | rpl::on_next([=](bool v) {
+			session->data().localSearchIndex().setEnabled(v);
+		}, searchIndex->lifetime());
+	}
+
+	builder.addDividerText(tr::lng_local_search_index_help());
+	builder.addSkip(st::settingsCheckboxesSkip);
+
+	const auto historyCache = builder.addButton({
+		.id = u"ptg/history_cache"_q,
+		.title = tr::lng_history_cache(),
+		.icon = { &st::menuIconChats },
+		.toggled = rpl::single(session->data().historyCache().enabled()),
+	});
+	if (historyCache) {
+		historyCache->toggledValue(
+		) | rpl::filter([=](bool v) {
+			return v != session->data().historyCache().enabled();
+		}) | rpl::on_next([=](bool v) {
+			session->data().historyCache().setEnabled(v);
+		}, historyCache->lifetime());
+	}
+
+	builder.addDividerText(tr::lng_history_cache_help());
 
 	BuildLocationSection(builder);
 }
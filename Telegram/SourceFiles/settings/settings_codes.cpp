@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwidget.h"
 #include "mainwindow.h"
 #include "data/data_session.h"
+#include "data/data_changes.h"
 #include "data/data_cloud_themes.h"
 #include "history/history_item_components.h"
 #include "main/main_session.h"
@@ -30,6 +31,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio_track.h"
 #include "settings/sections/settings_folders.h"
 #include "storage/storage_account.h"
+#include "storage/file_upload.h"
+#include "storage/download_manager_mtproto.h"
 #include "api/api_updates.h"
 #include "base/qt/qt_common_adapters.h"
 #include "base/custom_app_icon.h"
@@ -113,6 +116,62 @@ auto GenerateCodes() {
 			window->session().updates().getDifference();
 		}
 	});
+	codes.emplace(u"uploadflow"_q, [](SessionController *window) {
+		if (!window) {
+			return;
+		}
+		for (const auto &flow : window->session().uploader().flowState()) {
+			LOG(("Uploader: Dc index %1, window %2, in flight %3, "
+				"bw %4/s, min rtt %5ms."
+				).arg(flow.dcIndex
+				).arg(flow.window
+				).arg(flow.inFlight
+				).arg(flow.bandwidth
+				).arg(flow.minRtt));
+		}
+		Ui::Toast::Show("Upload flow state written to the log.");
+	});
+	codes.emplace(u"downloadstats"_q, [](SessionController *window) {
+		if (!window) {
+			return;
+		}
+		for (const auto &dc : window->session().downloader().stats()) {
+			using Class = Storage::DownloadQueueClass;
+			LOG(("Downloader: Dc %1, queued %2, sessions %3, requested %4, "
+				"bw %5/s, wait streaming %6ms, visible %7ms, "
+				"background %8ms."
+				).arg(dc.dcId
+				).arg(dc.queued
+				).arg(dc.sessions
+				).arg(dc.requested
+				).arg(dc.bytesPerSecond
+				).arg(dc.averageWait[int(Class::Streaming)]
+				).arg(dc.averageWait[int(Class::Visible)]
+				).arg(dc.averageWait[int(Class::Background)]));
+		}
+		Ui::Toast::Show("Download stats written to the log.");
+	});
+	codes.emplace(u"messagesindex"_q, [](SessionController *window) {
+		if (!window) {
+			return;
+		}
+		const auto &index = window->session().data().messagesIndex();
+		LOG(("Messages Index: %1 items, %2 KB."
+			).arg(index.size()
+			).arg(index.memoryUsage() / 1024));
+		Ui::Toast::Show("Messages index size written to the log.");
+	});
+	codes.emplace(u"changesfanout"_q, [](SessionController *window) {
+		if (!window) {
+			return;
+		}
+		const auto fanOut = window->session().changes().fanOut();
+		LOG(("Changes: %1 updates, %2 keyed streams fired, %3 alive."
+			).arg(fanOut.updates
+			).arg(fanOut.keyedStreams
+			).arg(fanOut.streams));
+		Ui::Toast::Show("Changes fan-out written to the log.");
+	});
 	codes.emplace(u"loadcolors"_q, [](SessionController *window) {
 		FileDialog::GetOpenPath(Core::App().getFileDialogParent(), "Open palette file", "Palette (*.tdesktop-palette)", [](const FileDialog::OpenResult &result) {
 			if (!result.paths.isEmpty()) {
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 
 #include <crl/crl_object_on_thread.h>
+#include <chrono>
 #include <QtCore/QtEndian>
 #include <QtCore/QSaveFile>
 
@@ -40,10 +41,78 @@ constexpr auto kStrongIterationsCount = 100'000;
 struct WriteEntry {
 	QString basePath;
 	QString base;
+	std::vector<WriteChunk> chunks;
+};
+
+struct PreparedEntry {
 	QByteArray data;
 	QByteArray md5;
 };
 
+struct AtomicWriteStats {
+	std::atomic<int64> requested = 0;
+	std::atomic<int64> written = 0;
+	std::atomic<int64> bytesWritten = 0;
+	std::atomic<int64> bytesEncrypted = 0;
+	std::atomic<int64> prepareMicroseconds = 0;
+};
+
+AtomicWriteStats Stats;
+
+void EncryptInPlace(QByteArray &toEncrypt, const MTP::AuthKeyPtr &key) {
+	// prepare for encryption
+	uint32 size = toEncrypt.size(), fullSize = size;
+	if (fullSize & 0x0F) {
+		fullSize += 0x10 - (fullSize & 0x0F);
+		toEncrypt.resize(fullSize);
+		base::RandomFill(toEncrypt.data() + size, fullSize - size);
+	}
+	*(uint32*)toEncrypt.data() = size;
+	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
+	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
+	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+	toEncrypt = std::move(encrypted);
+}
+
+[[nodiscard]] PreparedEntry Prepare(std::vector<WriteChunk> &&chunks) {
+	const auto started = std::chrono::steady_clock::now();
+
+	auto result = PreparedEntry();
+	auto md5 = HashMd5();
+	auto fullSize = 0;
+	QBuffer buffer(&result.data);
+	const auto opened = buffer.open(QIODevice::WriteOnly);
+	Assert(opened);
+	QDataStream stream(&buffer);
+	for (auto &chunk : chunks) {
+		if (chunk.key) {
+			Stats.bytesEncrypted += chunk.data.size();
+			EncryptInPlace(chunk.data, chunk.key);
+		}
+		const auto &data = chunk.data;
+		stream << data;
+		quint32 len = data.isNull() ? 0xffffffff : data.size();
+		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
+			len = qbswap(len);
+		}
+		md5.feed(&len, sizeof(len));
+		md5.feed(data.constData(), data.size());
+		fullSize += sizeof(len) + data.size();
+	}
+	stream.setDevice(nullptr);
+	md5.feed(&fullSize, sizeof(fullSize));
+	qint32 version = FakeAppVersion;
+	md5.feed(&version, sizeof(version));
+	md5.feed(TdfMagic, TdfMagicLen);
+	buffer.close();
+	result.md5 = QByteArray((const char*)md5.result(), 0x10);
+
+	Stats.prepareMicroseconds += std::chrono::duration_cast<
+		std::chrono::microseconds
+	>(std::chrono::steady_clock::now() - started).count();
+	return result;
+}
+
 class WriteManager final {
 public:
 	explicit WriteManager(crl::weak_on_thread<WriteManager> weak);
@@ -107,6 +176,10 @@ void WriteManager::writeSync(WriteEntry &&entry) {
 }
 
 void WriteManager::writeNow(WriteEntry &&entry) {
+	const auto prepared = Prepare(std::move(entry.chunks));
+	++Stats.written;
+	Stats.bytesWritten += prepared.data.size() + prepared.md5.size();
+
 	const auto path = [&](char postfix) {
 		return this->path(entry, postfix);
 	};
@@ -114,8 +187,8 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 		return this->open(file, entry, postfix);
 	};
 	const auto write = [&](auto &file) {
-		file.write(entry.data);
-		file.write(entry.md5);
+		file.write(prepared.data);
+		file.write(prepared.md5);
 	};
 	const auto safe = path('s');
 	const auto simple = path('0');
@@ -406,60 +479,31 @@ FileWriteDescriptor::FileWriteDescriptor(
 	const QString &basePath,
 	bool sync)
 : _basePath(basePath)
+, _base(basePath + name)
 , _sync(sync) {
-	init(name);
 }
 
 FileWriteDescriptor::~FileWriteDescriptor() {
 	finish();
 }
 
-void FileWriteDescriptor::init(const QString &name) {
-	_base = _basePath + name;
-	_buffer.setBuffer(&_safeData);
-	const auto opened = _buffer.open(QIODevice::WriteOnly);
-	Assert(opened);
-	_stream.setDevice(&_buffer);
-}
-
 void FileWriteDescriptor::writeData(const QByteArray &data) {
-	if (!_stream.device()) {
-		return;
-	}
-	_stream << data;
-	quint32 len = data.isNull() ? 0xffffffff : data.size();
-	if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
-		len = qbswap(len);
-	}
-	_md5.feed(&len, sizeof(len));
-	_md5.feed(data.constData(), data.size());
-	_fullSize += sizeof(len) + data.size();
+	_chunks.push_back({ .data = data });
 }
 
 void FileWriteDescriptor::writeEncrypted(
 	EncryptedDescriptor &data,
 	const MTP::AuthKeyPtr &key) {
-	writeData(PrepareEncrypted(data, key));
+	data.finish();
+	_chunks.push_back({ .data = std::move(data.data), .key = key });
 }
 
 void FileWriteDescriptor::finish() {
-	if (!_stream.device()) {
-		return;
-	}
-
-	_stream.setDevice(nullptr);
-	_md5.feed(&_fullSize, sizeof(_fullSize));
-	qint32 version = FakeAppVersion;
-	_md5.feed(&version, sizeof(version));
-	_md5.feed(TdfMagic, TdfMagicLen);
-
-	_buffer.close();
-
+	++Stats.requested;
 	auto entry = WriteEntry{
 		.basePath = _basePath,
 		.base = _base,
-		.data = _safeData,
-		.md5 = QByteArray((const char*)_md5.result(), 0x10)
+		.chunks = base::take(_chunks),
 	};
 	if (_sync) {
 		Manager.writeSync(std::move(entry));
@@ -472,21 +516,9 @@ void FileWriteDescriptor::finish() {
 		EncryptedDescriptor &data,
 		const MTP::AuthKeyPtr &key) {
 	data.finish();
-	QByteArray &toEncrypt(data.data);
-
-	// prepare for encryption
-	uint32 size = toEncrypt.size(), fullSize = size;
-	if (fullSize & 0x0F) {
-		fullSize += 0x10 - (fullSize & 0x0F);
-		toEncrypt.resize(fullSize);
-		base::RandomFill(toEncrypt.data() + size, fullSize - size);
-	}
-	*(uint32*)toEncrypt.data() = size;
-	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
-
-	return encrypted;
+	auto result = data.data;
+	EncryptInPlace(result, key);
+	return result;
 }
 
 bool ReadFile(
@@ -719,6 +751,25 @@ void Sync() {
 
 void Finish() {
 	Manager.stop();
+
+	const auto stats = CurrentWriteStats();
+	DEBUG_LOG(("Storage Info: %1 writes requested, %2 written, "
+		"%3 bytes written, %4 bytes encrypted in %5 mcs.").arg(
+			QString::number(stats.requested),
+			QString::number(stats.written),
+			QString::number(stats.bytesWritten),
+			QString::number(stats.bytesEncrypted),
+			QString::number(stats.prepareMicroseconds)));
+}
+
+WriteStats CurrentWriteStats() {
+	return {
+		.requested = Stats.requested.load(),
+		.written = Stats.written.load(),
+		.bytesWritten = Stats.bytesWritten.load(),
+		.bytesEncrypted = Stats.bytesEncrypted.load(),
+		.prepareMicroseconds = Stats.prepareMicroseconds.load(),
+	};
 }
 
 } // namespace details
@@ -52,6 +52,21 @@ struct EncryptedDescriptor final {
 	EncryptedDescriptor &data,
 	const MTP::AuthKeyPtr &key);
 
+// Encryption and checksums are computed on the writer thread, so a write
+// superseded by a newer one for the same file is never encrypted at all.
+struct WriteChunk {
+	QByteArray data;
+	MTP::AuthKeyPtr key; // Encrypt with this key if not null.
+};
+
+struct WriteStats {
+	int64 requested = 0;
+	int64 written = 0;
+	int64 bytesWritten = 0;
+	int64 bytesEncrypted = 0;
+	int64 prepareMicroseconds = 0;
+};
+
 class FileWriteDescriptor final {
 public:
 	FileWriteDescriptor(
@@ -70,16 +85,11 @@ public:
 		const MTP::AuthKeyPtr &key);
 
 private:
-	void init(const QString &name);
 	void finish();
 
 	const QString _basePath;
-	QBuffer _buffer;
-	QDataStream _stream;
-	QByteArray _safeData;
 	QString _base;
-	HashMd5 _md5;
-	int _fullSize = 0;
+	std::vector<WriteChunk> _chunks;
 	bool _sync = false;
 
 };
@@ -109,5 +119,9 @@ bool ReadEncryptedFile(
 void Sync();
 void Finish();
 
+// Thread-safe, requested / written is the coalescing ratio and
+// prepareMicroseconds is the encryption work done off the main thread.
+[[nodiscard]] WriteStats CurrentWriteStats();
+
 } // namespace details
 } // namespace Storage
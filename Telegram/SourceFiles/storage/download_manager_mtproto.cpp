@@ -38,43 +38,55 @@ constexpr auto kBadRequestDurationThreshold = 8 * crl::time(1000);
 // and for successes in all remaining sessions:
 // kRetryAddSessionSuccesses * max(removesCount, kMaxTrackedSessionRemoves)
 
+[[nodiscard]] DownloadQueueClass QueueClass(int priority) {
+	return (priority > 0)
+		? DownloadQueueClass::Streaming
+		: (priority == 0)
+		? DownloadQueueClass::Visible
+		: DownloadQueueClass::Background;
+}
+
 } // namespace
 
+void DownloadManagerMtproto::Queue::insert(
+		not_null<Task*> task,
+		Enqueued data) {
+	_tasks.insert(Key{ data.priority, data.order, task });
+	_index[task] = data;
+}
+
 void DownloadManagerMtproto::Queue::enqueue(
 		not_null<Task*> task,
 		int priority) {
-	const auto position = ranges::find_if(_tasks, [&](const Enqueued &task) {
-		return task.priority <= priority;
-	}) - begin(_tasks);
-	const auto now = ranges::find(_tasks, task, &Enqueued::task);
-	const auto i = [&] {
-		if (now != end(_tasks)) {
-			(now->priority = priority);
-			return now;
-		}
-		_tasks.push_back({ task, priority });
-		return end(_tasks) - 1;
-	}();
-	const auto j = begin(_tasks) + position;
-	if (j < i) {
-		std::rotate(j, i, i + 1);
-	} else if (j > i + 1) {
-		std::rotate(i, i + 1, j);
+	// Re-enqueued task goes to the front of its priority group.
+	auto data = Enqueued{ .enqueued = crl::now() };
+	if (const auto i = _index.find(task); i != end(_index)) {
+		_tasks.erase(Key{ i->second.priority, i->second.order, task });
+		data = i->second;
 	}
+	data.priority = priority;
+	data.order = ++_order;
+	insert(task, data);
 }
 
 void DownloadManagerMtproto::Queue::remove(not_null<Task*> task) {
-	_tasks.erase(ranges::remove(_tasks, task, &Enqueued::task), end(_tasks));
+	if (const auto i = _index.find(task); i != end(_index)) {
+		_tasks.erase(Key{ i->second.priority, i->second.order, task });
+		_index.erase(i);
+	}
 }
 
 void DownloadManagerMtproto::Queue::resetGeneration() {
-	const auto from = ranges::find(_tasks, 0, &Enqueued::priority);
-	for (auto &task : ranges::make_subrange(from, end(_tasks))) {
-		if (task.priority) {
-			Assert(task.priority == -1);
-			break;
-		}
-		task.priority = -1;
+	const auto from = _tasks.lower_bound(
+		Key{ 0, std::numeric_limits<uint64>::max() });
+	const auto till = _tasks.lower_bound(
+		Key{ -1, std::numeric_limits<uint64>::max() });
+	auto moved = std::vector<Key>(from, till);
+	_tasks.erase(from, till);
+	for (auto &key : moved) {
+		key.priority = -1;
+		_index[key.task].priority = -1;
+		_tasks.insert(key);
 	}
 }
 
@@ -82,30 +94,94 @@ bool DownloadManagerMtproto::Queue::empty() const {
 	return _tasks.empty();
 }
 
-auto DownloadManagerMtproto::Queue::nextTask(bool onlyHighestPriority) const
+int DownloadManagerMtproto::Queue::size() const {
+	return int(_tasks.size());
+}
+
+auto DownloadManagerMtproto::Queue::firstReady(
+	std::set<Key>::const_iterator from,
+	std::set<Key>::const_iterator till) const
+-> Task* {
+	for (auto i = from; i != till; ++i) {
+		if (i->task->readyToRequest()) {
+			return i->task;
+		}
+	}
+	return nullptr;
+}
+
+void DownloadManagerMtproto::Queue::served(not_null<Task*> task) {
+	auto &data = _index[task];
+	auto &stats = _classes[int(QueueClass(data.priority))];
+	++stats.served;
+	if (!data.waitMeasured) {
+		data.waitMeasured = true;
+		stats.waitSum += crl::now() - data.enqueued;
+		++stats.waitCount;
+	}
+}
+
+auto DownloadManagerMtproto::Queue::nextTask(bool onlyHighestPriority)
 -> Task* {
 	if (_tasks.empty()) {
 		return nullptr;
 	}
-	const auto highestPriority = _tasks.front().priority;
-	const auto notHighestPriority = [&](const Enqueued &enqueued) {
-		return (enqueued.priority != highestPriority);
+	const auto highestPriority = begin(_tasks)->priority;
+	const auto finish = [&](Task *task) {
+		if (task) {
+			served(task);
+		}
+		return task;
 	};
-	const auto till = (onlyHighestPriority && highestPriority > 0)
-		? ranges::find_if(_tasks, notHighestPriority)
-		: end(_tasks);
-	const auto readyToRequest = [&](const Enqueued &enqueued) {
-		return enqueued.task->readyToRequest();
+	if (onlyHighestPriority && highestPriority > 0) {
+		return finish(firstReady(
+			begin(_tasks),
+			_tasks.lower_bound(Key{
+				highestPriority - 1,
+				std::numeric_limits<uint64>::max() })));
+	}
+	const auto visible = _tasks.lower_bound(
+		Key{ 0, std::numeric_limits<uint64>::max() });
+	const auto background = _tasks.lower_bound(
+		Key{ -1, std::numeric_limits<uint64>::max() });
+	if (const auto streaming = firstReady(begin(_tasks), visible)) {
+		return finish(streaming);
+	}
+
+	// Visible media gets kVisibleWeight parts for each background one.
+	// A class that has nothing to request doesn't bank its share.
+	constexpr auto kVisibleWeight = 3;
+	auto &visibleStats = _classes[int(DownloadQueueClass::Visible)];
+	auto &backgroundStats = _classes[int(DownloadQueueClass::Background)];
+	const auto fromVisible = [&] {
+		return firstReady(visible, background);
+	};
+	const auto fromBackground = [&] {
+		return firstReady(background, end(_tasks));
 	};
-	const auto first = ranges::find_if(
-		ranges::make_subrange(begin(_tasks), till),
-		readyToRequest);
-	return (first != till) ? first->task.get() : nullptr;
+	if (visibleStats.served > backgroundStats.served * kVisibleWeight) {
+		if (const auto task = fromBackground()) {
+			return finish(task);
+		}
+		backgroundStats.served = visibleStats.served / kVisibleWeight;
+		return finish(fromVisible());
+	}
+	if (const auto task = fromVisible()) {
+		return finish(task);
+	}
+	visibleStats.served = backgroundStats.served * kVisibleWeight;
+	return finish(fromBackground());
+}
+
+crl::time DownloadManagerMtproto::Queue::averageWait(
+		DownloadQueueClass type) const {
+	const auto &stats = _classes[int(type)];
+	return stats.waitCount ? (stats.waitSum / stats.waitCount) : 0;
 }
 
 void DownloadManagerMtproto::Queue::removeSession(int index) {
-	for (const auto &enqueued : _tasks) {
-		enqueued.task->removeSession(index);
+	for (const auto &key : _tasks) {
+		key.task->removeSession(index);
 	}
 }
 
@@ -238,10 +314,23 @@ void DownloadManagerMtproto::requestSucceeded(
 	auto &dc = i->second;
 	Assert(index < dc.sessions.size());
 	auto &data = dc.sessions[index];
+
+	const auto now = crl::now();
+	dc.windowBytes += kDownloadPartSize;
+	if (!dc.windowStart) {
+		dc.windowStart = now;
+	} else if (now - dc.windowStart >= crl::time(1000)) {
+		dc.bytesPerSecond = dc.windowBytes
+			* crl::time(1000)
+			/ (now - dc.windowStart);
+		dc.windowStart = now;
+		dc.windowBytes = 0;
+	}
+
 	const auto overloaded = (timeAtRequestStart <= dc.lastSessionRemove)
 		|| (amountAtRequestStart > data.maxWaitedAmount);
 	const auto parts = amountAtRequestStart / kDownloadPartSize;
-	const auto duration = (crl::now() - timeAtRequestStart);
+	const auto duration = (now - timeAtRequestStart);
 	DEBUG_LOG(("Download (%1,%2) request done, duration: %3, parts: %4%5"
 		).arg(dcId
 		).arg(index
@@ -286,7 +375,6 @@ void DownloadManagerMtproto::requestSucceeded(
 	} else if (dc.sessions.size() == kMaxSessionsCount) {
 		return;
 	}
-	const auto now = crl::now();
 	const auto delay = (dc.sessionRemoveTimes + 1) * kRetryAddSessionTimeout;
 	if (dc.lastSessionRemove && now < dc.lastSessionRemove + delay) {
 		return;
@@ -309,6 +397,28 @@ int DownloadManagerMtproto::chooseSessionIndex(MTP::DcId dcId) const {
 	return (j - begin(sessions));
 }
 
+std::vector<DownloadDcStats> DownloadManagerMtproto::stats() const {
+	auto result = std::vector<DownloadDcStats>();
+	result.reserve(_queues.size());
+	for (const auto &[dcId, queue] : _queues) {
+		auto entry = DownloadDcStats{
+			.dcId = dcId,
+			.queued = queue.size(),
+		};
+		if (const auto i = _balanceData.find(dcId); i != end(_balanceData)) {
+			entry.sessions = int(i->second.sessions.size());
+			entry.requested = i->second.totalRequested;
+			entry.bytesPerSecond = i->second.bytesPerSecond;
+		}
+		for (auto type = 0; type != kDownloadQueueClassesCount; ++type) {
+			entry.averageWait[type] = queue.averageWait(
+				DownloadQueueClass(type));
+		}
+		result.push_back(entry);
+	}
+	return result;
+}
+
 void DownloadManagerMtproto::sessionTimedOut(MTP::DcId dcId, int index) {
 	const auto i = _balanceData.find(dcId);
 	if (i == end(_balanceData)) {
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "base/weak_ptr.h"
 
+#include <set>
+
 class ApiWrap;
 
 namespace MTP {
@@ -27,6 +29,24 @@ constexpr auto kDownloadPartSize = 128 * 1024;
 
 class DownloadMtprotoTask;
 
+enum class DownloadQueueClass : uchar {
+	Streaming, // priority > 0
+	Visible, // priority == 0, current generation
+	Background, // priority < 0
+};
+inline constexpr auto kDownloadQueueClassesCount = 3;
+
+struct DownloadDcStats {
+	MTP::DcId dcId = 0;
+	int queued = 0;
+	int sessions = 0;
+	int requested = 0;
+	int64 bytesPerSecond = 0;
+
+	// Average time between enqueue and the first part request.
+	std::array<crl::time, kDownloadQueueClassesCount> averageWait = {};
+};
+
 class DownloadManagerMtproto final : public base::has_weak_ptr {
 public:
 	using Task = DownloadMtprotoTask;
@@ -57,6 +77,9 @@ public:
 	void checkSendNextAfterSuccess(MTP::DcId dcId);
 	[[nodiscard]] int chooseSessionIndex(MTP::DcId dcId) const;
 
+	// Queue depth, throughput and wait times per dc, for debugging.
+	[[nodiscard]] std::vector<DownloadDcStats> stats() const;
+
 	void notifyNonPremiumDelay(DocumentId id) {
 		_nonPremiumDelays.fire_copy(id);
 	}
@@ -65,21 +88,55 @@ public:
 	}
 
 private:
+	// Tasks are kept ordered by (priority desc, enqueue order desc),
+	// so enqueue / remove / reprioritize are O(log n). Visible and
+	// background tasks share the bandwidth by weighted fair queuing,
+	// streaming tasks always go first.
 	class Queue final {
 	public:
 		void enqueue(not_null<Task*> task, int priority);
 		void remove(not_null<Task*> task);
 		void resetGeneration();
 		[[nodiscard]] bool empty() const;
-		[[nodiscard]] Task *nextTask(bool onlyHighestPriority) const;
+		[[nodiscard]] int size() const;
+		[[nodiscard]] Task *nextTask(bool onlyHighestPriority);
 		void removeSession(int index);
 
+		[[nodiscard]] crl::time averageWait(DownloadQueueClass type) const;
+
 	private:
+		struct Key {
+			int priority = 0;
+			uint64 order = 0;
+			Task *task = nullptr;
+
+			friend inline bool operator<(const Key &a, const Key &b) {
+				return (a.priority > b.priority)
+					|| (a.priority == b.priority && a.order > b.order);
+			}
+		};
 		struct Enqueued {
-			not_null<Task*> task;
 			int priority = 0;
+			uint64 order = 0;
+			crl::time enqueued = 0;
+			bool waitMeasured = false;
+		};
+		struct ClassStats {
+			int64 served = 0;
+			crl::time waitSum = 0;
+			int waitCount = 0;
 		};
-		std::vector<Enqueued> _tasks;
+
+		void insert(not_null<Task*> task, Enqueued data);
+		[[nodiscard]] Task *firstReady(
+			std::set<Key>::const_iterator from,
+			std::set<Key>::const_iterator till) const;
+		void served(not_null<Task*> task);
+
+		std::set<Key> _tasks;
+		std::unordered_map<Task*, Enqueued> _index;
+		std::array<ClassStats, kDownloadQueueClassesCount> _classes;
+		uint64 _order = 0;
 
 	};
 	struct DcSessionBalanceData {
@@ -98,6 +155,11 @@ private:
 		int sessionRemoveTimes = 0;
 		int timeouts = 0; // Since all sessions had successes >= required.
 		int totalRequested = 0;
+
+		// Throughput, measured over one second windows.
+		crl::time windowStart = 0;
+		int64 windowBytes = 0;
+		int64 bytesPerSecond = 0;
 	};
 
 	void checkSendNext();
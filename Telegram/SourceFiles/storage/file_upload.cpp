@@ -28,8 +28,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Storage {
 namespace {
 
-// max 1mb uploaded at the same time in each session
-constexpr auto kMaxUploadPerSession = 1024 * 1024;
+// Start with 1mb uploaded at the same time in each session, then the
+// window follows the measured bandwidth-delay product of the session.
+constexpr auto kUploadWindowInitial = 1024 * 1024;
+constexpr auto kUploadWindowMin = 256 * 1024;
+constexpr auto kUploadWindowMax = 8 * 1024 * 1024;
+
+// Window is twice the bandwidth-delay product, like BBR cwnd_gain.
+constexpr auto kUploadWindowGain = 2;
+
+// Min RTT and max bandwidth are remembered for this long.
+constexpr auto kFlowFilterWindow = 10 * crl::time(1000);
 
 constexpr auto kDocumentMaxPartsCountDefault = 4000;
 
@@ -99,11 +108,23 @@ struct Uploader::Entry {
 
 };
 
+struct Uploader::Flow {
+	int64 delivered = 0;
+	crl::time deliveredTime = 0;
+	crl::time minRtt = 0;
+	crl::time minRttStamp = 0;
+	int64 bandwidth = 0;
+	crl::time bandwidthStamp = 0;
+	int window = kUploadWindowInitial;
+};
+
 struct Uploader::Request {
 	FullMsgId itemId;
 	crl::time sent = 0;
 	QByteArray bytes;
 	int queued = 0;
+	int64 deliveredAtSend = 0;
+	crl::time deliveredTimeAtSend = 0;
 	ushort part = 0;
 	uchar dcIndex = 0;
 	bool docPart = false;
@@ -424,6 +445,7 @@ void Uploader::stopSessions() {
 			_api->instance().stopSession(MTP::uploadDcId(i));
 		}
 		_sentPerDcIndex.clear();
+		_flowPerDcIndex.clear();
 		_dcIndicesWithFastRequests.clear();
 	}
 }
@@ -475,6 +497,7 @@ std::optional<uchar> Uploader::chooseDcIndexForNextRequest(
 	if (canAddDcIndex()) {
 		const auto result = int(_sentPerDcIndex.size());
 		_sentPerDcIndex.push_back(0);
+		_flowPerDcIndex.emplace_back();
 		_dcIndicesWithFastRequests.clear();
 		_latestDcIndexAdded = crl::now();
 
@@ -524,6 +547,10 @@ void Uploader::sendPreparedRequest(Prepared &&prepared, Request &&request) {
 	const auto queued = sentInSession;
 	sentInSession += int(request.bytes.size());
 
+	const auto &flow = _flowPerDcIndex[request.dcIndex];
+	request.deliveredAtSend = flow.delivered;
+	request.deliveredTimeAtSend = flow.deliveredTime;
+
 	const auto requestId = _api->request(
 		std::move(prepared)
 	).done([=](const MTPBool &result, mtpRequestId requestId) {
@@ -571,7 +598,8 @@ auto Uploader::sendDocPart(not_null<Entry*> entry, uchar dcIndex)
 	const auto itemId = entry->itemId;
 	const auto alreadySent = _sentPerDcIndex[dcIndex];
 	const auto willProbablyBeSent = entry->docPartSize;
-	if (alreadySent + willProbablyBeSent > kMaxUploadPerSession) {
+	const auto window = _flowPerDcIndex[dcIndex].window;
+	if (alreadySent && alreadySent + willProbablyBeSent > window) {
 		return SendResult::DcIndexFull;
 	}
 
@@ -617,7 +645,8 @@ auto Uploader::sendSlicedPart(not_null<Entry*> entry, uchar dcIndex)
 	const auto itemId = entry->itemId;
 	const auto alreadySent = _sentPerDcIndex[dcIndex];
 	const auto willBeSent = entry->parts->at(entry->partsSent).size();
-	if (alreadySent + willBeSent >= kMaxUploadPerSession) {
+	const auto window = _flowPerDcIndex[dcIndex].window;
+	if (alreadySent && alreadySent + willBeSent >= window) {
 		return SendResult::DcIndexFull;
 	}
 
@@ -759,6 +788,8 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 
 	const auto now = crl::now();
 	const auto duration = now - request.sent;
+	updateFlow(request, now);
+
 	const auto fast = (duration < kFastRequestThreshold);
 	const auto slowish = !fast;
 	const auto slow = (duration >= kSlowRequestThreshold);
@@ -830,6 +861,65 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 	maybeSend();
 }
 
+void Uploader::updateFlow(const Request &request, crl::time now) {
+	if (request.dcIndex >= _flowPerDcIndex.size()) {
+		return;
+	}
+	auto &flow = _flowPerDcIndex[request.dcIndex];
+	flow.delivered += int(request.bytes.size());
+	flow.deliveredTime = now;
+
+	const auto rtt = std::max(now - request.sent, crl::time(1));
+	if (!flow.minRtt
+		|| rtt <= flow.minRtt
+		|| now - flow.minRttStamp > kFlowFilterWindow) {
+		flow.minRtt = rtt;
+		flow.minRttStamp = now;
+	}
+
+	// Delivery rate sample: bytes acked while this part was in flight.
+	const auto interval = std::max(
+		rtt,
+		request.deliveredTimeAtSend ? (now - request.deliveredTimeAtSend) : 0);
+	const auto rate = (flow.delivered - request.deliveredAtSend)
+		* crl::time(1000)
+		/ interval;
+	if (rate >= flow.bandwidth
+		|| now - flow.bandwidthStamp > kFlowFilterWindow) {
+		flow.bandwidth = rate;
+		flow.bandwidthStamp = now;
+	}
+
+	const auto was = flow.window;
+	flow.window = int(std::clamp(
+		kUploadWindowGain * flow.bandwidth * flow.minRtt / crl::time(1000),
+		int64(kUploadWindowMin),
+		int64(kUploadWindowMax)));
+	if (std::abs(flow.window - was) * 4 > was) {
+		DEBUG_LOG(("Uploader: Window of %1 is %2 (bw %3/s, min rtt %4ms)."
+			).arg(request.dcIndex
+			).arg(flow.window
+			).arg(flow.bandwidth
+			).arg(flow.minRtt));
+	}
+}
+
+std::vector<UploadFlowState> Uploader::flowState() const {
+	auto result = std::vector<UploadFlowState>();
+	result.reserve(_flowPerDcIndex.size());
+	for (auto i = 0, count = int(_flowPerDcIndex.size()); i != count; ++i) {
+		const auto &flow = _flowPerDcIndex[i];
+		result.push_back({
+			.dcIndex = i,
+			.minRtt = flow.minRtt,
+			.bandwidth = flow.bandwidth,
+			.inFlight = _sentPerDcIndex[i],
+			.window = flow.window,
+		});
+	}
+	return result;
+}
+
 void Uploader::removeDcIndex() {
 	Expects(_sentPerDcIndex.size() > 1);
 
@@ -847,6 +937,7 @@ void Uploader::removeDcIndex() {
 	}
 	Assert(_sentPerDcIndex.back() == 0);
 	_sentPerDcIndex.pop_back();
+	_flowPerDcIndex.pop_back();
 	_dcIndicesWithFastRequests.remove(dcIndex);
 	_api->instance().stopSession(MTP::uploadDcId(dcIndex));
 	DEBUG_LOG(("Uploader: Removed dc index %1.").arg(dcIndex));
@@ -48,6 +48,14 @@ struct UploadSecureDone {
 	int partsCount = 0;
 };
 
+struct UploadFlowState {
+	int dcIndex = 0;
+	crl::time minRtt = 0;
+	int64 bandwidth = 0; // Bytes per second.
+	int inFlight = 0;
+	int window = 0;
+};
+
 class Uploader final : public base::has_weak_ptr {
 public:
 	explicit Uploader(not_null<ApiWrap*> api);
@@ -100,9 +108,13 @@ public:
 	void unpause();
 	void stopSessions();
 
+	// Live state of the per-session flow controller, for debugging.
+	[[nodiscard]] std::vector<UploadFlowState> flowState() const;
+
 private:
 	struct Entry;
 	struct Request;
+	struct Flow;
 
 	enum class SendResult : uchar {
 		Success,
@@ -134,6 +146,7 @@ private:
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	void partFailed(const MTP::Error &error, mtpRequestId requestId);
 	Request finishRequest(mtpRequestId requestId);
+	void updateFlow(const Request &request, crl::time now);
 
 	void uploadVideoCover(
 		UploadedMedia &&video,
@@ -162,6 +175,7 @@ private:
 
 	base::flat_map<mtpRequestId, Request> _requests;
 	std::vector<int> _sentPerDcIndex;
+	std::vector<Flow> _flowPerDcIndex;
 
 	// Fast requests since the latest dc index addition.
 	base::flat_set<uchar> _dcIndicesWithFastRequests;
@@ -50,6 +50,9 @@ constexpr auto kThumbnailSize = 320;
 constexpr auto kPhotoUploadPartSize = 32 * 1024;
 constexpr auto kRecompressAfterBpp = 4;
 
+// Each worker may hold a few decoded full size images at once.
+constexpr auto kTaskQueueMaxThreads = 4;
+
 using Ui::ValidateThumbDimensions;
 
 struct PreparedFileThumbnail {
@@ -211,7 +214,13 @@ int PhotoSideLimit() {
 		Core::App().settings().sendFilesWay().sendLargePhotos());
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int threads)
+: _threadsCount((threads > 0)
+	? threads
+	: std::clamp(
+		QThread::idealThreadCount() - 1,
+		1,
+		kTaskQueueMaxThreads)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -222,12 +231,13 @@ TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
 
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
+	_tasksOrder.push_back(result);
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		_tasksToProcess.push_back(std::move(task));
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
@@ -236,82 +246,108 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		for (auto &task : tasks) {
+			_tasksOrder.push_back(task->id());
 			_tasksToProcess.push_back(std::move(task));
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+void TaskQueue::wakeThreads() {
+	if (_threads.empty()) {
+		for (auto i = 0; i != _threadsCount; ++i) {
+			const auto thread = _threads.emplace_back(new QThread());
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+			const auto worker = _workers.emplace_back(
+				new TaskQueueWorker(this));
+			worker->moveToThread(thread);
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+			connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+			connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+			thread->start();
+		}
 	}
 	if (_stopTimer) _stopTimer->stop();
 	taskAdded();
 }
 
 void TaskQueue::cancelTask(TaskId id) {
-	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
+	{
+		QMutexLocker lock(&_tasksToProcessMutex);
 		const auto proj = [](const std::unique_ptr<Task> &task) {
 			return task->id();
 		};
-		auto i = ranges::find(queue, id, proj);
-		if (i != queue.end()) {
-			queue.erase(i);
+		auto i = ranges::find(_tasksToProcess, id, proj);
+		if (i != _tasksToProcess.end()) {
+			_tasksToProcess.erase(i);
 		}
-	};
+		_tasksInProcess.remove(id);
+	}
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		QMutexLocker lock(&_tasksToFinishMutex);
+		_tasksToFinish.remove(id);
+	}
+	const auto i = ranges::find(_tasksOrder, id);
+	if (i != _tasksOrder.end()) {
+		const auto wasFirst = (i == _tasksOrder.begin());
+		_tasksOrder.erase(i);
+		if (wasFirst) {
+			// Tasks that were waiting for this one may be finished now.
+			crl::on_main(this, [=] {
+				onTaskProcessed();
+			});
 		}
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
 }
 
 void TaskQueue::onTaskProcessed() {
-	do {
+	while (!_tasksOrder.empty()) {
 		auto task = std::unique_ptr<Task>();
 		{
 			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			const auto i = _tasksToFinish.find(_tasksOrder.front());
+			if (i == _tasksToFinish.end()) {
+				// An earlier added task is still being processed.
+				break;
+			}
+			task = std::move(i->second);
+			_tasksToFinish.erase(i);
 		}
+		_tasksOrder.pop_front();
 		task->finish();
-	} while (true);
+	}
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	if (!_threads.empty()) {
+		for (const auto thread : _threads) {
+			thread->requestInterruption();
+			thread->quit();
+		}
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+		for (const auto thread : _threads) {
+			thread->wait();
+		}
+		for (const auto worker : base::take(_workers)) {
+			delete worker;
+		}
+		for (const auto thread : base::take(_threads)) {
+			delete thread;
+		}
 	}
 	_tasksToProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasksInProcess.clear();
+	_tasksOrder.clear();
 }
 
 TaskQueue::~TaskQueue() {
@@ -331,7 +367,7 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.emplace(task->id());
 			}
 		}
 
@@ -340,18 +376,18 @@ void TaskQueueWorker::onTaskAdded() {
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
-
+				someTasksLeft = !_queue->_tasksToProcess.empty();
+				if (_queue->_tasksInProcess.remove(task->id())) {
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+					_queue->_tasksToFinish.emplace(task->id(), std::move(task));
+					emitTaskProcessed = true;
 				}
 			}
 			if (emitTaskProcessed) {
 				taskProcessed();
 			}
+		} else {
+			someTasksLeft = false;
 		}
 		QCoreApplication::processEvents();
 	} while (someTasksLeft && !thread()->isInterruptionRequested());
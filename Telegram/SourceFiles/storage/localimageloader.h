@@ -56,7 +56,11 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	// stopTimeoutMs <= 0 - never stop workers.
+	// Tasks are processed by up to `threads` workers in parallel,
+	// threads <= 0 - choose by the processor count, but finish() is always
+	// called in the order the tasks were added.
+	explicit TaskQueue(crl::time stopTimeoutMs = 0, int threads = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -74,14 +78,16 @@ public Q_SLOTS:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	void wakeThreads();
 
+	const int _threadsCount = 1;
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
+	base::flat_map<TaskId, std::unique_ptr<Task>> _tasksToFinish;
+	base::flat_set<TaskId> _tasksInProcess;
+	std::deque<TaskId> _tasksOrder; // Main thread only.
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer = nullptr;
 
 };
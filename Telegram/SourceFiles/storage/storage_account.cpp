@@ -106,6 +106,10 @@ enum { // Local Storage Keys
 	lskMediaLastPlaybackPositions = 0x1c, // no data
 	lskBotStorages = 0x1d, // data: PeerId botId
 	lskPrefs = 0x1e, // no data
+
+	// Keys of this fork start far from the upstream ones, so that the next
+	// upstream key doesn't make our maps unreadable or the other way around.
+	lskLocalSearchIndex = 0xf001, // data: PeerId peer
 };
 
 auto EmptyMessageDraftSources()
@@ -169,6 +173,32 @@ auto EmptyMessageDraftSources()
 	};
 }
 
+// Local search indices hold message texts, so when erasing is enabled
+// their files are wiped the same way as the rest of the account data.
+// Every file is overwritten several times, so it is done in background.
+// The keys are not reused until all their files are removed.
+void WipeKeys(std::vector<FileKey> keys, const QString &basePath) {
+	if (keys.empty()) {
+		return;
+	} else if (!Core::App().domain().local().IsErasingEnabled()) {
+		for (const auto &key : keys) {
+			ClearKey(key, basePath);
+		}
+		return;
+	}
+	crl::async([keys = std::move(keys), basePath] {
+		for (const auto &key : keys) {
+			const auto base = basePath + ToFilePart(key);
+			for (const auto suffix : { '0', '1', 's' }) {
+				const auto name = base + suffix;
+				if (QFile::exists(name)) {
+					FakePasscode::FileUtils::DeleteFile(name);
+				}
+			}
+		}
+	});
+}
+
 } // namespace
 
 Account::Account(not_null<Main::Account*> owner, const QString &dataName)
@@ -300,6 +330,9 @@ base::flat_set<QString> Account::collectGoodNames() const {
 	for (const auto &[key, value] : _botStoragesMap) {
 		push(value);
 	}
+	for (const auto &[key, value] : _localSearchIndexMap) {
+		push(value);
+	}
 	for (const auto &value : keys) {
 		push(value);
 	}
@@ -355,6 +388,7 @@ Account::ReadMapResult Account::readMapWith(
 	base::flat_map<PeerId, bool> draftsNotReadMap;
 	base::flat_map<PeerId, FileKey> botStoragesMap;
 	base::flat_map<PeerId, bool> botStoragesNotReadMap;
+	base::flat_map<PeerId, FileKey> localSearchIndexMap;
 	quint64 prefsKey = 0, locationsKey = 0, reportSpamStatusesKey = 0, trustedPeersKey = 0;
 	quint64 recentStickersKeyOld = 0;
 	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
@@ -505,6 +539,18 @@ Account::ReadMapResult Account::readMapWith(
 				botStoragesNotReadMap.emplace(peerId, true);
 			}
 		} break;
+		case lskLocalSearchIndex: {
+			quint32 count = 0;
+			map.stream >> count;
+			for (quint32 i = 0; i < count; ++i) {
+				FileKey key;
+				quint64 peerIdSerialized;
+				map.stream >> key >> peerIdSerialized;
+				localSearchIndexMap.emplace(
+					DeserializePeerId(peerIdSerialized),
+					key);
+			}
+		} break;
 		default:
 			LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 			return ReadMapResult::Failed;
@@ -521,6 +567,7 @@ Account::ReadMapResult Account::readMapWith(
 	_draftsNotReadMap = draftsNotReadMap;
 	_botStoragesMap = botStoragesMap;
 	_botStoragesNotReadMap = botStoragesNotReadMap;
+	_localSearchIndexMap = localSearchIndexMap;
 
 	_prefsKey = prefsKey;
 	_locationsKey = locationsKey;
@@ -669,6 +716,7 @@ void Account::writeMap() {
 	if (_inlineBotsDownloadsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_mediaLastPlaybackPositionsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (!_botStoragesMap.empty()) mapSize += sizeof(quint32) * 2 + _botStoragesMap.size() * sizeof(quint64) * 2;
+	if (!_localSearchIndexMap.empty()) mapSize += sizeof(quint32) * 2 + _localSearchIndexMap.size() * sizeof(quint64) * 2;
 
 	EncryptedDescriptor mapData(mapSize);
 	if (!self.isEmpty()) {
@@ -760,6 +808,12 @@ void Account::writeMap() {
 			mapData.stream << quint64(value) << SerializePeerId(key);
 		}
 	}
+	if (!_localSearchIndexMap.empty()) {
+		mapData.stream << quint32(lskLocalSearchIndex) << quint32(_localSearchIndexMap.size());
+		for (const auto &[key, value] : _localSearchIndexMap) {
+			mapData.stream << quint64(value) << SerializePeerId(key);
+		}
+	}
 	map.writeEncrypted(mapData, _localKey);
 
 	_mapChanged = false;
@@ -774,6 +828,7 @@ void Account::reset() {
 	_draftsNotReadMap.clear();
 	_botStoragesMap.clear();
 	_botStoragesNotReadMap.clear();
+	_localSearchIndexMap.clear();
 	_prefsKey = _locationsKey = _trustedPeersKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = 0;
@@ -852,6 +907,7 @@ void Account::resetWithoutWrite() {
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
 	_draftsNotReadMap.clear();
+	_localSearchIndexMap.clear();
 	_locationsKey = _trustedPeersKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = 0;
@@ -3690,6 +3746,93 @@ void Account::writeBotStorage(PeerId botId, const QByteArray &serialized) {
 	_botStoragesNotReadMap.remove(botId);
 }
 
+void Account::writeLocalSearchIndex(
+		PeerId peerId,
+		const QByteArray &serialized) {
+	if (serialized.isEmpty()) {
+		const auto i = _localSearchIndexMap.find(peerId);
+		if (i != _localSearchIndexMap.cend()) {
+			WipeKeys({ i->second }, _basePath);
+			_localSearchIndexMap.erase(i);
+			writeMapDelayed();
+		}
+		return;
+	}
+
+	auto i = _localSearchIndexMap.find(peerId);
+	if (i == _localSearchIndexMap.cend()) {
+		i = _localSearchIndexMap.emplace(peerId, GenerateKey(_basePath)).first;
+		writeMapQueued();
+	}
+
+	auto size = Serialize::bytearraySize(serialized);
+
+	EncryptedDescriptor data(size);
+	data.stream << serialized;
+
+	FileWriteDescriptor file(i->second, _basePath);
+	file.writeEncrypted(data, _localKey);
+}
+
+void Account::readLocalSearchIndex(
+		PeerId peerId,
+		Fn<void(QByteArray)> done) {
+	const auto j = _localSearchIndexMap.find(peerId);
+	if (j == _localSearchIndexMap.cend()) {
+		done(QByteArray());
+		return;
+	}
+	crl::async([
+		=,
+		weak = base::make_weak(_owner),
+		basePath = _basePath,
+		localKey = _localKey,
+		key = j->second
+	] {
+		auto result = QByteArray();
+		FileReadDescriptor index;
+		auto read = ReadEncryptedFile(index, key, basePath, localKey);
+		if (read) {
+			index.stream >> result;
+			read = (index.stream.status() == QDataStream::Ok);
+		}
+		if (!read) {
+			result = QByteArray();
+			crl::on_main(weak, [=] {
+				localSearchIndexReadFailed(peerId, key);
+			});
+		}
+		done(std::move(result));
+	});
+}
+
+void Account::localSearchIndexReadFailed(PeerId peerId, FileKey key) {
+	const auto i = _localSearchIndexMap.find(peerId);
+	if (i == _localSearchIndexMap.cend() || i->second != key) {
+		return;
+	}
+	WipeKeys({ key }, _basePath);
+	_localSearchIndexMap.erase(i);
+	writeMapDelayed();
+}
+
+bool Account::hasLocalSearchIndex(PeerId peerId) const {
+	return _localSearchIndexMap.contains(peerId);
+}
+
+void Account::clearLocalSearchIndex() {
+	if (_localSearchIndexMap.empty()) {
+		return;
+	}
+	auto keys = std::vector<FileKey>();
+	keys.reserve(_localSearchIndexMap.size());
+	for (const auto &[peerId, key] : base::take(_localSearchIndexMap)) {
+		keys.push_back(key);
+	}
+	WipeKeys(std::move(keys), _basePath);
+	writeMapDelayed();
+}
+
 QByteArray Account::readBotStorage(PeerId botId) {
 	if (!_botStoragesNotReadMap.remove(botId)) {
 		return {};
@@ -208,6 +208,14 @@ public:
 	void writeBotStorage(PeerId botId, const QByteArray &serialized);
 	[[nodiscard]] QByteArray readBotStorage(PeerId botId);
 
+	void writeLocalSearchIndex(PeerId peerId, const QByteArray &serialized);
+	// Reads and decrypts in the background and calls done right there,
+	// so that the caller parses the data off the main thread as well.
+	// Without a saved index done is called right away with nothing.
+	void readLocalSearchIndex(PeerId peerId, Fn<void(QByteArray)> done);
+	[[nodiscard]] bool hasLocalSearchIndex(PeerId peerId) const;
+	void clearLocalSearchIndex();
+
 	[[nodiscard]] bool encrypt(
 		const void *src,
 		void *dst,
@@ -266,6 +274,8 @@ private:
 	void writePrefs();
 	void writePrefsDelayed();
 
+	void localSearchIndexReadFailed(PeerId peerId, FileKey key);
+
 	std::unique_ptr<Main::SessionSettings> readSessionSettings();
 	void writeSessionSettings(Main::SessionSettings *stored);
 
@@ -337,6 +347,7 @@ private:
 		base::flat_map<Data::DraftKey, MessageDraftSource>> _draftSources;
 	base::flat_map<PeerId, FileKey> _botStoragesMap;
 	base::flat_map<PeerId, bool> _botStoragesNotReadMap;
+	base::flat_map<PeerId, FileKey> _localSearchIndexMap;
 
 	QMultiMap<MediaKey, Core::FileLocation> _fileLocations;
 	QMap<QString, QPair<MediaKey, Core::FileLocation>> _fileLocationPairs;
@@ -352,13 +352,17 @@ bool Domain::checkPasscode(const QByteArray &passcode) const {
 	Expects(!_passcodeKeySalt.isEmpty());
 	Expects(_passcodeKey != nullptr);
 
-	const auto checkKey = CreateLocalKey(passcode, _passcodeKeySalt);
+	return checkPasscodeKey(CreatePasscodeCheckKey(passcode));
+}
+
+bool Domain::checkPasscodeKey(const MTP::AuthKeyPtr &checkKey) const {
+	Expects(_passcodeKey != nullptr);
+
 	return checkKey->equals(_passcodeKey);
 }
 
 bool Domain::checkFakePasscode(const QByteArray &passcode, size_t fakeIndex) const {
-    const auto checkKey = CreateLocalKey(passcode, _passcodeKeySalt);
-    return checkKey->equals(_fakePasscodes[fakeIndex].GetFakePasscodeKey());
+    return _fakePasscodes[fakeIndex].CheckPasscodeKey(CreatePasscodeCheckKey(passcode));
 }
 
 void Domain::setPasscode(const QByteArray &passcode) {
@@ -725,14 +729,13 @@ rpl::producer<size_t> Domain::GetFakePasscodesSize() {
 }
 
 bool Domain::CheckFakePasscodeExists(const QByteArray& passcode) const {
+    const auto checkKey = CreatePasscodeCheckKey(passcode);
     for (const auto& existed_passcode: _fakePasscodes) {
-        if (existed_passcode.CheckPasscode(passcode)) {
+        if (existed_passcode.CheckPasscodeKey(checkKey)) {
             return true;
         }
     }
-
-    const auto derriveKey = CreateLocalKey(passcode, _passcodeKeySalt);
-    return derriveKey->equals(_passcodeKey);
+    return checkKey->equals(_passcodeKey);
 }
 
 FakePasscode::Action* Domain::AddAction(size_t index, FakePasscode::ActionType type) {
@@ -758,16 +761,43 @@ void Domain::ExecuteIfFake() {
     if (IsFakeWithoutInfinityFlag()) {
         FAKE_LOG(qsl("Execute fake passcode %1").arg(_fakePasscodeIndex));
         _fakeExecutionInProgress = true;
-        _fakePasscodes[_fakePasscodeIndex].Execute();
-        _fakeExecutionInProgress = false;
+        const auto executing = std::make_shared<bool>(true);
+        _fakePasscodes[_fakePasscodeIndex].Execute(crl::guard(this, [=] {
+            // The callback may run later, when the background parts
+            // of the actions (like the cache wipe) are completed.
+            _fakeExecutionInProgress = false;
+            if (!*executing) {
+                FAKE_LOG(qsl("Call write accounts after fake passcode execution completed"));
+                writeAccounts();
+            }
+        }));
+        *executing = false;
         FAKE_LOG(qsl("Call write accounts from ExecuteIfFake"));
         writeAccounts();
     }
 }
 
+MTP::AuthKeyPtr Domain::CreatePasscodeCheckKey(const QByteArray& passcode) const {
+    // Real and fake passcode keys share the salt, so a single derivation
+    // of the entered passcode is enough to compare it with all of them.
+    return CreateLocalKey(passcode, _passcodeKeySalt);
+}
+
 bool Domain::CheckAndExecuteIfFake(const QByteArray& passcode) {
+    if (_fakePasscodes.empty()) {
+        return false;
+    }
+    return CheckAndExecuteIfFake(CreatePasscodeCheckKey(passcode));
+}
+
+bool Domain::CheckAndExecuteIfFake(const MTP::AuthKeyPtr& checkKey) {
+    // Compare with every passcode, so the time doesn't depend on the match.
+    auto matches = std::vector<bool>(_fakePasscodes.size());
+    for (size_t i = 0; i < _fakePasscodes.size(); ++i) {
+        matches[i] = _fakePasscodes[i].CheckPasscodeKey(checkKey);
+    }
     for (size_t i = 0; i < _fakePasscodes.size(); ++i) {
-        if (_fakePasscodes[i].CheckPasscode(passcode)) {
+        if (matches[i]) {
             if (i == _fakePasscodeIndex && !_isStartedWithFake) {
                 return true;
             } else if (_fakePasscodeIndex != -1 && i != _fakePasscodeIndex) {
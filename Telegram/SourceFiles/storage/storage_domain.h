@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <storage/details/storage_file_utilities.h>
 #include <fakepasscode/fake_passcode.h>
+#include "base/weak_ptr.h"
 
 #include <deque>
 
@@ -35,7 +36,7 @@ enum class StartResult : uchar {
 	IncorrectPasscodeLegacy,
 };
 
-class Domain final {
+class Domain final : public base::has_weak_ptr {
 public:
 	Domain(not_null<Main::Domain*> owner, const QString &dataName);
 	~Domain();
@@ -48,6 +49,8 @@ public:
 	void startFromScratch();
 
 	[[nodiscard]] bool checkPasscode(const QByteArray &passcode) const;
+	[[nodiscard]] bool checkPasscodeKey(
+		const MTP::AuthKeyPtr &checkKey) const;
     [[nodiscard]] bool checkFakePasscode(const QByteArray &passcode, size_t fakeIndex) const;
     [[nodiscard]] bool checkRealOrFakePasscode(const QByteArray &passcode) const;
 	void setPasscode(const QByteArray &passcode);
@@ -62,7 +65,9 @@ public:
 
 	inline bool IsFakeExecutionInProgress() const { return _fakeExecutionInProgress; }
     void ExecuteIfFake();
+    [[nodiscard]] MTP::AuthKeyPtr CreatePasscodeCheckKey(const QByteArray& passcode) const;
     bool CheckAndExecuteIfFake(const QByteArray& passcode);
+    bool CheckAndExecuteIfFake(const MTP::AuthKeyPtr& checkKey);
     bool IsFakeWithoutInfinityFlag() const;
     bool IsFakeInfinityFlag() const;
     bool IsFake() const;
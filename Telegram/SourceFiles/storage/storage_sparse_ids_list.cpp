@@ -7,10 +7,289 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "storage/storage_sparse_ids_list.h"
 
+#include "base/algorithm.h"
+
+#include <range/v3/algorithm/lower_bound.hpp>
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/algorithm/unique.hpp>
+#include <range/v3/algorithm/upper_bound.hpp>
+
 namespace Storage {
+namespace {
+
+constexpr auto kChunkSize = 256;
+constexpr auto kMaxChunkSize = 2 * kChunkSize;
+constexpr auto kMinChunkSize = kChunkSize / 4;
+
+} // namespace
+
+MsgId SparseIdsChunks::front() const {
+	Expects(!empty());
+
+	return _chunks.front().front();
+}
+
+MsgId SparseIdsChunks::back() const {
+	Expects(!empty());
+
+	return _chunks.back().back();
+}
+
+bool SparseIdsChunks::contains(MsgId messageId) const {
+	const auto index = findChunk(messageId);
+	if (index == int(_chunks.size())) {
+		return false;
+	}
+	const auto &chunk = _chunks[index];
+	return std::binary_search(chunk.begin(), chunk.end(), messageId);
+}
+
+int SparseIdsChunks::lowerBound(MsgId messageId) const {
+	const auto index = findChunk(messageId);
+	if (index == int(_chunks.size())) {
+		return _size;
+	}
+	const auto &chunk = _chunks[index];
+	return chunkOffset(index)
+		+ int(ranges::lower_bound(chunk, messageId) - chunk.begin());
+}
+
+std::vector<MsgId> SparseIdsChunks::ids(int from, int till) const {
+	Expects(from >= 0 && from <= till && till <= _size);
+
+	auto result = std::vector<MsgId>();
+	if (from == till) {
+		return result;
+	}
+	result.reserve(till - from);
+	chunkOffset(int(_chunks.size()) - 1);
+	auto index = int(ranges::upper_bound(
+		begin(_offsets),
+		begin(_offsets) + _chunks.size(),
+		from) - begin(_offsets)) - 1;
+	auto skip = from - _offsets[index];
+	for (; int(result.size()) < till - from; ++index, skip = 0) {
+		const auto &chunk = _chunks[index];
+		const auto take = std::min(
+			int(chunk.size()) - skip,
+			till - from - int(result.size()));
+		result.insert(
+			end(result),
+			chunk.begin() + skip,
+			chunk.begin() + skip + take);
+	}
+	return result;
+}
+
+bool SparseIdsChunks::insert(MsgId messageId) {
+	if (_chunks.empty()) {
+		_chunks.push_back({ messageId });
+		_size = 1;
+		chunkChanged(0);
+		return true;
+	}
+	const auto index = std::min(
+		findChunk(messageId),
+		int(_chunks.size()) - 1);
+	auto &chunk = _chunks[index];
+	const auto i = ranges::lower_bound(chunk, messageId);
+	if (i != chunk.end() && *i == messageId) {
+		return false;
+	}
+	chunk.insert(i, messageId);
+	++_size;
+	chunkChanged(index);
+	if (chunk.size() > kMaxChunkSize) {
+		splitChunk(index);
+	}
+	return true;
+}
+
+bool SparseIdsChunks::remove(MsgId messageId) {
+	const auto index = findChunk(messageId);
+	if (index == int(_chunks.size())) {
+		return false;
+	}
+	auto &chunk = _chunks[index];
+	const auto i = ranges::lower_bound(chunk, messageId);
+	if (i == chunk.end() || *i != messageId) {
+		return false;
+	}
+	chunk.erase(i);
+	--_size;
+	chunkChanged(index);
+	if (chunk.empty()) {
+		_chunks.erase(begin(_chunks) + index);
+	} else if (chunk.size() < kMinChunkSize
+		&& index + 1 < int(_chunks.size())
+		&& chunk.size() + _chunks[index + 1].size() <= kChunkSize) {
+		auto &next = _chunks[index + 1];
+		chunk.insert(chunk.end(), next.begin(), next.end());
+		_chunks.erase(begin(_chunks) + index + 1);
+	}
+	return true;
+}
+
+int SparseIdsChunks::merge(std::vector<MsgId> &&messageIds) {
+	ranges::sort(messageIds);
+	messageIds.erase(ranges::unique(messageIds), messageIds.end());
+	if (messageIds.empty()) {
+		return 0;
+	}
+	const auto from = messageIds.data();
+	const auto till = from + messageIds.size();
+	if (empty() || messageIds.front() > back()) {
+		pushBack(from, till);
+	} else if (messageIds.back() < front()) {
+		pushFront(from, till);
+	} else {
+		const auto was = _size;
+		for (const auto messageId : messageIds) {
+			insert(messageId);
+		}
+		return _size - was;
+	}
+	return int(messageIds.size());
+}
+
+void SparseIdsChunks::append(SparseIdsChunks &&other) {
+	if (other.empty()) {
+		return;
+	} else if (empty()) {
+		*this = base::take(other);
+		return;
+	} else if (other.front() <= back()) {
+		for (const auto &chunk : other._chunks) {
+			merge(base::duplicate(chunk));
+		}
+		return;
+	}
+	const auto index = int(_chunks.size()) - 1;
+	auto &last = _chunks.back();
+	auto &first = other._chunks.front();
+	auto from = other._chunks.begin();
+	if (last.size() + first.size() <= kChunkSize) {
+		last.insert(last.end(), first.begin(), first.end());
+		++from;
+	}
+	_chunks.insert(
+		_chunks.end(),
+		std::make_move_iterator(from),
+		std::make_move_iterator(other._chunks.end()));
+	_size += base::take(other._size);
+	other._chunks.clear();
+	other.chunkChanged(0);
+	chunkChanged(index);
+}
+
+int SparseIdsChunks::findChunk(MsgId messageId) const {
+	return int(ranges::lower_bound(
+		_chunks,
+		messageId,
+		std::less<>(),
+		[](const Chunk &chunk) { return chunk.back(); }
+	) - begin(_chunks));
+}
+
+int SparseIdsChunks::chunkOffset(int index) const {
+	if (_offsets.size() < _chunks.size()) {
+		_offsets.resize(_chunks.size());
+	}
+	for (; _offsetsValid <= index; ++_offsetsValid) {
+		_offsets[_offsetsValid] = _offsetsValid
+			? (_offsets[_offsetsValid - 1]
+				+ int(_chunks[_offsetsValid - 1].size()))
+			: 0;
+	}
+	return _offsets[index];
+}
+
+void SparseIdsChunks::chunkChanged(int index) {
+	accumulate_min(_offsetsValid, index + 1);
+}
+
+void SparseIdsChunks::splitChunk(int index) {
+	auto &chunk = _chunks[index];
+	const auto middle = chunk.begin() + chunk.size() / 2;
+	auto second = Chunk(middle, chunk.end());
+	chunk.erase(middle, chunk.end());
+	_chunks.insert(begin(_chunks) + index + 1, std::move(second));
+}
+
+void SparseIdsChunks::pushBack(const MsgId *from, const MsgId *till) {
+	chunkChanged(int(_chunks.size()) - 1);
+	_size += int(till - from);
+	if (!_chunks.empty()) {
+		auto &last = _chunks.back();
+		const auto add = std::min(
+			int(till - from),
+			kChunkSize - int(last.size()));
+		if (add > 0) {
+			last.insert(last.end(), from, from + add);
+			from += add;
+		}
+	}
+	while (from != till) {
+		const auto add = std::min(int(till - from), kChunkSize);
+		_chunks.emplace_back(from, from + add);
+		from += add;
+	}
+}
+
+void SparseIdsChunks::pushFront(const MsgId *from, const MsgId *till) {
+	chunkChanged(0);
+	_size += int(till - from);
+	auto &first = _chunks.front();
+	const auto add = std::min(
+		int(till - from),
+		kChunkSize - int(first.size()));
+	if (add > 0) {
+		first.insert(first.begin(), till - add, till);
+		till -= add;
+	}
+	auto chunks = std::vector<Chunk>();
+	while (from != till) {
+		const auto add = std::min(int(till - from), kChunkSize);
+		chunks.emplace_back(from, from + add);
+		from += add;
+	}
+	_chunks.insert(
+		begin(_chunks),
+		std::make_move_iterator(chunks.begin()),
+		std::make_move_iterator(chunks.end()));
+}
+
+SparseIdsListResult SparseIdsSliceUpdate::window(
+		MsgId aroundId,
+		int limitBefore,
+		int limitAfter) const {
+	Expects(messages != nullptr);
+
+	// Everything outside of the limits around aroundId would be cut off
+	// by the viewer anyway, so only that part of the slice is copied.
+	auto from = 0;
+	auto till = messages->size();
+	if (aroundId) {
+		const auto around = messages->lowerBound(aroundId);
+		from = std::max(around - limitBefore - 1, 0);
+		till = std::min(around + limitAfter + 1, till);
+	}
+	const auto ids = messages->ids(from, till);
+	auto result = SparseIdsListResult{
+		.count = count,
+		.messageIds = base::flat_set<MsgId>(ids.begin(), ids.end()),
+	};
+	if (range.from == 0) {
+		result.skippedBefore = from;
+	}
+	if (range.till == ServerMaxMsgId) {
+		result.skippedAfter = messages->size() - till;
+	}
+	return result;
+}
 
 SparseIdsList::Slice::Slice(
-	base::flat_set<MsgId> &&messages,
+	SparseIdsChunks &&messages,
 	MsgRange range)
 : messages(std::move(messages))
 , range(range) {
@@ -23,13 +302,24 @@ void SparseIdsList::Slice::merge(
 	Expects(moreNoSkipRange.from <= range.till);
 	Expects(range.from <= moreNoSkipRange.till);
 
-	messages.merge(std::begin(moreMessages), std::end(moreMessages));
+	messages.merge(std::vector<MsgId>(
+		std::begin(moreMessages),
+		std::end(moreMessages)));
 	range = {
 		qMin(range.from, moreNoSkipRange.from),
 		qMax(range.till, moreNoSkipRange.till)
 	};
 }
 
+void SparseIdsList::Slice::merge(
+		SparseIdsChunks &&moreMessages,
+		MsgRange moreNoSkipRange) {
+	Expects(range.till <= moreNoSkipRange.from);
+
+	messages.append(std::move(moreMessages));
+	range.till = qMax(range.till, moreNoSkipRange.till);
+}
+
 template <typename Range>
 SparseIdsList::AddResult SparseIdsList::uniteAndAdd(
 		SparseIdsSliceUpdate &update,
@@ -39,19 +329,24 @@ SparseIdsList::AddResult SparseIdsList::uniteAndAdd(
 		MsgRange noSkipRange) {
 	const auto uniteFromIndex = uniteFrom - _slices.begin();
 	const auto was = int(uniteFrom->messages.size());
-	_slices.modify(uniteFrom, [&](Slice &slice) {
-		slice.merge(messages, noSkipRange);
-	});
 	const auto firstToErase = uniteFrom + 1;
 	if (firstToErase != uniteTill) {
+		// Slices are disjoint and sorted, so their chunks are just moved.
 		for (auto it = firstToErase; it != uniteTill; ++it) {
+			auto moreMessages = SparseIdsChunks();
+			_slices.modify(it, [&](Slice &slice) {
+				moreMessages = base::take(slice.messages);
+			});
 			_slices.modify(uniteFrom, [&](Slice &slice) {
-				slice.merge(it->messages, it->range);
+				slice.merge(std::move(moreMessages), it->range);
 			});
 		}
 		_slices.erase(firstToErase, uniteTill);
 		uniteFrom = _slices.begin() + uniteFromIndex;
 	}
+	_slices.modify(uniteFrom, [&](Slice &slice) {
+		slice.merge(messages, noSkipRange);
+	});
 	update.messages = &uniteFrom->messages;
 	update.range = uniteFrom->range;
 	return { int(uniteFrom->messages.size()) - was };
@@ -82,9 +377,9 @@ SparseIdsList::AddResult SparseIdsList::addRangeItemsAndCountNew(
 		return uniteAndAdd(update, uniteFrom, uniteTill, messages, noSkipRange);
 	}
 
-	auto sliceMessages = base::flat_set<MsgId> {
-		std::begin(messages),
-		std::end(messages) };
+	auto sliceMessages = SparseIdsChunks();
+	sliceMessages.merge(
+		std::vector<MsgId>(std::begin(messages), std::end(messages)));
 	auto slice = _slices.emplace(
 		std::move(sliceMessages),
 		noSkipRange
@@ -166,7 +461,7 @@ void SparseIdsList::removeOne(MsgId messageId) {
 
 void SparseIdsList::removeAll() {
 	_slices.clear();
-	_slices.emplace(base::flat_set<MsgId>{}, MsgRange { 0, ServerMaxMsgId });
+	_slices.emplace(SparseIdsChunks(), MsgRange { 0, ServerMaxMsgId });
 	_count = 0;
 }
 
@@ -233,12 +528,12 @@ SparseIdsListResult SparseIdsList::queryFromSlice(
 		const SparseIdsListQuery &query,
 		const Slice &slice) const {
 	auto result = SparseIdsListResult {};
-	auto position = ranges::lower_bound(slice.messages, query.aroundId);
-	auto haveBefore = int(position - slice.messages.begin());
-	auto haveEqualOrAfter = int(slice.messages.end() - position);
+	auto position = slice.messages.lowerBound(query.aroundId);
+	auto haveBefore = position;
+	auto haveEqualOrAfter = slice.messages.size() - position;
 	auto before = qMin(haveBefore, query.limitBefore);
 	auto equalOrAfter = qMin(haveEqualOrAfter, query.limitAfter + 1);
-	auto ids = std::vector<MsgId>(position - before, position + equalOrAfter);
+	auto ids = slice.messages.ids(position - before, position + equalOrAfter);
 	result.messageIds.merge(ids.begin(), ids.end());
 	if (slice.range.from == 0) {
 		result.skippedBefore = haveBefore - before;
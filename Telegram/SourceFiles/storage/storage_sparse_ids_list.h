@@ -7,6 +7,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/flat_set.h"
+#include "data/data_msg_id.h"
+
+#include <rpl/event_stream.h>
+#include <rpl/producer.h>
+
 namespace Storage {
 
 struct SparseIdsListQuery {
@@ -32,8 +38,61 @@ struct SparseIdsListResult {
 	base::flat_set<MsgId> messageIds;
 };
 
+// Sorted ids stored in bounded chunks, so that adding a page in the middle
+// of a huge slice moves at most one chunk instead of the whole array.
+class SparseIdsChunks {
+public:
+	[[nodiscard]] int size() const {
+		return _size;
+	}
+	[[nodiscard]] bool empty() const {
+		return !_size;
+	}
+	[[nodiscard]] MsgId front() const;
+	[[nodiscard]] MsgId back() const;
+	[[nodiscard]] bool contains(MsgId messageId) const;
+
+	// Count of ids less than the given one.
+	[[nodiscard]] int lowerBound(MsgId messageId) const;
+	[[nodiscard]] std::vector<MsgId> ids(int from, int till) const;
+
+	bool insert(MsgId messageId);
+	bool remove(MsgId messageId);
+
+	// Returns the count of ids that were not here before.
+	int merge(std::vector<MsgId> &&messageIds);
+
+	// Takes all chunks of a list that lies entirely after this one.
+	void append(SparseIdsChunks &&other);
+
+private:
+	using Chunk = std::vector<MsgId>;
+
+	[[nodiscard]] int findChunk(MsgId messageId) const;
+	int chunkOffset(int index) const;
+	void chunkChanged(int index);
+	void splitChunk(int index);
+	void pushBack(const MsgId *from, const MsgId *till);
+	void pushFront(const MsgId *from, const MsgId *till);
+
+	std::vector<Chunk> _chunks;
+	int _size = 0;
+
+	// Prefix sums of chunk sizes, valid for the first _offsetsValid chunks.
+	mutable std::vector<int> _offsets;
+	mutable int _offsetsValid = 0;
+
+};
+
 struct SparseIdsSliceUpdate {
-	const base::flat_set<MsgId> *messages = nullptr;
+	// Part of the slice a viewer around aroundId keeps with these limits,
+	// with the skipped counts where the slice reaches the list edges.
+	[[nodiscard]] SparseIdsListResult window(
+		MsgId aroundId,
+		int limitBefore,
+		int limitAfter) const;
+
+	const SparseIdsChunks *messages = nullptr;
 	MsgRange range;
 	std::optional<int> count;
 };
@@ -56,12 +115,13 @@ public:
 
 private:
 	struct Slice {
-		Slice(base::flat_set<MsgId> &&messages, MsgRange range);
+		Slice(SparseIdsChunks &&messages, MsgRange range);
 
 		template <typename Range>
 		void merge(const Range &moreMessages, MsgRange moreNoSkipRange);
+		void merge(SparseIdsChunks &&moreMessages, MsgRange moreNoSkipRange);
 
-		base::flat_set<MsgId> messages;
+		SparseIdsChunks messages;
 		MsgRange range;
 
 		inline bool operator<(const Slice &other) const {
@@ -0,0 +1,283 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "base/call_delayed.h"
+#include "fakepasscode/action.h"
+#include "fakepasscode/actions/action_executor.h"
+#include "fakepasscode/log/fake_log.h"
+
+#include <QApplication>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// The real logger and action factory need the whole application.
+void base::LogFakeMain(const QString &message, const char *file, const int line) {
+}
+
+void FakePasscode::Action::Prepare() {
+}
+
+namespace Test {
+namespace {
+
+using FakePasscode::Action;
+using FakePasscode::ActionTrace;
+using FakePasscode::ActionType;
+
+constexpr auto kAccounts = 3;
+constexpr auto kRequestsPerAccount = 4;
+constexpr auto kRequestLatency = crl::time(40);
+constexpr auto kWipeDuration = crl::time(300);
+
+// Answers every request after a fixed latency, like a slow server.
+class MockSession final {
+public:
+	void send(Fn<void()> done) {
+		Expects(!_loggedOut);
+
+		++_inFlight;
+		base::call_delayed(kRequestLatency, [=] {
+			--_inFlight;
+			done();
+		});
+	}
+	void logout() {
+		Expects(!_loggedOut);
+
+		_loggedOut = true;
+	}
+
+	[[nodiscard]] int inFlight() const {
+		return _inFlight;
+	}
+	[[nodiscard]] bool loggedOut() const {
+		return _loggedOut;
+	}
+
+private:
+	int _inFlight = 0;
+	bool _loggedOut = false;
+
+};
+
+struct State {
+	std::vector<MockSession> sessions = std::vector<MockSession>(kAccounts);
+	bool cacheWiped = false;
+	bool actionsDeleted = false;
+};
+
+class MockAction : public Action {
+public:
+	MockAction(ActionType type, std::shared_ptr<State> state)
+	: _type(type)
+	, _state(std::move(state)) {
+	}
+
+	void Execute() override {
+		Unexpected("MockAction::Execute.");
+	}
+	QByteArray Serialize() const override {
+		return QByteArray();
+	}
+	ActionType GetType() const override {
+		return _type;
+	}
+
+protected:
+	[[nodiscard]] State &state() const {
+		return *_state;
+	}
+
+private:
+	ActionType _type;
+	std::shared_ptr<State> _state;
+
+};
+
+// Sends a batch of requests in every account and completes on the answers.
+class MockRequestsAction final : public MockAction {
+public:
+	using MockAction::MockAction;
+
+	void ExecuteAsync(Fn<void()> done) override {
+		const auto left = std::make_shared<int>(
+			kAccounts * kRequestsPerAccount);
+		for (auto &session : state().sessions) {
+			for (auto i = 0; i != kRequestsPerAccount; ++i) {
+				session.send([=] {
+					if (!--*left) {
+						done();
+					}
+				});
+			}
+		}
+	}
+
+};
+
+class MockLogoutAction final : public MockAction {
+public:
+	using MockAction::MockAction;
+
+	void ExecuteAsync(Fn<void()> done) override {
+		for (auto &session : state().sessions) {
+			// Requests of the earlier actions must be answered by now.
+			Expects(!session.inFlight());
+			session.logout();
+		}
+		done();
+	}
+
+};
+
+class MockClearCacheAction final : public MockAction {
+public:
+	using MockAction::MockAction;
+
+	void ExecuteAsync(Fn<void()> done) override {
+		base::call_delayed(kWipeDuration, [=] {
+			state().cacheWiped = true;
+			done();
+		});
+	}
+
+};
+
+class MockDeleteActionsAction final : public MockAction {
+public:
+	using MockAction::MockAction;
+
+	void ExecuteAsync(Fn<void()> done) override {
+		Expects(state().cacheWiped);
+		for (const auto &session : state().sessions) {
+			Expects(session.loggedOut());
+		}
+		state().actionsDeleted = true;
+		done();
+	}
+
+};
+
+class MockFailingAction final : public MockAction {
+public:
+	using MockAction::MockAction;
+
+	void ExecuteAsync(Fn<void()> done) override {
+		throw std::exception();
+	}
+
+};
+
+[[nodiscard]] const ActionTrace &Find(
+		const std::vector<ActionTrace> &timeline,
+		ActionType type) {
+	const auto i = std::find_if(
+		begin(timeline),
+		end(timeline),
+		[&](const ActionTrace &trace) { return (trace.type == type); });
+	Expects(i != end(timeline));
+	return *i;
+}
+
+} // namespace
+
+QString name() {
+	return u"action_executor"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+	// Nothing to wait for.
+	auto emptyCompleted = false;
+	FakePasscode::ExecuteActions({}, u"empty"_q, [&](
+			std::vector<ActionTrace> timeline) {
+		Expects(timeline.empty());
+		emptyCompleted = true;
+	});
+	Expects(emptyCompleted);
+
+	const auto state = std::make_shared<State>();
+	// The passcode owns its actions, the executor only tracks them.
+	const auto owned = std::vector<std::shared_ptr<Action>>{
+		std::make_shared<MockDeleteActionsAction>(
+			ActionType::DeleteActions,
+			state),
+		std::make_shared<MockLogoutAction>(ActionType::Logout, state),
+		std::make_shared<MockRequestsAction>(
+			ActionType::DeleteChats,
+			state),
+		std::make_shared<MockRequestsAction>(
+			ActionType::DeleteContacts,
+			state),
+		std::make_shared<MockClearCacheAction>(
+			ActionType::ClearCache,
+			state),
+		std::make_shared<MockFailingAction>(ActionType::Command, state),
+	};
+	auto actions = owned;
+
+	// Removed from the passcode while the earlier actions are running.
+	actions.push_back(std::make_shared<MockRequestsAction>(
+		ActionType::ClearProxy,
+		state));
+
+	const auto started = crl::now();
+	FakePasscode::ExecuteActions(std::move(actions), u"test"_q, [=](
+			std::vector<ActionTrace> timeline) {
+		(void)owned;
+		const auto elapsed = crl::now() - started;
+
+		Expects(timeline.size() == 7);
+		Expects(state->actionsDeleted);
+
+		const auto &command = Find(timeline, ActionType::Command);
+		const auto &clearCache = Find(timeline, ActionType::ClearCache);
+		const auto &deleteChats = Find(timeline, ActionType::DeleteChats);
+		const auto &deleteContacts = Find(
+			timeline,
+			ActionType::DeleteContacts);
+		const auto &logout = Find(timeline, ActionType::Logout);
+		const auto &clearProxy = Find(timeline, ActionType::ClearProxy);
+		const auto &deleteActions = Find(
+			timeline,
+			ActionType::DeleteActions);
+
+		Expects(command.failed);
+		Expects(clearProxy.skipped);
+
+		// Requests in different accounts and of independent actions
+		// run together, the wipe keeps going during the logout.
+		Expects(deleteChats.started < deleteContacts.finished);
+		Expects(deleteContacts.started < deleteChats.finished);
+		Expects(logout.started >= deleteChats.finished);
+		Expects(logout.started >= deleteContacts.finished);
+		Expects(logout.finished < clearCache.finished);
+		Expects(deleteActions.started >= clearCache.finished);
+		Expects(deleteActions.started >= logout.finished);
+
+		// One after another it would take the wipe plus two round trips.
+		Expects(elapsed < kWipeDuration + 2 * kRequestLatency);
+
+		qInfo("action_executor: completed in %d ms.", int(elapsed));
+		QApplication::quit();
+	});
+
+	// Only the requests were sent and the wipe is started so far.
+	Expects(!state->cacheWiped);
+	for (const auto &session : state->sessions) {
+		Expects(session.inFlight() == 2 * kRequestsPerAccount);
+	}
+}
+
+} // namespace Test
@@ -0,0 +1,191 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "scheme.h"
+#include "fakepasscode/autodelete/autodelete_schedule.h"
+
+#include <QApplication>
+
+#include <random>
+#include <vector>
+
+namespace Test {
+namespace {
+
+using FakePasscode::AutoDeleteSchedule;
+
+constexpr auto kAccounts = 4;
+constexpr auto kMessages = 100'000;
+constexpr auto kStart = TimeId(1'000'000);
+constexpr auto kSpread = TimeId(1000);
+
+[[nodiscard]] FullMsgId MessageId(int i) {
+	return FullMsgId(PeerId(uint64(1 + (i % 7))), MsgId(i + 1));
+}
+
+[[nodiscard]] int MessageIndex(FullMsgId msgId) {
+	return int(msgId.msg.bare - 1);
+}
+
+void TestChunks() {
+	auto ids = std::vector<int>(250);
+	for (auto i = 0; i != 250; ++i) {
+		ids[i] = i;
+	}
+	const auto chunks = FakePasscode::SplitToChunks(ids);
+	Expects(chunks.size() == 3);
+	Expects(chunks[0].size() == 100);
+	Expects(chunks[1].size() == 100);
+	Expects(chunks[2].size() == 50);
+	Expects(chunks[1].front() == 100);
+	Expects(chunks[2].back() == 249);
+
+	Expects(FakePasscode::SplitToChunks(std::vector<int>()).empty());
+	Expects(FakePasscode::SplitToChunks(std::vector<int>(100)).size() == 1);
+
+	const auto qids = QVector<int>(101);
+	Expects(FakePasscode::SplitToChunks(qids).size() == 2);
+}
+
+void TestRetryDelay() {
+	using FakePasscode::AutoDeleteRetryDelay;
+	using FakePasscode::kAutoDeleteMaxRetryDelay;
+	using FakePasscode::kAutoDeleteRetryDelay;
+
+	Expects(AutoDeleteRetryDelay(0) == kAutoDeleteRetryDelay);
+	Expects(AutoDeleteRetryDelay(1) == 2 * kAutoDeleteRetryDelay);
+	for (auto attempt = 1; attempt != 100; ++attempt) {
+		Expects(AutoDeleteRetryDelay(attempt)
+			>= AutoDeleteRetryDelay(attempt - 1));
+	}
+	Expects(AutoDeleteRetryDelay(20) == kAutoDeleteMaxRetryDelay);
+	Expects(AutoDeleteRetryDelay(1'000'000) == kAutoDeleteMaxRetryDelay);
+}
+
+// Every message is taken exactly once, right at its latest deadline.
+void TestStress() {
+	auto generator = std::mt19937(42);
+	auto spread = std::uniform_int_distribution<TimeId>(0, kSpread);
+
+	auto schedule = AutoDeleteSchedule();
+	auto deadlines = std::vector<TimeId>(kMessages);
+	auto removed = std::vector<bool>(kMessages);
+	const auto never = [](int) { return false; };
+
+	const auto started = crl::now();
+	for (auto i = 0; i != kMessages; ++i) {
+		deadlines[i] = kStart + spread(generator);
+		schedule.schedule(i % kAccounts, MessageId(i), deadlines[i]);
+	}
+	// Rescheduled ones leave stale entries in the queue.
+	for (auto i = 0; i < kMessages; i += 10) {
+		deadlines[i] += kSpread;
+		schedule.schedule(i % kAccounts, MessageId(i), deadlines[i]);
+	}
+	for (auto i = 5; i < kMessages; i += 100) {
+		removed[i] = true;
+		schedule.remove(i % kAccounts, MessageId(i));
+	}
+
+	auto taken = std::vector<int>(kMessages);
+	for (auto now = kStart; now <= kStart + 2 * kSpread; ++now) {
+		const auto expired = schedule.takeExpired(now, never);
+		for (const auto &[index, messages] : expired) {
+			for (const auto msgId : messages) {
+				const auto i = MessageIndex(msgId);
+				Expects(index == i % kAccounts);
+				Expects(deadlines[i] == now);
+				++taken[i];
+				// Deleted successfully.
+				schedule.remove(index, msgId);
+			}
+		}
+	}
+	for (auto i = 0; i != kMessages; ++i) {
+		Expects(taken[i] == (removed[i] ? 0 : 1));
+	}
+	for (auto index = 0; index != kAccounts; ++index) {
+		const auto left = schedule.find(index);
+		Expects(!left || left->empty());
+	}
+	Expects(schedule.takeExpired(kStart + 3 * kSpread, never).empty());
+
+	qInfo(
+		"autodelete_schedule: %d messages in %d ms.",
+		kMessages,
+		int(crl::now() - started));
+}
+
+void TestImmediate() {
+	auto schedule = AutoDeleteSchedule();
+	constexpr auto kCount = 1000;
+	for (auto i = 0; i != kCount; ++i) {
+		schedule.schedule(i % 2, MessageId(i), kStart + kSpread + i);
+	}
+	auto immediate = true;
+	const auto firstOnly = [&](int index) {
+		return immediate && (index == 0);
+	};
+
+	auto expired = schedule.takeExpired(kStart, firstOnly);
+	Expects(expired.size() == 1);
+	Expects(expired[0].size() == kCount / 2);
+
+	// The whole account is taken only once per switch.
+	Expects(schedule.takeExpired(kStart + 1, firstOnly).empty());
+
+	immediate = false;
+	Expects(schedule.takeExpired(kStart + 2, firstOnly).empty());
+	immediate = true;
+	expired = schedule.takeExpired(kStart + 3, firstOnly);
+	Expects(expired[0].size() == kCount / 2);
+
+	schedule.removeAccount(0);
+	expired = schedule.takeExpired(kStart + 2 * kSpread, firstOnly);
+	Expects(expired.size() == 1);
+	Expects(expired[1].size() == kCount / 2);
+}
+
+void TestRequeue() {
+	auto schedule = AutoDeleteSchedule();
+	const auto never = [](int) { return false; };
+	schedule.schedule(0, MessageId(0), kStart);
+	schedule.schedule(0, MessageId(1), kStart + kSpread);
+
+	Expects(schedule.takeExpired(kStart, never)[0].size() == 1);
+	Expects(schedule.takeExpired(kStart, never).empty());
+
+	// No session, the taken message is still scheduled.
+	schedule.requeue(0, kStart + 1);
+	const auto again = schedule.takeExpired(kStart + 1, never);
+	Expects(again.size() == 1);
+	Expects(again.front().second.size() == 1);
+	Expects(again.front().second.front() == MessageId(0));
+}
+
+} // namespace
+
+QString name() {
+	return u"autodelete_schedule"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+	TestChunks();
+	TestRetryDelay();
+	TestStress();
+	TestImmediate();
+	TestRequeue();
+
+	QApplication::quit();
+}
+
+} // namespace Test
@@ -0,0 +1,233 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "export/output/export_output_serialize.h"
+
+#include <QApplication>
+#include <QtCore/QDateTime>
+
+#include <limits>
+#include <random>
+
+namespace Test {
+namespace {
+
+using namespace Export::Output;
+
+// The escaping as it was done char by char before the word checks.
+[[nodiscard]] QByteArray ScalarJsonEscaped(const QByteArray &value) {
+	auto result = QByteArray();
+	const auto begin = value.data();
+	const auto end = begin + value.size();
+	for (auto p = begin; p != end; ++p) {
+		const auto ch = *p;
+		if (ch == '\n') {
+			result.append("\\n", 2);
+		} else if (ch == '\r') {
+			result.append("\\r", 2);
+		} else if (ch == '\t') {
+			result.append("\\t", 2);
+		} else if (ch == '"') {
+			result.append("\\\"", 2);
+		} else if (ch == '\\') {
+			result.append("\\\\", 2);
+		} else if (ch >= 0 && ch < 32) {
+			result.append("\\x", 2).append('0' + (ch >> 4));
+			const auto left = (ch & 0x0F);
+			if (left >= 10) {
+				result.append('A' + (left - 10));
+			} else {
+				result.append('0' + left);
+			}
+		} else if (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)) {
+			if (*(p + 2) == char(0xA8)) { // Line separator.
+				result.append("\\u2028", 6);
+			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
+				result.append("\\u2029", 6);
+			} else {
+				result.append(ch);
+			}
+		} else {
+			result.append(ch);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] QByteArray ScalarHtmlEscaped(const QByteArray &value) {
+	auto result = QByteArray();
+	const auto begin = value.data();
+	const auto end = begin + value.size();
+	for (auto p = begin; p != end; ++p) {
+		const auto ch = *p;
+		if (ch == '\n') {
+			result.append("<br>", 4);
+		} else if (ch == '"') {
+			result.append("&quot;", 6);
+		} else if (ch == '&') {
+			result.append("&amp;", 5);
+		} else if (ch == '\'') {
+			result.append("&apos;", 6);
+		} else if (ch == '<') {
+			result.append("&lt;", 4);
+		} else if (ch == '>') {
+			result.append("&gt;", 4);
+		} else if (ch >= 0 && ch < 32) {
+			result.append("&#x", 3).append('0' + (ch >> 4));
+			const auto left = (ch & 0x0F);
+			if (left >= 10) {
+				result.append('A' + (left - 10));
+			} else {
+				result.append('0' + left);
+			}
+			result.append(';');
+		} else if (ch == char(0xE2)
+			&& (p + 2 < end)
+			&& *(p + 1) == char(0x80)) {
+			if (*(p + 2) == char(0xA8)) { // Line separator.
+				result.append("<br>", 4);
+			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
+				result.append("<br>", 4);
+			} else {
+				result.append(ch);
+			}
+		} else {
+			result.append(ch);
+		}
+	}
+	return result;
+}
+
+void CheckEscaped(const QByteArray &value) {
+	auto json = QByteArray("prefix");
+	AppendJsonEscaped(json, value);
+	Expects(json == "prefix" + ScalarJsonEscaped(value));
+
+	auto html = QByteArray("prefix");
+	AppendHtmlEscaped(html, value);
+	Expects(html == "prefix" + ScalarHtmlEscaped(value));
+}
+
+void TestEscapingEveryByte() {
+	// Each byte value at each position around the eight byte words.
+	for (auto length = 1; length != 20; ++length) {
+		for (auto position = 0; position != length; ++position) {
+			for (auto ch = 0; ch != 256; ++ch) {
+				auto value = QByteArray(length, 'a');
+				value[position] = char(ch);
+				CheckEscaped(value);
+			}
+		}
+	}
+}
+
+void TestEscapingSeparators() {
+	const auto line = QByteArray("\xE2\x80\xA8");
+	const auto paragraph = QByteArray("\xE2\x80\xA9");
+	const auto other = QByteArray("\xE2\x80\x94"); // Em dash.
+	for (auto offset = 0; offset != 17; ++offset) {
+		const auto filler = QByteArray(offset, 'x');
+		CheckEscaped(filler + line);
+		CheckEscaped(filler + paragraph + filler);
+		CheckEscaped(filler + other + line);
+		CheckEscaped(filler + line.mid(0, 2)); // Cut at the end.
+		CheckEscaped(filler + line.mid(0, 1));
+	}
+}
+
+void TestEscapingRandom() {
+	const auto alphabet = QByteArray(
+		"abcXYZ 019\"\\&'<>\n\r\t\x01\x1F\x7F\xE2\x80\xA8\xA9\xD0\xFF");
+	auto engine = std::mt19937(20231017);
+	auto pick = std::uniform_int_distribution<int>(0, alphabet.size() - 1);
+	auto length = std::uniform_int_distribution<int>(0, 100);
+	for (auto i = 0; i != 20000; ++i) {
+		auto value = QByteArray(length(engine), char(0));
+		for (auto &ch : value) {
+			ch = alphabet[pick(engine)];
+		}
+		CheckEscaped(value);
+	}
+}
+
+void CheckDate(TimeId date) {
+	auto formatted = QByteArray();
+	AppendIsoDateTime(formatted, date);
+	const auto expected = QDateTime::fromSecsSinceEpoch(date);
+	Expects(formatted == expected.toString(Qt::ISODate).toUtf8());
+
+	const auto parsed = ParseLocalDateTime(date);
+	Expects(parsed.year == expected.date().year());
+	Expects(parsed.month == expected.date().month());
+	Expects(parsed.day == expected.date().day());
+	Expects(parsed.hour == expected.time().hour());
+	Expects(parsed.minute == expected.time().minute());
+	Expects(parsed.second == expected.time().second());
+}
+
+void TestDates() {
+	// Every hour and a bit of 2021, passing the daylight saving switches.
+	const auto from = TimeId(1609459200);
+	for (auto date = from; date < from + 366 * 86400; date += 3607) {
+		CheckDate(date);
+	}
+
+	// Alternating dates, like the same day checks between two messages.
+	for (auto i = 0; i != 1000; ++i) {
+		CheckDate(from + i * 60);
+		CheckDate(from + 200 * 86400 + i * 60);
+	}
+
+	auto engine = std::mt19937(20231017);
+	auto random = std::uniform_int_distribution<TimeId>(
+		0,
+		std::numeric_limits<TimeId>::max());
+	for (auto i = 0; i != 20000; ++i) {
+		CheckDate(random(engine));
+	}
+}
+
+void TestNumbers() {
+	const auto format = [](int64 value, int length) {
+		auto result = QByteArray();
+		AppendNumber(result, value, length);
+		return result;
+	};
+	Expects(format(0, 0) == "0");
+	Expects(format(7, 2) == "07");
+	Expects(format(2021, 4) == "2021");
+	Expects(format(-15, 0) == "-15");
+	Expects(format(std::numeric_limits<int64>::min(), 0)
+		== QByteArray::number(std::numeric_limits<qlonglong>::min()));
+	Expects(format(std::numeric_limits<int64>::max(), 0)
+		== QByteArray::number(std::numeric_limits<qlonglong>::max()));
+}
+
+} // namespace
+
+QString name() {
+	return u"export_serialize"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+	TestEscapingEveryByte();
+	TestEscapingSeparators();
+	TestEscapingRandom();
+	TestDates();
+	TestNumbers();
+
+	QApplication::quit();
+}
+
+} // namespace Test
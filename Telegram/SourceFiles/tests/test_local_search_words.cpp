@@ -0,0 +1,139 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "scheme.h"
+#include "data/data_local_search_words.h"
+
+#include <QApplication>
+
+#include <random>
+#include <vector>
+
+namespace Test {
+namespace {
+
+using namespace Data::LocalSearch;
+
+[[nodiscard]] std::vector<MsgId> Find(
+		const WordsMap &words,
+		const QString &query,
+		int limit = 100) {
+	return Search(words, SortedWords(words), PrepareWords(query), limit);
+}
+
+[[nodiscard]] std::vector<MsgId> Ids(std::initializer_list<int> list) {
+	auto result = std::vector<MsgId>();
+	for (const auto id : list) {
+		result.push_back(MsgId(id));
+	}
+	return result;
+}
+
+void TestPrepareWords() {
+	Expects(PrepareWords(QString()).isEmpty());
+	Expects(PrepareWords(u"  ,.  "_q).isEmpty());
+
+	const auto words = PrepareWords(u"Hello, WORLD! hello"_q);
+	Expects(words.contains(u"hello"_q));
+	Expects(words.contains(u"world"_q));
+
+	// Long words are cut, so both the text and the query match.
+	const auto long1 = PrepareWords(QString(100, QChar('a')));
+	Expects(long1.size() == 1);
+	Expects(long1.front().size() == 32);
+	const auto long2 = PrepareWords(QString(40, QChar('a')));
+	Expects(long2 == long1);
+}
+
+void TestSearch() {
+	auto words = WordsMap();
+	AddWords(words, MsgId(10), u"The quick brown fox"_q);
+	AddWords(words, MsgId(3), u"a quick reply"_q);
+	AddWords(words, MsgId(7), u"brown bear"_q);
+	AddWords(words, MsgId(20), u"Quickly, brown!"_q);
+
+	// Prefixes match, all the query words are required, newest first.
+	Expects(Find(words, u"quick"_q) == Ids({ 20, 10, 3 }));
+	Expects(Find(words, u"quick brown"_q) == Ids({ 20, 10 }));
+	Expects(Find(words, u"bro"_q) == Ids({ 20, 10, 7 }));
+	Expects(Find(words, u"quick bear"_q).empty());
+	Expects(Find(words, u"lion"_q).empty());
+	Expects(Find(words, QString()).empty());
+	Expects(Find(words, u"quick"_q, 2) == Ids({ 20, 10 }));
+	Expects(Find(words, u"quick"_q, 0).empty());
+
+	// Words of removed messages are gone.
+	Expects(RemoveIds(words, Ids({ 7, 10 })));
+	Expects(Find(words, u"bear"_q).empty());
+	Expects(Find(words, u"brown"_q) == Ids({ 20 }));
+	Expects(!words.contains(u"fox"_q));
+}
+
+// The saved index minus removed ids plus words added while loading.
+void TestMerge() {
+	auto saved = WordsMap();
+	AddWords(saved, MsgId(1), u"old text"_q);
+	AddWords(saved, MsgId(2), u"edited text"_q);
+
+	auto added = WordsMap();
+	AddWords(added, MsgId(2), u"fixed text"_q);
+	AddWords(added, MsgId(5), u"new text"_q);
+
+	RemoveIds(saved, Ids({ 2 }));
+	Merge(saved, added);
+	Expects(Find(saved, u"text"_q) == Ids({ 5, 2, 1 }));
+	Expects(Find(saved, u"edited"_q).empty());
+	Expects(Find(saved, u"fixed"_q) == Ids({ 2 }));
+	Expects(Find(saved, u"old"_q) == Ids({ 1 }));
+}
+
+void TestSerialize() {
+	Expects(Serialize(WordsMap()).isEmpty());
+	Expects(Deserialize(QByteArray()).empty());
+
+	auto generator = std::mt19937(42);
+	auto random = std::uniform_int_distribution<int>(0, 1'000'000);
+	auto words = WordsMap();
+	for (auto i = 0; i != 2000; ++i) {
+		const auto text = QString::number(random(generator), 36)
+			+ ' '
+			+ QString::number(random(generator) % 100, 36);
+		AddWords(words, MsgId(random(generator)), text);
+	}
+	const auto serialized = Serialize(words);
+	Expects(Deserialize(serialized) == words);
+
+	// Broken data gives nothing instead of a partial index.
+	Expects(Deserialize(serialized.mid(0, serialized.size() / 2)).empty());
+	Expects(Deserialize(serialized.mid(0, 6)).empty());
+
+	auto other = serialized;
+	other[3] = char(2); // Unknown version.
+	Expects(Deserialize(other).empty());
+}
+
+} // namespace
+
+QString name() {
+	return u"local_search_words"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+	TestPrepareWords();
+	TestSearch();
+	TestMerge();
+	TestSerialize();
+
+	QApplication::quit();
+}
+
+} // namespace Test
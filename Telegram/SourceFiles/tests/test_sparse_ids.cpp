@@ -0,0 +1,211 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "scheme.h"
+#include "storage/storage_sparse_ids_list.h"
+
+#include <QApplication>
+
+#include <random>
+#include <set>
+#include <vector>
+
+namespace Test {
+namespace {
+
+using namespace Storage;
+
+[[nodiscard]] std::vector<MsgId> Ids(int from, int till) {
+	auto result = std::vector<MsgId>();
+	for (auto id = from; id < till; ++id) {
+		result.push_back(MsgId(id));
+	}
+	return result;
+}
+
+void CheckSame(const SparseIdsChunks &chunks, const std::set<MsgId> &set) {
+	const auto all = std::vector<MsgId>(set.begin(), set.end());
+	Expects(chunks.size() == int(all.size()));
+	Expects(chunks.empty() == all.empty());
+	if (all.empty()) {
+		return;
+	}
+	Expects(chunks.front() == all.front());
+	Expects(chunks.back() == all.back());
+	Expects(chunks.ids(0, chunks.size()) == all);
+
+	const auto size = int(all.size());
+	for (const auto from : { 0, 1, size / 3, size / 2, size - 1 }) {
+		const auto till = std::min(from + 300, size);
+		Expects(chunks.ids(from, till) == std::vector<MsgId>(
+			all.begin() + from,
+			all.begin() + till));
+	}
+	for (const auto id : { 0, 1, 7, 500, 1000, 4999, 5000, 9000 }) {
+		const auto count = int(std::distance(
+			set.begin(),
+			set.lower_bound(MsgId(id))));
+		Expects(chunks.lowerBound(MsgId(id)) == count);
+		Expects(chunks.contains(MsgId(id)) == set.contains(MsgId(id)));
+	}
+}
+
+void TestChunksAgainstSet() {
+	auto chunks = SparseIdsChunks();
+	auto set = std::set<MsgId>();
+	auto engine = std::mt19937(20231017);
+	auto id = std::uniform_int_distribution<int>(1, 5000);
+	auto action = std::uniform_int_distribution<int>(0, 9);
+	for (auto i = 0; i != 20000; ++i) {
+		const auto type = action(engine);
+		if (type < 5) {
+			const auto value = MsgId(id(engine));
+			Expects(chunks.insert(value) == set.insert(value).second);
+		} else if (type < 8) {
+			const auto value = MsgId(id(engine));
+			Expects(chunks.remove(value) == (set.erase(value) > 0));
+		} else {
+			auto page = std::vector<MsgId>();
+			const auto from = id(engine);
+			for (auto j = 0; j != 100; ++j) {
+				page.push_back(MsgId(from + j * 3));
+			}
+			auto added = 0;
+			for (const auto value : page) {
+				added += set.insert(value).second ? 1 : 0;
+			}
+			Expects(chunks.merge(std::move(page)) == added);
+		}
+		if (!(i % 500)) {
+			CheckSame(chunks, set);
+		}
+	}
+	CheckSame(chunks, set);
+}
+
+void TestChunksEdges() {
+	auto chunks = SparseIdsChunks();
+	auto set = std::set<MsgId>();
+	const auto add = [&](std::vector<MsgId> ids) {
+		set.insert(ids.begin(), ids.end());
+		chunks.merge(std::move(ids));
+		CheckSame(chunks, set);
+	};
+	add(Ids(3000, 4000)); // Into empty.
+	add(Ids(4000, 5500)); // After the back.
+	add(Ids(100, 3000)); // Before the front.
+	add(Ids(2500, 4500)); // Already there.
+
+	auto other = SparseIdsChunks();
+	other.merge(Ids(6000, 7000));
+	for (const auto value : Ids(6000, 7000)) {
+		set.insert(value);
+	}
+	chunks.append(std::move(other));
+	Expects(other.empty());
+	CheckSame(chunks, set);
+
+	// Overlapping lists are merged instead.
+	auto overlapping = SparseIdsChunks();
+	overlapping.merge(Ids(6900, 7100));
+	for (const auto value : Ids(6900, 7100)) {
+		set.insert(value);
+	}
+	chunks.append(std::move(overlapping));
+	CheckSame(chunks, set);
+
+	for (auto value = 100; value != 7100; value += 2) {
+		chunks.remove(MsgId(value));
+		set.erase(MsgId(value));
+	}
+	CheckSame(chunks, set);
+}
+
+void TestWindow() {
+	auto chunks = SparseIdsChunks();
+	chunks.merge(Ids(1, 3001));
+	auto update = SparseIdsSliceUpdate{
+		.messages = &chunks,
+		.range = { 0, ServerMaxMsgId },
+		.count = 3000,
+	};
+
+	// One more id before aroundId than the viewer keeps, like
+	// lower_bound() + limitBefore in SparseIdsSliceBuilder::sliceToLimits.
+	const auto middle = update.window(MsgId(1500), 10, 20);
+	Expects(middle.count == 3000);
+	Expects(middle.messageIds.size() == 32);
+	Expects(middle.messageIds.front() == MsgId(1489));
+	Expects(middle.messageIds.back() == MsgId(1520));
+	Expects(middle.skippedBefore == 1488);
+	Expects(middle.skippedAfter == 1480);
+
+	const auto top = update.window(MsgId(3), 10, 20);
+	Expects(top.messageIds.front() == MsgId(1));
+	Expects(top.messageIds.back() == MsgId(23));
+	Expects(top.skippedBefore == 0);
+	Expects(top.skippedAfter == 3000 - 23);
+
+	const auto bottom = update.window(MsgId(5000), 10, 20);
+	Expects(bottom.messageIds.front() == MsgId(2990));
+	Expects(bottom.messageIds.back() == MsgId(3000));
+	Expects(bottom.skippedAfter == 0);
+
+	// Without aroundId the viewer takes the whole slice.
+	const auto all = update.window(MsgId(), 10, 20);
+	Expects(all.messageIds.size() == 3000);
+	Expects(all.skippedBefore == 0 && all.skippedAfter == 0);
+
+	// Skipped counts are known only where the slice reaches the edges.
+	update.range = { MsgId(1), MsgId(3000) };
+	update.count = std::nullopt;
+	const auto inner = update.window(MsgId(1500), 10, 20);
+	Expects(inner.messageIds.size() == 32);
+	Expects(!inner.skippedBefore && !inner.skippedAfter);
+	Expects(!inner.count);
+}
+
+void TestListSnapshot() {
+	auto list = SparseIdsList();
+	list.addSlice(Ids(1000, 2000), { MsgId(1000), MsgId(1999) }, 5000);
+	list.addSlice(Ids(3000, 4000), { MsgId(3000), MsgId(3999) }, 5000);
+	list.addSlice(Ids(1500, 3500), { MsgId(1500), MsgId(3500) }, 5000);
+
+	// The three slices were united into one.
+	const auto result = list.snapshot({ MsgId(2500), 5, 5 });
+	Expects(result.count == 5000);
+	Expects(result.messageIds.size() == 11);
+	Expects(result.messageIds.front() == MsgId(2495));
+	Expects(result.messageIds.back() == MsgId(2505));
+
+	list.removeOne(MsgId(2500));
+	const auto removed = list.snapshot({ MsgId(2500), 5, 5 });
+	Expects(!removed.messageIds.contains(MsgId(2500)));
+	Expects(removed.count == 4999);
+}
+
+} // namespace
+
+QString name() {
+	return u"sparse_ids"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+	TestChunksAgainstSet();
+	TestChunksEdges();
+	TestWindow();
+	TestListSnapshot();
+
+	QApplication::quit();
+}
+
+} // namespace Test
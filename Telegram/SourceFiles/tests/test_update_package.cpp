@@ -0,0 +1,250 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_main.h"
+
+#include "core/update_package.h"
+
+#include <QApplication>
+#include <QtCore/QBuffer>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTemporaryFile>
+
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+
+extern "C" {
+#include <openssl/sha.h>
+} // extern "C"
+
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED
+#include <LzmaLib.h>
+#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+#include <lzma.h>
+#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
+
+namespace Test {
+namespace {
+
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+
+using namespace Core;
+
+constexpr auto kVersion = quint32(5001002);
+
+struct File {
+	QString name;
+	QByteArray data;
+};
+
+// The same layout the packer writes before compressing.
+[[nodiscard]] QByteArray Package(const std::vector<File> &files) {
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << kVersion << quint32(files.size());
+		for (const auto &file : files) {
+			stream << file.name << quint32(file.data.size()) << file.data;
+#ifndef Q_OS_WIN
+			stream << false;
+#endif // !Q_OS_WIN
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] std::optional<UpdateVersion> Unpack(
+		const QByteArray &package,
+		const QString &folder,
+		bool accept = true) {
+	auto buffer = QBuffer();
+	buffer.setData(package);
+	buffer.open(QIODevice::ReadOnly);
+	return UnpackUpdateFiles(buffer, folder, [&](UpdateVersion version) {
+		Expects(version.version == kVersion);
+		return accept;
+	});
+}
+
+[[nodiscard]] QByteArray Read(const QString &path) {
+	auto file = QFile(path);
+	return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+[[nodiscard]] std::pair<QByteArray, QByteArray> Compress(
+		const QByteArray &data) {
+#if defined Q_OS_WIN && !defined TDESKTOP_USE_PACKAGED
+	auto result = QByteArray(data.size() + 1024, Qt::Uninitialized);
+	auto props = QByteArray(LZMA_PROPS_SIZE, Qt::Uninitialized);
+	auto resultLen = size_t(result.size());
+	auto propsLen = size_t(props.size());
+	const auto code = LzmaCompress(
+		reinterpret_cast<uchar*>(result.data()),
+		&resultLen,
+		reinterpret_cast<const uchar*>(data.constData()),
+		data.size(),
+		reinterpret_cast<uchar*>(props.data()),
+		&propsLen,
+		9,
+		64 * 1024,
+		3,
+		0,
+		2,
+		32,
+		1);
+	Expects(code == SZ_OK);
+	result.resize(resultLen);
+	return { result, props };
+#else // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+	auto result = QByteArray(lzma_stream_buffer_bound(data.size()), 0);
+	auto resultLen = size_t();
+	const auto code = lzma_easy_buffer_encode(
+		6,
+		LZMA_CHECK_CRC32,
+		nullptr,
+		reinterpret_cast<const uint8_t*>(data.constData()),
+		data.size(),
+		reinterpret_cast<uint8_t*>(result.data()),
+		&resultLen,
+		result.size());
+	Expects(code == LZMA_OK);
+	result.resize(resultLen);
+	return { result, QByteArray() };
+#endif // Q_OS_WIN && !TDESKTOP_USE_PACKAGED
+}
+
+void TestFileNames() {
+	Expects(GoodUpdateFileName(u"Telegram"_q));
+	Expects(GoodUpdateFileName(u"modules/x64/d3d/d3dcompiler_47.dll"_q));
+	Expects(GoodUpdateFileName(u"a/b..c/..d"_q));
+
+	Expects(!GoodUpdateFileName(QString()));
+	Expects(!GoodUpdateFileName(u".."_q));
+	Expects(!GoodUpdateFileName(u"../Telegram"_q));
+	Expects(!GoodUpdateFileName(u"modules/../../Telegram"_q));
+	Expects(!GoodUpdateFileName(u"modules\\..\\..\\Telegram"_q));
+	Expects(!GoodUpdateFileName(u"/usr/bin/Telegram"_q));
+	Expects(!GoodUpdateFileName(u"\\Windows\\Telegram.exe"_q));
+	Expects(!GoodUpdateFileName(u"C:/Telegram.exe"_q));
+	Expects(!GoodUpdateFileName(u"C:Telegram.exe"_q));
+}
+
+void TestUnpack() {
+	auto dir = QTemporaryDir();
+	Expects(dir.isValid());
+	const auto folder = dir.path() + u"/temp"_q;
+	const auto big = QByteArray(1024 * 1024 + 17, 'x');
+	const auto files = std::vector<File>{
+		{ u"Telegram"_q, big },
+		{ u"modules/empty"_q, QByteArray() },
+		{ u"modules/small"_q, QByteArray("small") },
+	};
+	const auto version = Unpack(Package(files), folder);
+	Expects(version.has_value());
+	Expects(version->version == kVersion);
+	for (const auto &file : files) {
+		Expects(Read(folder + '/' + file.name) == file.data);
+	}
+
+	// Nothing is written for a version that is not accepted.
+	const auto rejected = dir.path() + u"/rejected"_q;
+	Expects(!Unpack(Package(files), rejected, false));
+	Expects(!QFile::exists(rejected + u"/Telegram"_q));
+
+	// A bad name stops unpacking, nothing is written outside the folder.
+	const auto escaped = dir.path() + u"/escaped"_q;
+	Expects(!Unpack(Package({
+		{ u"good"_q, QByteArray("good") },
+		{ u"../evil"_q, QByteArray("evil") },
+	}), escaped));
+	Expects(!QFile::exists(dir.path() + u"/evil"_q));
+
+	// Truncated data is an error.
+	auto truncated = Package(files);
+	truncated.chop(100);
+	Expects(!Unpack(truncated, dir.path() + u"/truncated"_q));
+}
+
+void TestCopyAndDecompress() {
+	const auto package = Package({
+		{ u"Telegram"_q, QByteArray(3 * 1024 * 1024, 'y') },
+		{ u"Updater"_q, QByteArray("updater") },
+	});
+	const auto [compressed, props] = Compress(package);
+	const auto prefix = props + QByteArray("size");
+
+	auto input = QBuffer();
+	input.setData(compressed);
+	input.open(QIODevice::ReadOnly);
+
+	auto copy = QTemporaryFile();
+	Expects(copy.open());
+	uchar sha1[20];
+	Expects(CopyUpdatePackage(input, copy, prefix, sha1));
+
+	uchar expected[20];
+	const auto hashed = prefix + compressed;
+	SHA1(
+		reinterpret_cast<const uchar*>(hashed.constData()),
+		hashed.size(),
+		expected);
+	Expects(!memcmp(sha1, expected, sizeof(sha1)));
+	Expects(copy.readAll() == compressed);
+
+	// Changing the original after the copy is made changes nothing.
+	input.close();
+	input.buffer().fill('z');
+
+	copy.seek(0);
+	auto output = QBuffer();
+	output.open(QIODevice::ReadWrite);
+	Expects(DecompressUpdatePackage(copy, output, props, package.size()));
+	Expects(output.data() == package);
+
+	copy.seek(0);
+	auto wrongSize = QBuffer();
+	wrongSize.open(QIODevice::ReadWrite);
+	Expects(!DecompressUpdatePackage(
+		copy,
+		wrongSize,
+		props,
+		package.size() + 1));
+
+	auto cut = QBuffer();
+	cut.setData(compressed.mid(0, compressed.size() / 2));
+	cut.open(QIODevice::ReadOnly);
+	auto partial = QBuffer();
+	partial.open(QIODevice::ReadWrite);
+	Expects(!DecompressUpdatePackage(cut, partial, props, package.size()));
+}
+
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
+
+} // namespace
+
+QString name() {
+	return u"update_package"_q;
+}
+
+void test(not_null<Ui::RpWindow*> window, not_null<Ui::RpWidget*> body) {
+	(void)window;
+	(void)body;
+
+#ifndef TDESKTOP_DISABLE_AUTOUPDATE
+	TestFileNames();
+	TestUnpack();
+	TestCopyAndDecompress();
+#endif // !TDESKTOP_DISABLE_AUTOUPDATE
+
+	QApplication::quit();
+}
+
+} // namespace Test
@@ -886,23 +886,35 @@ QColor CountAverageColor(const QImage &image) {
 	Expects(image.format() == QImage::Format_ARGB32_Premultiplied
 		|| image.format() == QImage::Format_RGB32);
 
-	uint64 components[3] = { 0 };
+	// Sum red / blue and green / alpha in 16 bit lanes of 32 bit values,
+	// they can't overflow in kBatch pixels. The compiler vectorizes this.
+	constexpr auto kBatch = 256;
+	uint64 red = 0, green = 0, blue = 0;
 	const auto w = image.width();
 	const auto h = image.height();
-	const auto size = w * h;
-	if (const auto pix = image.constBits()) {
-		for (auto i = 0, l = size * 4; i != l; i += 4) {
-			components[2] += pix[i + 0];
-			components[1] += pix[i + 1];
-			components[0] += pix[i + 2];
+	const auto size = uint64(w) * h;
+	for (auto y = 0; y != h; ++y) {
+		const auto line = reinterpret_cast<const uint32*>(
+			image.constScanLine(y));
+		for (auto x = 0; x < w; x += kBatch) {
+			auto rb = uint32();
+			auto ga = uint32();
+			for (auto i = x, till = std::min(x + kBatch, w); i != till; ++i) {
+				const auto pixel = line[i];
+				rb += (pixel & 0x00FF00FFU);
+				ga += ((pixel >> 8) & 0x00FF00FFU);
+			}
+			red += (rb >> 16);
+			green += (ga & 0xFFFFU);
+			blue += (rb & 0xFFFFU);
 		}
 	}
 	if (size) {
-		for (auto &component : components) {
-			component /= size;
-		}
+		red /= size;
+		green /= size;
+		blue /= size;
 	}
-	return QColor(components[0], components[1], components[2]);
+	return QColor(int(red), int(green), int(blue));
 }
 
 QColor CountAverageColor(const std::vector<QColor> &colors) {
@@ -1162,14 +1174,9 @@ QImage InvertPatternImage(QImage pattern) {
 		QImage::Format_ARGB32_Premultiplied);
 	const auto w = pattern.bytesPerLine() / 4;
 	auto ints = reinterpret_cast<uint32*>(pattern.bits());
-	for (auto y = 0, h = pattern.height(); y != h; ++y) {
-		for (auto x = 0; x != w; ++x) {
-			const auto value = (*ints >> 24);
-			*ints++ = (value << 24)
-				| (value << 16)
-				| (value << 8)
-				| value;
-		}
+	for (auto i = 0, l = w * pattern.height(); i != l; ++i) {
+		// Spread alpha to all four bytes.
+		ints[i] = (ints[i] >> 24) * 0x01010101U;
 	}
 	return pattern;
 }
@@ -273,15 +273,22 @@ void PasscodeLockWidget::submit() {
 	const auto passcode_txt = _passcode->text();
 	const auto passcode = _passcode->text().toUtf8();
 	auto &domain = Core::App().domain();
-	const auto correct = domain.started()
-		? domain.local().checkPasscode(passcode)
+	// Derive the passcode key once for the real and all fake passcodes.
+	const auto checkKey = domain.started()
+		? domain.local().CreatePasscodeCheckKey(passcode)
+		: MTP::AuthKeyPtr();
+	const auto correct = checkKey
+		? domain.local().checkPasscodeKey(checkKey)
 		: (domain.start(passcode) == Storage::StartResult::Success);
 	// Passcode can be cleared if there is no accounts (after domain.start())
 
 	// local passcode and fake pass code may match?
 	// TODO: understand - describe all cases here
 	FAKE_LOG(qsl("Check for fake passcode %1").arg(passcode_txt));
-	if (domain.local().CheckAndExecuteIfFake(passcode)) {
+	const auto fake = checkKey
+		? domain.local().CheckAndExecuteIfFake(checkKey)
+		: domain.local().CheckAndExecuteIfFake(passcode);
+	if (fake) {
 		FAKE_LOG(qsl("%1 is fake passcode, executed!").arg(passcode_txt));
 	}
 	else {
@@ -31,6 +31,8 @@ PRIVATE
     export/output/export_output_json.cpp
     export/output/export_output_json.h
     export/output/export_output_result.h
+    export/output/export_output_serialize.cpp
+    export/output/export_output_serialize.h
     export/output/export_output_stats.cpp
     export/output/export_output_stats.h
 )
@@ -4,41 +4,95 @@
 # For license and copyright information please follow this link:
 # https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
-add_executable(test_text WIN32)
-init_target(test_text "(tests)")
+function(add_test_app target_name)
+    add_executable(${target_name} WIN32)
+    init_target(${target_name} "(tests)")
 
-target_include_directories(test_text PRIVATE ${src_loc})
+    target_include_directories(${target_name} PRIVATE ${src_loc})
 
-nice_target_sources(test_text ${src_loc}
-PRIVATE
-    tests/test_main.cpp
-    tests/test_main.h
+    nice_target_sources(${target_name} ${src_loc}
+    PRIVATE
+        tests/test_main.cpp
+        tests/test_main.h
+        ${ARGN}
+    )
+
+    nice_target_sources(${target_name} ${res_loc}
+    PRIVATE
+        qrc/emoji_1.qrc
+        qrc/emoji_2.qrc
+        qrc/emoji_3.qrc
+        qrc/emoji_4.qrc
+        qrc/emoji_5.qrc
+        qrc/emoji_6.qrc
+        qrc/emoji_7.qrc
+        qrc/emoji_8.qrc
+    )
+
+    target_link_libraries(${target_name}
+    PRIVATE
+        desktop-app::lib_base
+        desktop-app::lib_crl
+        desktop-app::lib_ui
+        desktop-app::external_qt
+        desktop-app::external_qt_static_plugins
+    )
+
+    set_target_properties(${target_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
+
+    add_dependencies(Telegram ${target_name})
+
+    target_prepare_qrc(${target_name})
+endfunction()
+
+add_test_app(test_text
     tests/test_text.cpp
 )
 
-nice_target_sources(test_text ${res_loc}
-PRIVATE
-    qrc/emoji_1.qrc
-    qrc/emoji_2.qrc
-    qrc/emoji_3.qrc
-    qrc/emoji_4.qrc
-    qrc/emoji_5.qrc
-    qrc/emoji_6.qrc
-    qrc/emoji_7.qrc
-    qrc/emoji_8.qrc
+add_test_app(test_action_executor
+    tests/test_action_executor.cpp
+    fakepasscode/actions/action_executor.cpp
+    fakepasscode/actions/action_executor.h
+)
+
+add_test_app(test_autodelete_schedule
+    tests/test_autodelete_schedule.cpp
+    fakepasscode/autodelete/autodelete_schedule.cpp
+    fakepasscode/autodelete/autodelete_schedule.h
 )
 
-target_link_libraries(test_text
+target_link_libraries(test_autodelete_schedule PRIVATE tdesktop::td_scheme)
+
+add_test_app(test_local_search_words
+    tests/test_local_search_words.cpp
+    data/data_local_search_words.cpp
+    data/data_local_search_words.h
+)
+
+target_link_libraries(test_local_search_words PRIVATE tdesktop::td_scheme)
+
+add_test_app(test_update_package
+    tests/test_update_package.cpp
+    core/update_package.cpp
+    core/update_package.h
+)
+
+target_link_libraries(test_update_package
 PRIVATE
-    desktop-app::lib_base
-    desktop-app::lib_crl
-    desktop-app::lib_ui
-    desktop-app::external_qt
-    desktop-app::external_qt_static_plugins
+    desktop-app::external_auto_updates
+    desktop-app::external_openssl
 )
 
-set_target_properties(test_text PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
+add_test_app(test_export_serialize
+    tests/test_export_serialize.cpp
+    export/output/export_output_serialize.cpp
+    export/output/export_output_serialize.h
+)
 
-add_dependencies(Telegram test_text)
+add_test_app(test_sparse_ids
+    tests/test_sparse_ids.cpp
+    storage/storage_sparse_ids_list.cpp
+    storage/storage_sparse_ids_list.h
+)
 
-target_prepare_qrc(test_text)
+target_link_libraries(test_sparse_ids PRIVATE tdesktop::td_scheme)